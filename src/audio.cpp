@@ -0,0 +1,60 @@
+#include <algorithm>
+#include <cmath>
+#include "audio.h"
+
+Audio_Ring::Audio_Ring() : _samples_written(0), _samples_dropped(0), _samples_read(0), _underruns(0), 
+  _samples_missing(0) {}
+
+void Audio_Ring::write(const int16_t *samples, size_t count) {
+  size_t added = _samples.push(samples, count);
+  _samples_written.fetch_add(added, std::memory_order_relaxed);
+  _samples_dropped.fetch_add(count - added, std::memory_order_relaxed);
+}
+
+void Audio_Ring::read(int16_t *samples, size_t count) {
+  size_t taken = _samples.pop(samples, count);
+  std::fill(samples + taken, samples + count, 0);
+  _samples_read.fetch_add(count, std::memory_order_relaxed);
+  if(taken < count) {
+    _underruns.fetch_add(1, std::memory_order_relaxed);
+    _samples_missing.fetch_add(count - taken, std::memory_order_relaxed);
+  }
+}
+
+size_t Audio_Ring::size() const {
+  return _samples.size();
+}
+
+Audio_Statistics Audio_Ring::get_statistics() const {
+  return Audio_Statistics{_samples_written.load(std::memory_order_relaxed), 
+    _samples_dropped.load(std::memory_order_relaxed), _samples_read.load(std::memory_order_relaxed), 
+    _underruns.load(std::memory_order_relaxed), _samples_missing.load(std::memory_order_relaxed)};
+}
+
+Audio_Generator::Audio_Generator(Audio_Ring &ring, uint32_t sample_rate) : _ring(ring), 
+  _sample_rate(sample_rate), _tick(0), _phase(0) {
+  _samples = std::vector<int16_t>(samples_in_tick(0, sample_rate) + 1);
+}
+
+/* Renders the whole tick with the state at its end, so the buzzer starts and stops on tick boundaries */
+void Audio_Generator::tick(const Machine_State &state) {
+  uint32_t count = samples_in_tick(_tick++, _sample_rate);
+  if(state.sound_timer == 0) {
+    _phase = 0;
+    std::fill(_samples.begin(), _samples.begin() + count, 0);
+  } else {
+    double step = AUDIO_PATTERN_RATE * std::pow(2.0, (state.pitch - DEFAULT_PITCH) / AUDIO_PITCH_OCTAVE) / _sample_rate;
+    for(uint32_t i = 0; i < count; i++) {
+      uint8_t bit = static_cast<uint8_t>(_phase);
+      bool high = state.audio_pattern[bit / 8] & (0x80 >> (bit % 8));
+      _samples[i] = high ? AUDIO_AMPLITUDE : -AUDIO_AMPLITUDE;
+      _phase += step;
+      if(_phase >= AUDIO_PATTERN_BITS) _phase -= AUDIO_PATTERN_BITS;
+    }
+  }
+  _ring.write(_samples.data(), count);
+}
+
+uint32_t Audio_Generator::get_sample_rate() const {
+  return _sample_rate;
+}
\ No newline at end of file
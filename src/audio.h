@@ -0,0 +1,90 @@
+#ifndef AUDIO_H
+#define AUDIO_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "machine_state.h"
+#include "spsc_ring.h"
+
+#define AUDIO_SAMPLE_RATE 44100
+/* Samples the ring holds, about 46ms at 44.1kHz, which bounds the delay between emulation and output */
+#define AUDIO_RING_SIZE 2048
+/* Number of 60Hz timer ticks in a second */
+#define AUDIO_TICK_RATE 60
+#define AUDIO_AMPLITUDE 6000
+
+/* Bits of the pattern, played highest bit of the first byte first */
+#define AUDIO_PATTERN_BITS (AUDIO_PATTERN_SIZE * 8)
+/* Pattern bits played per second at the default pitch, each 48 steps of pitch doubles it */
+#define AUDIO_PATTERN_RATE 4000.0
+#define AUDIO_PITCH_OCTAVE 48.0
+
+/* Counters of both ends of the ring */
+typedef struct Audio_Statistics {
+  /* Samples produced by the emulation, and those dropped because the ring was full */
+  uint64_t samples_written;
+  uint64_t samples_dropped;
+  /* Samples taken by the output, reads the ring could not fill and the silence they were padded with */
+  uint64_t samples_read;
+  uint64_t underruns;
+  uint64_t samples_missing;
+} Audio_Statistics;
+
+/* Number of samples in the 60Hz tick, spread so that every second holds exactly the sample rate */
+inline uint32_t samples_in_tick(uint64_t tick, uint32_t sample_rate) {
+  return static_cast<uint32_t>((tick + 1) * sample_rate / AUDIO_TICK_RATE - tick * sample_rate / AUDIO_TICK_RATE);
+}
+
+/*
+  Samples handed from the emulation thread to the thread playing them through a lock-free ring. 
+  Neither side ever waits: samples that do not fit are dropped, and a read the ring cannot fill 
+  is padded with silence. Each side only writes its own counters
+*/
+class Audio_Ring {
+  public:
+    /* Constructor */
+    Audio_Ring();
+    /* Add samples from the emulation thread, dropping those that do not fit */
+    void write(const int16_t *samples, size_t count);
+    /* Fill the buffer from the output thread, padding it with silence if the ring runs dry */
+    void read(int16_t *samples, size_t count);
+    /* Number of samples waiting to be read */
+    size_t size() const;
+    /* Get the counters of both ends, exact once the emulation is stopped */
+    Audio_Statistics get_statistics() const;
+  private:
+    Spsc_Ring<int16_t, AUDIO_RING_SIZE> _samples;
+    /* Written by the emulation thread */
+    std::atomic<uint64_t> _samples_written;
+    std::atomic<uint64_t> _samples_dropped;
+    /* Written by the output thread */
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> _samples_read;
+    std::atomic<uint64_t> _underruns;
+    std::atomic<uint64_t> _samples_missing;
+};
+
+/*
+  Renders the buzzer one 60Hz tick at a time into the ring. The tick is silent unless the sound timer 
+  is running, in which case the audio pattern is looped at the rate set by the pitch register. The 
+  original platform and SUPER-CHIP keep the default pattern and pitch, a square wave
+*/
+class Audio_Generator {
+  public:
+    /* Constructor */
+    explicit Audio_Generator(Audio_Ring &ring, uint32_t sample_rate = AUDIO_SAMPLE_RATE);
+    /* Write the samples of the tick ending now, from the sound timer, pattern and pitch of the state */
+    void tick(const Machine_State &state);
+    uint32_t get_sample_rate() const;
+  private:
+    Audio_Ring &_ring;
+    uint32_t _sample_rate;
+    /* Ticks rendered so far, which decides how many samples the next one has */
+    uint64_t _tick;
+    /* Position in the pattern in bits, restarted whenever the buzzer is off */
+    double _phase;
+    std::vector<int16_t> _samples;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,18 @@
+#include "audio_stream.h"
+
+Audio_Stream::Audio_Stream(Audio_Ring &ring, uint32_t sample_rate) : _ring(ring) {
+  initialize(1, sample_rate, {sf::SoundChannel::Mono});
+}
+
+Audio_Stream::~Audio_Stream() {
+  stop();
+}
+
+bool Audio_Stream::onGetData(Chunk &data) {
+  _ring.read(_chunk.data(), _chunk.size());
+  data.samples = _chunk.data();
+  data.sampleCount = _chunk.size();
+  return true;
+}
+
+void Audio_Stream::onSeek(sf::Time) {}
\ No newline at end of file
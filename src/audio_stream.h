@@ -0,0 +1,31 @@
+#ifndef AUDIO_STREAM_H
+#define AUDIO_STREAM_H
+
+#include <SFML/Audio.hpp>
+#include <array>
+#include <stdint.h>
+#include "audio.h"
+
+/* Samples handed to SFML per request, about 12ms at 44.1kHz */
+#define AUDIO_STREAM_CHUNK_SIZE 512
+
+/* 
+  Plays the audio ring through SFML. Chunks are requested on SFML's audio thread, which reads the ring 
+  without ever waiting on the emulation thread, playing silence for whatever it has not produced yet
+*/
+class Audio_Stream : public sf::SoundStream {
+  public:
+    /* Constructor */
+    explicit Audio_Stream(Audio_Ring &ring, uint32_t sample_rate = AUDIO_SAMPLE_RATE);
+    /* Destructor, stops playback before the chunk it reads into is gone */
+    ~Audio_Stream() override;
+  private:
+    /* Fill the next chunk from the ring, the stream never ends on its own */
+    bool onGetData(Chunk &data) override;
+    /* The ring cannot be seeked, playback always continues from the newest samples */
+    void onSeek(sf::Time time_offset) override;
+    Audio_Ring &_ring;
+    std::array<int16_t, AUDIO_STREAM_CHUNK_SIZE> _chunk;
+};
+
+#endif
\ No newline at end of file
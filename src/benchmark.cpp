@@ -0,0 +1,180 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include "benchmark.h"
+#include "frame_renderer.h"
+#include "options.h"
+
+/* Cycles run by one call while timing the interpreter alone */
+#define BENCHMARK_CHUNK_CYCLES 65536
+
+std::vector<Benchmark_Rom> benchmark_roms() {
+  return {
+    /* Twelve register to register operations and a jump back */
+    {"alu", {
+      0x60, 0x01, 0x61, 0x03, 0x62, 0x07, 0x63, 0x0F, 
+      0x80, 0x14, 0x81, 0x25, 0x82, 0x36, 0x83, 0x01, 0x84, 0x12, 0x85, 0x23, 
+      0x80, 0x34, 0x81, 0x0E, 0x82, 0x17, 0x83, 0x02, 0x84, 0x13, 0x85, 0x14, 
+      0x12, 0x08
+    }, true},
+    /* Font characters drawn across the whole display, wrapping at the edges */
+    {"draw", {
+      0x60, 0x00, 0x61, 0x00, 0x62, 0x00,
+      0xF2, 0x29, 0xD0, 0x15, 0x70, 0x03, 0x71, 0x05, 0x72, 0x01, 
+      0x12, 0x06
+    }, false},
+    /* Every register stored to and loaded from memory outside the program */
+    {"memory", {
+      0xA3, 0x00,
+      0xFF, 0x55, 0xFF, 0x65, 0xA3, 0x00, 0x70, 0x01, 
+      0x12, 0x02
+    }, true},
+    /* Calls nested four deep, returning one level at a time */
+    {"call", {
+      0x22, 0x10, 0x12, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x22, 0x20, 0x00, 0xEE, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x22, 0x30, 0x00, 0xEE, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x22, 0x40, 0x00, 0xEE, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0xEE
+    }, true}
+  };
+}
+
+static const char *dispatch_name(Dispatch_Mode dispatch) {
+  switch(dispatch) {
+    case Dispatch_Mode::SWITCH:
+      return "switch";
+    case Dispatch_Mode::JIT:
+      return "jit";
+    default:
+      return "threaded";
+  }
+}
+
+/* Time one run in nanoseconds per unit of work */
+template <typename Function>
+static double time_per(uint64_t units, Function function) {
+  std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+  function();
+  std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start_time;
+  return units > 0 ? elapsed.count() / units : 0;
+}
+
+Benchmark_Result run_benchmark(const Benchmark_Rom &rom, Dispatch_Mode dispatch, uint64_t cycles, uint32_t repetitions) {
+  Arguments args = default_arguments();
+  args.dw = rom.display_wait;
+  args.dispatch = dispatch;
+  args.seed = 0;
+  Chip_8 chip_8(args);
+
+  /* The ROM is placed straight into memory, so no file is needed */
+  Machine_State initial;
+  copy_state(initial, chip_8.get_state(), chip_8.get_platform());
+  std::memcpy(&initial.memory[PROGRAM_ADDRESS], rom.program.data(), 
+    std::min<size_t>(rom.program.size(), MEMORY_SIZE - PROGRAM_ADDRESS));
+
+  Benchmark_Result result{rom.name + "/" + dispatch_name(chip_8.get_dispatch()), cycles, {}, {}};
+  Frame_Renderer renderer;
+  Framebuffer presented{};
+  uint64_t frames = std::max<uint64_t>(cycles / DEFAULT_CYCLES_PER_FRAME, 1);
+
+  /* 
+    The first repetition fills the caches and translates the blocks, and is not counted. Restoring the initial state 
+    only invalidates the memory the ROM wrote to, so the later repetitions run warm
+  */
+  for(uint32_t repetition = 0; repetition <= repetitions; repetition++) {
+    chip_8.set_state(initial);
+    double ns_per_instruction = time_per(cycles, [&chip_8, cycles]() {
+      for(uint64_t run = 0; run < cycles; run += BENCHMARK_CHUNK_CYCLES) {
+        chip_8.run_cycles(static_cast<uint32_t>(std::min<uint64_t>(BENCHMARK_CHUNK_CYCLES, cycles - run)));
+      }
+    });
+
+    /* The work the emulation thread and window do for every frame, without a window */
+    chip_8.set_state(initial);
+    double frame_ns = time_per(frames, [&chip_8, &renderer, &presented, frames]() {
+      for(uint64_t frame = 0; frame < frames; frame++) {
+        chip_8.run_frame(DEFAULT_CYCLES_PER_FRAME);
+        uint64_t dirty_rows = chip_8.take_dirty_rows();
+        if(dirty_rows) {
+          presented = chip_8.get_data();
+          renderer.update(presented, dirty_rows);
+        }
+      }
+    });
+
+    if(repetition == 0) continue;
+    result.ns_per_instruction.push_back(ns_per_instruction);
+    result.frame_ns.push_back(frame_ns);
+  }
+  return result;
+}
+
+Benchmark_Statistics get_statistics(std::vector<double> values) {
+  Benchmark_Statistics statistics{0, 0, 0, 0};
+  if(values.empty()) return statistics;
+
+  std::sort(values.begin(), values.end());
+  size_t middle = values.size() / 2;
+  statistics.median = values.size() % 2 ? values[middle] : (values[middle - 1] + values[middle]) / 2;
+  statistics.min = values.front();
+  for(double value : values) {
+    statistics.mean += value;
+  }
+  statistics.mean /= values.size();
+  for(double value : values) {
+    statistics.stddev += (value - statistics.mean) * (value - statistics.mean);
+  }
+  statistics.stddev = std::sqrt(statistics.stddev / values.size());
+  return statistics;
+}
+
+void write_benchmark_report(std::ostream &out, const std::vector<Benchmark_Result> &results) {
+  out << std::fixed << std::setprecision(3);
+  out << "{" << std::endl;
+  out << "  \"benchmarks\": [";
+  for(size_t i = 0; i < results.size(); i++) {
+    const Benchmark_Result &result = results[i];
+    Benchmark_Statistics instruction = get_statistics(result.ns_per_instruction);
+    Benchmark_Statistics frame = get_statistics(result.frame_ns);
+    out << (i == 0 ? "" : ",") << std::endl;
+    out << "    {\"name\": \"" << result.name << "\""
+      << ", \"cycles\": " << result.cycles
+      << ", \"repetitions\": " << result.ns_per_instruction.size()
+      << ", \"median_ns_per_instruction\": " << instruction.median
+      << ", \"min_ns_per_instruction\": " << instruction.min
+      << ", \"mean_ns_per_instruction\": " << instruction.mean
+      << ", \"stddev_ns_per_instruction\": " << instruction.stddev
+      << ", \"instructions_per_second\": " << std::setprecision(0) 
+      << (instruction.median > 0 ? 1e9 / instruction.median : 0) << std::setprecision(3)
+      << ", \"median_frame_ns\": " << frame.median
+      << ", \"stddev_frame_ns\": " << frame.stddev << "}";
+  }
+  out << std::endl << "  ]" << std::endl;
+  out << "}" << std::endl;
+}
+
+/* Reports are written one benchmark per line, so each line is searched for its name and median */
+bool load_benchmark_baseline(const std::string &path, std::map<std::string, double> &medians) {
+  std::ifstream file(path);
+  if(!file.is_open()) return false;
+
+  const std::string name_key = "\"name\": \"";
+  const std::string median_key = "\"median_ns_per_instruction\": ";
+  std::string line;
+  while(std::getline(file, line)) {
+    size_t name_start = line.find(name_key);
+    size_t median_start = line.find(median_key);
+    if(name_start == std::string::npos || median_start == std::string::npos) continue;
+    name_start += name_key.size();
+    size_t name_end = line.find('"', name_start);
+    if(name_end == std::string::npos) return false;
+    medians[line.substr(name_start, name_end - name_start)] = 
+      std::strtod(line.c_str() + median_start + median_key.size(), nullptr);
+  }
+  return true;
+}
\ No newline at end of file
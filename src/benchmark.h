@@ -0,0 +1,55 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <map>
+#include <ostream>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "chip_8.h"
+
+#define DEFAULT_BENCHMARK_REPETITIONS 10
+#define DEFAULT_BENCHMARK_CYCLES 2000000
+/* Slowdown against the baseline, in percent, above which a benchmark is reported as a regression */
+#define DEFAULT_REGRESSION_THRESHOLD 10.0
+
+/* Synthetic ROM looping over one family of instructions forever */
+typedef struct Benchmark_Rom {
+  std::string name;
+  std::vector<uint8_t> program;
+  /* Display wait would make draw loops measure waiting for the 60Hz clock, so it can be turned off */
+  bool display_wait;
+} Benchmark_Rom;
+
+/* Times of every repetition of one ROM on one dispatch */
+typedef struct Benchmark_Result {
+  /* ROM name and dispatch, e.g. alu/threaded */
+  std::string name;
+  uint64_t cycles;
+  std::vector<double> ns_per_instruction;
+  /* Host time of one frame: its cycles, taking the dirty rows and converting them to RGBA */
+  std::vector<double> frame_ns;
+} Benchmark_Result;
+
+/* Summary of a list of timings */
+typedef struct Benchmark_Statistics {
+  double median;
+  double min;
+  double mean;
+  double stddev;
+} Benchmark_Statistics;
+
+/* ROMs for the hot paths: 8XYN arithmetic, DXYN drawing, FX55/FX65 memory traffic and 2NNN/00EE calls */
+std::vector<Benchmark_Rom> benchmark_roms();
+/* 
+  Run the ROM for a number of cycles on the dispatch, once untimed to warm up, then repetition times, 
+  each starting from the same state
+*/
+Benchmark_Result run_benchmark(const Benchmark_Rom &rom, Dispatch_Mode dispatch, uint64_t cycles, uint32_t repetitions);
+Benchmark_Statistics get_statistics(std::vector<double> values);
+/* Write the results as JSON, one benchmark per line */
+void write_benchmark_report(std::ostream &out, const std::vector<Benchmark_Result> &results);
+/* Read the median ns per instruction of every benchmark in a report, returns false if it could not be read */
+bool load_benchmark_baseline(const std::string &path, std::map<std::string, double> &medians);
+
+#endif
\ No newline at end of file
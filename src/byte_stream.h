@@ -0,0 +1,83 @@
+#ifndef BYTE_STREAM_H
+#define BYTE_STREAM_H
+
+#include <cstring>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#define BYTE_BITS 8
+/* Largest value of one byte of a varint, the top bit marks that another byte follows */
+#define VARINT_PAYLOAD 0x7F
+#define VARINT_CONTINUE 0x80
+#define VARINT_SHIFT 7
+
+/* Appends values in little endian */
+class Byte_Writer {
+  public:
+    Byte_Writer(std::vector<uint8_t> &data) : _data(data) {}
+    void put(uint64_t value, uint8_t size) {
+      for(uint8_t i = 0; i < size; i++) {
+        _data.push_back(static_cast<uint8_t>(value >> (i * BYTE_BITS)));
+      }
+    }
+    void put_bytes(const uint8_t *bytes, size_t size) {
+      _data.insert(_data.end(), bytes, bytes + size);
+    }
+    /* Seven bits per byte, lowest first, the top bit set on every byte but the last */
+    void put_varint(uint64_t value) {
+      while(value > VARINT_PAYLOAD) {
+        _data.push_back(static_cast<uint8_t>(value & VARINT_PAYLOAD) | VARINT_CONTINUE);
+        value >>= VARINT_SHIFT;
+      }
+      _data.push_back(static_cast<uint8_t>(value));
+    }
+  private:
+    std::vector<uint8_t> &_data;
+};
+
+/* Reads values in little endian, failing instead of reading past the end */
+class Byte_Reader {
+  public:
+    Byte_Reader(const std::vector<uint8_t> &data) : _data(data), _size(data.size()), _position(0) {}
+    bool get(uint64_t &value, uint8_t size) {
+      if(_position + size > _size) return false;
+      value = 0;
+      for(uint8_t i = 0; i < size; i++) {
+        value |= static_cast<uint64_t>(_data[_position++]) << (i * BYTE_BITS);
+      }
+      return true;
+    }
+    template <typename T>
+    bool get_field(T &field) {
+      uint64_t value;
+      if(!get(value, sizeof(T))) return false;
+      field = static_cast<T>(value);
+      return true;
+    }
+    bool get_bytes(uint8_t *bytes, size_t size) {
+      if(_position + size > _size) return false;
+      std::memcpy(bytes, &_data[_position], size);
+      _position += size;
+      return true;
+    }
+    bool get_varint(uint64_t &value) {
+      value = 0;
+      for(uint8_t shift = 0; shift < sizeof(uint64_t) * BYTE_BITS; shift += VARINT_SHIFT) {
+        if(_position >= _size) return false;
+        uint8_t byte = _data[_position++];
+        value |= static_cast<uint64_t>(byte & VARINT_PAYLOAD) << shift;
+        if(!(byte & VARINT_CONTINUE)) return true;
+      }
+      return false;
+    }
+    size_t get_position() const {
+      return _position;
+    }
+  private:
+    const std::vector<uint8_t> &_data;
+    size_t _size;
+    size_t _position;
+};
+
+#endif
\ No newline at end of file
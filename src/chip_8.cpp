@@ -1,83 +1,513 @@
-#include <fstream>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <random>
 #include "chip_8.h"
+#include "hash.h"
 
-Chip_8::Chip_8(Arguments args) {
-  /* Initialise zeroed out memory */
-  _memory = std::vector<uint8_t>(MEMORY_SIZE, 0);
+/* Handlers for the predecoded instructions, one per instruction */
+struct Instruction_Handlers {
+  template <uint8_t QUIRKS> static void decode(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  static void nop(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  static void op_00E0(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  static void op_00EE(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  static void op_00CN(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  static void op_00DN(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  static void op_00FB(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  static void op_00FC(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  static void op_00FD(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  static void op_00FE(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  static void op_00FF(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  static void op_1NNN(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  static void op_2NNN(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  static void op_3XNN(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  static void op_4XNN(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  static void op_5XY0(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  static void op_5XY2(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  static void op_5XY3(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  static void op_6XNN(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  static void op_7XNN(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  static void op_8XY0(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  template <uint8_t QUIRKS> static void op_8XY1(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  template <uint8_t QUIRKS> static void op_8XY2(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  template <uint8_t QUIRKS> static void op_8XY3(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  static void op_8XY4(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  static void op_8XY5(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  template <uint8_t QUIRKS> static void op_8XY6(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  static void op_8XY7(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  template <uint8_t QUIRKS> static void op_8XYE(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  static void op_9XY0(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  static void op_ANNN(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  template <uint8_t QUIRKS> static void op_BNNN(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  static void op_CXNN(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  template <uint8_t QUIRKS> static void op_DXYN(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  static void op_EX9E(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  static void op_EXA1(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  static void op_F000(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  static void op_FN01(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  static void op_F002(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  static void op_FX07(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  static void op_FX0A(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  static void op_FX15(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  static void op_FX18(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  static void op_FX1E(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  static void op_FX29(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  static void op_FX30(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  static void op_FX33(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  static void op_FX3A(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  template <uint8_t QUIRKS> static void op_FX55(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  template <uint8_t QUIRKS> static void op_FX65(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  static void op_FX75(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+  static void op_FX85(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+};
+
+/* Get the quirk bits for the flags in the arguments */
+uint8_t get_quirks(const Arguments &args) {
+  uint8_t quirks = 0;
+  if(args.dw) quirks |= QUIRK_DW;
+  if(args.vfreset) quirks |= QUIRK_VFRESET;
+  if(args.meminc) quirks |= QUIRK_MEMINC;
+  if(args.clip) quirks |= QUIRK_CLIP;
+  if(args.shiftx) quirks |= QUIRK_SHIFTX;
+  if(args.jumpx) quirks |= QUIRK_JUMPX;
+  return quirks;
+}
+
+/* Set the flags in the arguments from quirk bits */
+void set_quirks(Arguments &args, uint8_t quirks) {
+  args.dw = quirks & QUIRK_DW;
+  args.vfreset = quirks & QUIRK_VFRESET;
+  args.meminc = quirks & QUIRK_MEMINC;
+  args.clip = quirks & QUIRK_CLIP;
+  args.shiftx = quirks & QUIRK_SHIFTX;
+  args.jumpx = quirks & QUIRK_JUMPX;
+}
+
+Chip_8::Chip_8(Arguments args) : _state_storage(new uint8_t[machine_state_size(args.platform)]), 
+  _state(*reinterpret_cast<Machine_State *>(_state_storage.get())) {
+  /* Zero the guest state in use, including padding so copies of it compare and hash the same */
+  std::memset(&_state, 0, machine_state_size(args.platform));
 
-  /* Initialise display with all pixels off */
-  _display = std::vector<std::vector<bool>>(DISPLAY_HEIGHT, 
-    std::vector<bool>(DISPLAY_WIDTH, false));
+  /* Display starts with all pixels off, to be drawn in full the first time */
+  _dirty_rows = ALL_ROWS_DIRTY;
+  _halt = Halt_State::RUNNING;
+  _idle_period = 1;
 
-  /* Set various counters, registers, timers to 0 and initialise stack */
-  _program_counter = PROGRAM_ADDRESS;
-  _index_register = 0;
-  _stack = std::stack<uint16_t>();
-  _delay_timer = 0;
-  _sound_timer = 0;
-  _vs = std::vector<uint8_t>(NUMBER_OF_GENERAL_REGISTERS, 0);
+  _state.program_counter = PROGRAM_ADDRESS;
+  _state.fault = Machine_Fault::NO_FAULT;
+  /* Only the first plane exists before XO-CHIP, and is drawn to until a program selects others */
+  _state.plane_mask = 0x1;
+  /* The buzzer plays a square wave until an XO-CHIP program loads a pattern of its own */
+  std::fill(_state.audio_pattern, _state.audio_pattern + AUDIO_PATTERN_SIZE, DEFAULT_AUDIO_PATTERN_BYTE);
+  _state.pitch = DEFAULT_PITCH;
+  _audio = nullptr;
 
-  /* Initialise random number generator */
-  _mt = std::mt19937(_rand_dev());
-  _uni_int_dist = std::uniform_int_distribution<std::mt19937::result_type>(0, 0xFF);
+  /* Seed the random number generator, from the host unless a seed was given */
+  if(args.seed) {
+    seed_random_state(_state.random_state, *args.seed);
+  } else {
+    std::random_device random_device;
+    seed_random_state(_state.random_state, random_device());
+  }
+  _cycle_count = 0;
+  _rom_hash = FNV_OFFSET_BASIS;
+  _rom_size = 0;
 
   /* Initialise keyboard */
-  _keyboard = std::unordered_map<uint8_t, bool>();
-  _curr_pressed_key = NO_KEY;
+  _state.curr_pressed_key = NO_KEY;
+  _input_latency = Input_Latency{0, std::chrono::nanoseconds(0), std::chrono::nanoseconds(0)};
 
   /* Initialise refresh state */
-  _refresh_state = Refresh_State::FREE;
+  _state.refresh_state = Refresh_State::FREE;
 
   /* Initialise from arguments passed in */
   _file_name = args.file_name;
-  _dw = args.dw;
-  _vfreset = args.vfreset;
-  _meminc = args.meminc;
-  _clip = args.clip;
-  _shiftx = args.shiftx;
-  _jumpx = args.jumpx;
+  _quirks = get_quirks(args);
+  _platform = args.platform;
+  _dispatch = args.dispatch;
+  _address_mask = platform_memory_size(_platform) - 1;
+
+  /* 
+    Create the block translator, falling back to the cached interpreter if it is not available. The 
+    translator covers 4KB of memory and skips of one instruction, so XO-CHIP is always interpreted
+  */
+  if(_dispatch == Dispatch_Mode::JIT && _platform == Platform::XO_CHIP) _dispatch = Dispatch_Mode::THREADED;
+  if(_dispatch == Dispatch_Mode::JIT) {
+    _jit = std::make_unique<Jit>();
+    if(!_jit->is_available()) {
+      _jit.reset();
+      _dispatch = Dispatch_Mode::THREADED;
+    }
+  }
+
+  /* Pick the interpreter compiled for the quirks, once for the lifetime of the machine */
+  _select_quirk_functions<0>(_quirks);
+#if CHIP_8_PROFILER
+  _profiler = nullptr;
+  _run_unprofiled_cycles = _run_cycles;
+#endif
+  _tracer = nullptr;
+  _run_untraced_cycles = _run_cycles;
+  _debugger = nullptr;
+  _run_undebugged_cycles = _run_cycles;
+  _break_remaining = 0;
+  _break_in_frame = false;
+  _resuming = false;
+
+  /* Initialise the instruction cache with nothing decoded yet, the switch dispatch does not use it */
+  if(_dispatch != Dispatch_Mode::SWITCH) {
+    _decode_cache = std::vector<Decoded_Instruction>(platform_memory_size(_platform), _undecoded);
+  }
 
   /* Load font into memory starting at 0x50 */
   uint16_t ptr = FONT_ADDRESS;
   for(const uint8_t &font_data : font) {
-    _memory[ptr++] = font_data;
+    _state.memory[ptr++] = font_data;
+  }
+  /* Load the large font right after it on the platforms that have one */
+  if(_platform != Platform::COSMAC_VIP) {
+    std::copy(large_font.begin(), large_font.end(), _state.memory + LARGE_FONT_ADDRESS);
   }
-
-  /* Set to false as we have yet to write anything to the screen */
-  _has_written = false;
 };
 
+Chip_8::~Chip_8() = default;
+
 /* Load ROM data into memory */
 bool Chip_8::load_ROM() {
-  /* Open file */
-  std::ifstream file(_file_name, std::ios_base::binary);
-  /* If this file does not exist, return false */
-  if(!file.good()) return false;
+  std::vector<uint8_t> rom;
+  return read_rom_file(_file_name, rom) && load_ROM(rom);
+}
 
-  /* Read data byte by byte and store in memory starting from 0x200 */
-  char curr_byte;
-  uint16_t ptr = PROGRAM_ADDRESS;
-  while(file.get(curr_byte)) { 
-    _memory[ptr++] = static_cast<uint8_t>(curr_byte);
-  }
+/* Copies the ROM into memory starting from 0x200 */
+bool Chip_8::load_ROM(const std::vector<uint8_t> &rom) {
+  if(rom.size() > platform_memory_size(_platform) - PROGRAM_ADDRESS) return false;
+  std::copy(rom.begin(), rom.end(), _state.memory + PROGRAM_ADDRESS);
+  _rom_hash = fnv1a_64(rom.data(), rom.size());
+  _rom_size = static_cast<uint32_t>(rom.size());
+
+  /* Drop every cached instruction as the program has changed */
+  std::fill(_decode_cache.begin(), _decode_cache.end(), _undecoded);
+  if(_jit) _jit->flush();
+  _halt = Halt_State::RUNNING;
   return true;
 }
 
+uint64_t Chip_8::get_rom_hash() const {
+  return _rom_hash;
+}
+
+/* Decodes ahead of time exactly what the first run of each instruction would have cached */
+void Chip_8::warm_start(const Rom_Cache &cache) {
+  if(cache.rom_hash != _rom_hash || _dispatch == Dispatch_Mode::SWITCH) return;
+  for(uint32_t address = 0; address < _decode_cache.size(); address++) {
+    if(!address_map_test(cache.instructions, address)) continue;
+    _decode_cache[address] = _decode_function(_platform, _state.memory[address], _state.memory[(address + 1) & _address_mask]);
+  }
+
+  if(!_jit) return;
+  std::vector<uint16_t> block_starts;
+  for(uint32_t address = 0; address < MEMORY_SIZE; address++) {
+    if(address_map_test(cache.blocks, address)) block_starts.push_back(address);
+  }
+  _jit->translate(*this, block_starts);
+}
+
+void Chip_8::fill_rom_cache(Rom_Cache &cache) const {
+  if(cache.rom_hash != _rom_hash) init_rom_cache(cache, _rom_hash, _rom_size, _quirks, _platform);
+  cache.quirks = _quirks;
+  cache.platform = _platform;
+  for(uint32_t address = 0; address < _decode_cache.size(); address++) {
+    if(_decode_cache[address].handler != _undecoded.handler) address_map_set(cache.instructions, address);
+  }
+  if(_jit) {
+    for(uint16_t address : _jit->get_block_starts()) {
+      address_map_set(cache.blocks, address);
+    }
+  }
+}
+
 /* Decreases delay timer if bigger than 0 */
 void Chip_8::decrease_delay_timer() {
-  if(_delay_timer > 0) _delay_timer--;
+  if(_state.delay_timer > 0) _state.delay_timer--;
 };
 
 /* Decreases sound timer if bigger than 0 */
 void Chip_8::decrease_sound_timer() {
-  if(_sound_timer > 0) _sound_timer--;
+  if(_state.sound_timer > 0) _state.sound_timer--;
 };
 
 /* Runs one Fetch, decode, execute cycle */
 void Chip_8::run_cycle() {
+  run_cycles(1);
+}
+
+/* 
+  Runs a number of cycles with the loop chosen for the dispatch and quirks. Key events and the vertical 
+  blank only arrive between batches of cycles, so once halted the rest of the batch would run the same 
+  instruction to the same state and is skipped, though still counted. An idle loop comes back to the same 
+  state every pass, so only the cycles left over after its whole passes are run. The cycle count is kept 
+  up to date between the runs, so it is the cycle of the first instruction of each. A BREAK leaves the 
+  rest of the batch unrun and uncounted, for resume_frame
+*/
+void Chip_8::run_cycles(uint32_t count) {
+  uint64_t end_cycle = _cycle_count + count;
+  uint32_t remaining = count;
+  _break_in_frame = false;
+  while(remaining > 0) {
+    uint32_t ran = (this->*_run_cycles)(remaining);
+    _cycle_count += ran;
+    remaining -= ran;
+    if(_halt == Halt_State::BREAK) {
+      _break_remaining = remaining;
+      return;
+    }
+    if(_halt != Halt_State::IDLE) break;
+    _halt = Halt_State::RUNNING;
+    _cycle_count += remaining - remaining % _idle_period;
+    remaining %= _idle_period;
+  }
+  _cycle_count = end_cycle;
+}
+
+/* 
+  Finds the combination matching the quirks by walking up from QUIRKS, and picks the switch 
+  interpreter and decoder compiled for it 
+*/
+template <uint8_t QUIRKS>
+void Chip_8::_select_quirk_functions(uint8_t quirks) {
+  if constexpr(QUIRKS < QUIRK_COMBINATIONS) {
+    if(quirks != QUIRKS) {
+      _select_quirk_functions<QUIRKS + 1>(quirks);
+      return;
+    }
+
+    _undecoded = Decoded_Instruction{&Instruction_Handlers::decode<QUIRKS>, 0, 0, 0, 0, 0};
+    _decode_function = &Chip_8::_decode<QUIRKS>;
+    switch(_dispatch) {
+      case Dispatch_Mode::SWITCH:
+        _run_cycles = &Chip_8::_run_switch_cycles<QUIRKS>;
+        break;
+      case Dispatch_Mode::THREADED:
+        _run_cycles = &Chip_8::_run_threaded_cycles;
+        break;
+      case Dispatch_Mode::JIT:
+        _run_cycles = &Chip_8::_run_jit_cycles;
+        break;
+    }
+  }
+}
+
+/* Runs cycles through the opcode switch */
+template <uint8_t QUIRKS>
+uint32_t Chip_8::_run_switch_cycles(uint32_t count) {
+  uint32_t i = 0;
+  while(i < count && _halt == Halt_State::RUNNING) {
+    _run_switch_cycle<QUIRKS>();
+    i++;
+  }
+  return i;
+}
+
+/* Runs cycles from the instruction cache */
+uint32_t Chip_8::_run_threaded_cycles(uint32_t count) {
+  uint32_t i = 0;
+  while(i < count && _halt == Halt_State::RUNNING) {
+    _run_threaded_cycle();
+    i++;
+  }
+  return i;
+}
+
+/* Runs cycles with the block translator */
+uint32_t Chip_8::_run_jit_cycles(uint32_t count) {
+  return _jit->run(*this, count);
+}
+
+#if CHIP_8_PROFILER
+/* 
+  Translated blocks run many instructions in one call, so while profiling the JIT dispatch 
+  steps through the instruction cache instead
+*/
+void Chip_8::set_profiler(Profiler *profiler) {
+  _profiler = profiler;
+  _select_quirk_functions<0>(_quirks);
+  if(profiler) {
+    _run_unprofiled_cycles = _dispatch == Dispatch_Mode::JIT ? &Chip_8::_run_threaded_cycles : _run_cycles;
+    _run_cycles = &Chip_8::_run_profiled_cycles;
+  }
+  if(_tracer) set_tracer(_tracer);
+}
+
+/* 
+  Records each instruction after it ran, so calls, returns and jumps can be told apart by where they went. 
+  Idle loops are run pass by pass, as skipping them would leave the hottest loops out of the counts
+*/
+uint32_t Chip_8::_run_profiled_cycles(uint32_t count) {
+  uint32_t i = 0;
+  for(; i < count && _halt == Halt_State::RUNNING; i++) {
+    uint16_t address = _state.program_counter & _address_mask;
+    uint16_t opcode = (_state.memory[address] << BYTE_SIZE) | _state.memory[(address + 1) & _address_mask];
+    uint8_t stack_pointer = _state.stack_pointer;
+    (this->*_run_unprofiled_cycles)(1);
+    if(_halt == Halt_State::IDLE) _halt = Halt_State::RUNNING;
+    _profiler->record(address, opcode, _state.program_counter & _address_mask, 
+      static_cast<int8_t>(_state.stack_pointer - stack_pointer));
+  }
+  return i;
+}
+#endif
+
+/* 
+  Traces on top of whichever loop was chosen, the profiled one included. As with the profiler, the JIT 
+  dispatch steps through the instruction cache while tracing
+*/
+void Chip_8::set_tracer(Tracer *tracer) {
+  _tracer = tracer;
+  if(_run_cycles == &Chip_8::_run_traced_cycles) _run_cycles = _run_untraced_cycles;
+  if(!tracer) return;
+  _run_untraced_cycles = _run_cycles == &Chip_8::_run_jit_cycles ? &Chip_8::_run_threaded_cycles : _run_cycles;
+  _run_cycles = &Chip_8::_run_traced_cycles;
+}
+
+/* 
+  Records each instruction after it ran, comparing the registers with a copy from before it. The memory 
+  an instruction writes is known from its opcode and the index register before it ran. Idle loops are 
+  run pass by pass, so every instruction run is in the trace
+*/
+uint32_t Chip_8::_run_traced_cycles(uint32_t count) {
+  uint32_t i = 0;
+  for(; i < count && _halt == Halt_State::RUNNING; i++) {
+    uint16_t address = _state.program_counter & _address_mask;
+    uint16_t opcode = (_state.memory[address] << BYTE_SIZE) | _state.memory[(address + 1) & _address_mask];
+    uint16_t index_register = _state.index_register;
+    uint8_t vs[NUMBER_OF_GENERAL_REGISTERS];
+    memcpy(vs, _state.vs, NUMBER_OF_GENERAL_REGISTERS);
+    (this->*_run_untraced_cycles)(1);
+    if(_halt == Halt_State::IDLE) _halt = Halt_State::RUNNING;
+
+    Trace_Record record;
+    record.cycle = static_cast<uint32_t>(_cycle_count + i);
+    record.address = address;
+    record.opcode = opcode;
+    record.index_register = _state.index_register;
+    uint16_t read_length;
+    uint16_t write_length;
+    _memory_access(opcode, read_length, write_length);
+    record.write_address = write_length ? index_register : 0;
+    record.write_length = static_cast<uint8_t>(write_length);
+
+    record.changed_register = TRACE_NO_REGISTER;
+    for(uint8_t v = 0; v < NUMBER_OF_GENERAL_REGISTERS; v++) {
+      if(vs[v] == _state.vs[v]) continue;
+      record.changed_register = v;
+      break;
+    }
+    record.register_value = record.changed_register == TRACE_NO_REGISTER ? 0 : _state.vs[record.changed_register];
+    record.flag_register = _state.vs[0xF];
+    _tracer->record(record);
+  }
+  return i;
+}
+
+/* 
+  The checking loop is only swapped in while the debugger has something to stop on, so a machine with 
+  no breakpoints, watchpoints or step runs its usual loop. As with the tracer, the JIT dispatch steps 
+  through the instruction cache while it is checked
+*/
+void Chip_8::set_debugger(Debugger *debugger) {
+  _debugger = debugger;
+  if(_run_cycles == &Chip_8::_run_debugged_cycles) _run_cycles = _run_undebugged_cycles;
+  if(!debugger || !debugger->is_active()) return;
+  _run_undebugged_cycles = _run_cycles == &Chip_8::_run_jit_cycles ? &Chip_8::_run_threaded_cycles : _run_cycles;
+  _run_cycles = &Chip_8::_run_debugged_cycles;
+}
+
+/* 
+  Breakpoints stop before the instruction runs, watchpoints and steps after it, so the machine is always 
+  stopped between two instructions. Idle loops are run pass by pass, as skipping them could skip a stop
+*/
+uint32_t Chip_8::_run_debugged_cycles(uint32_t count) {
+  uint32_t i = 0;
+  while(i < count && _halt == Halt_State::RUNNING) {
+    uint16_t address = _state.program_counter & _address_mask;
+    if(_debugger->is_breakpoint(address) && !_resuming) {
+      _debugger->stop(Stop_Reason::BREAKPOINT, address);
+      _halt = Halt_State::BREAK;
+      break;
+    }
+    _resuming = false;
+
+    bool watched = false;
+    if(_debugger->has_watchpoints()) {
+      uint16_t opcode = (_state.memory[address] << BYTE_SIZE) | _state.memory[(address + 1) & _address_mask];
+      uint16_t read_length;
+      uint16_t write_length;
+      _memory_access(opcode, read_length, write_length);
+      watched = 
+        _debugger->check_watchpoints(_state.index_register, read_length, _address_mask, Watch_Kind::WATCH_READ) ||
+        _debugger->check_watchpoints(_state.index_register, write_length, _address_mask, Watch_Kind::WATCH_WRITE);
+    }
+
+    (this->*_run_undebugged_cycles)(1);
+    i++;
+    if(_halt == Halt_State::IDLE) _halt = Halt_State::RUNNING;
+    if(_halt != Halt_State::RUNNING) break;
+    if(watched) {
+      _debugger->stop(Stop_Reason::WATCHPOINT, address);
+      _halt = Halt_State::BREAK;
+    } else if(_debugger->take_step()) {
+      _debugger->stop(Stop_Reason::STEP, _state.program_counter & _address_mask);
+      _halt = Halt_State::BREAK;
+    }
+  }
+  return i;
+}
+
+/* 
+  DXYN reads a sprite for each selected plane, FX65 and XO-CHIP 5XY3 load registers and F002 loads the 
+  audio pattern. FX33 stores three digits, FX55 and XO-CHIP 5XY2 store registers
+*/
+void Chip_8::_memory_access(uint16_t opcode, uint16_t &read_length, uint16_t &write_length) const {
+  read_length = 0;
+  write_length = 0;
+  uint8_t x = (opcode >> 8) & 0xF;
+  uint8_t y = (opcode >> 4) & 0xF;
+  uint8_t n = opcode & 0xF;
+  bool xo_chip = _platform == Platform::XO_CHIP;
+  uint8_t range = (x > y ? x - y : y - x) + 1;
+  if((opcode & 0xF000) == 0xD000) {
+    uint16_t sprite_size = n == 0 && _platform != Platform::COSMAC_VIP ? 
+      LARGE_SPRITE_WIDTH * LARGE_SPRITE_WIDTH / SPRITE_WIDTH : n;
+    read_length = sprite_size * __builtin_popcount(_state.plane_mask);
+  } else if((opcode & 0xF0FF) == 0xF065) {
+    read_length = x + 1;
+  } else if((opcode & 0xF00F) == 0x5003 && xo_chip) {
+    read_length = range;
+  } else if(opcode == 0xF002 && xo_chip) {
+    read_length = AUDIO_PATTERN_SIZE;
+  } else if((opcode & 0xF0FF) == 0xF033) {
+    write_length = 3;
+  } else if((opcode & 0xF0FF) == 0xF055) {
+    write_length = x + 1;
+  } else if((opcode & 0xF00F) == 0x5002 && xo_chip) {
+    write_length = range;
+  }
+}
+
+/* Runs one cycle of the cached instruction at the program counter */
+void Chip_8::_run_threaded_cycle() {
+  /* Copy the entry as the handler may invalidate it by writing to memory */
+  const Decoded_Instruction instruction = _decode_cache[_state.program_counter & _address_mask];
+  _state.program_counter += INSTRUCTION_SIZE;
+  instruction.handler(*this, instruction);
+}
+
+/* Runs one Fetch, decode, execute cycle through the opcode switch */
+template <uint8_t QUIRKS>
+void Chip_8::_run_switch_cycle() {
   /* Fetch - Read two successive bytes and increment PC by 2 */
-  uint8_t first_byte = _memory[_program_counter++];
-  uint8_t second_byte = _memory[_program_counter++];
+  uint8_t first_byte = _state.memory[_state.program_counter++ & _address_mask];
+  uint8_t second_byte = _state.memory[_state.program_counter++ & _address_mask];
 
   /* Decode - Bit mask the first nibble for the opcode, and last 3 nibbles for the operand */
   uint8_t opcode = (first_byte & FRONT_NIBBLE_MASK) >> NIBBLE_SIZE;
@@ -94,11 +524,11 @@ void Chip_8::run_cycle() {
           /* 00EE - Return from subroutine */
           {
             /* Pop return address from stack */
-            uint16_t return_addr = _stack.top();
-            _stack.pop();
+            uint16_t return_addr;
+            if(!_pop_stack(return_addr)) break;
 
             /* Set pc to return address */
-            _program_counter = return_addr;
+            _state.program_counter = return_addr;
           }
           break;
 
@@ -106,6 +536,50 @@ void Chip_8::run_cycle() {
           /* 00E0 - Clear screen instruction */
           Chip_8::clear_screen_data();
           break;
+
+        case 0xFB:
+          /* 00FB - Scroll the display right by 4 pixels */
+          if(_platform == Platform::COSMAC_VIP) break;
+          scroll_right(_state.display, _state.plane_mask, HORIZONTAL_SCROLL);
+          _dirty_rows = ALL_ROWS_DIRTY;
+          break;
+
+        case 0xFC:
+          /* 00FC - Scroll the display left by 4 pixels */
+          if(_platform == Platform::COSMAC_VIP) break;
+          scroll_left(_state.display, _state.plane_mask, HORIZONTAL_SCROLL);
+          _dirty_rows = ALL_ROWS_DIRTY;
+          break;
+
+        case 0xFD:
+          /* 00FD - Exit the interpreter, which holds the program counter on this instruction */
+          if(_platform != Platform::COSMAC_VIP) {
+            _state.program_counter -= INSTRUCTION_SIZE;
+            _halt = Halt_State::STOPPED;
+          }
+          break;
+
+        case 0xFE:
+          /* 00FE - Switch to the 64x32 mode */
+          if(_platform != Platform::COSMAC_VIP) _set_hires(false);
+          break;
+
+        case 0xFF:
+          /* 00FF - Switch to the 128x64 mode */
+          if(_platform != Platform::COSMAC_VIP) _set_hires(true);
+          break;
+
+        default:
+          if(op2 == 0xC && _platform != Platform::COSMAC_VIP) {
+            /* 00CN - Scroll the display down by N rows */
+            scroll_down(_state.display, _state.plane_mask, op3);
+            _dirty_rows = ALL_ROWS_DIRTY;
+          } else if(op2 == 0xD && _platform == Platform::XO_CHIP) {
+            /* 00DN - Scroll the display up by N rows */
+            scroll_up(_state.display, _state.plane_mask, op3);
+            _dirty_rows = ALL_ROWS_DIRTY;
+          }
+          break;
       }
       break;
     
@@ -114,7 +588,7 @@ void Chip_8::run_cycle() {
       /* Concat the three opcodes*/
       {
         uint16_t new_pc = (op1 << (NIBBLE_SIZE * 2)) | (op2 << NIBBLE_SIZE) | op3;
-        _program_counter = new_pc;
+        _jump(new_pc, (_state.program_counter - INSTRUCTION_SIZE) & _address_mask);
       }
       break;
     
@@ -122,115 +596,123 @@ void Chip_8::run_cycle() {
       /* 2NNN - Call subroutine at location NNN */
       {
         /* Push current pc to stack */
-        _stack.push(_program_counter);
+        if(!_push_stack(_state.program_counter)) break;
         /* Get the address of the subroutine */
         uint16_t subroutine_addr = (op1 << (NIBBLE_SIZE * 2)) | (op2 << NIBBLE_SIZE) | op3;
         /* Set pc to the subroutine address */
-        _program_counter = subroutine_addr;
+        _state.program_counter = subroutine_addr;
       }
       break;
 
     case 0x3:
       /* 3XNN - Skip one instruction if vX == NN */
-      if(_vs[op1] == second_byte) _program_counter += 2;
+      if(_state.vs[op1] == second_byte) _skip_instruction();
       break;
 
     case 0x4:
       /* 4XNN - Skip one instruction if vX != NN */
-        if(_vs[op1] != second_byte) _program_counter += 2;
+        if(_state.vs[op1] != second_byte) _skip_instruction();
         break;
 
     case 0x5:
-      /* 5XY0 - Skips one instruction is vX == vY */
-      if(_vs[op1] == _vs[op2]) _program_counter += 2;
+      if(op3 == 0x2 && _platform == Platform::XO_CHIP) {
+        /* 5XY2 - Store vX to vY in memory starting at index register */
+        _store_register_range(op1, op2);
+      } else if(op3 == 0x3 && _platform == Platform::XO_CHIP) {
+        /* 5XY3 - Load vX to vY from memory starting at index register */
+        _load_register_range(op1, op2);
+      } else {
+        /* 5XY0 - Skips one instruction is vX == vY */
+        if(_state.vs[op1] == _state.vs[op2]) _skip_instruction();
+      }
       break;
     
     case 0x6:
       /* 6XNN - Sets the register defined by X to the value defined by the last byte */
-      _vs[op1] = second_byte;
+      _state.vs[op1] = second_byte;
       break;
     
     case 0x7:
       /* 7XNN - Adds the value defined by the last byte to the register defined by X */
-      _vs[op1] += second_byte;
+      _state.vs[op1] += second_byte;
       break;
 
     case 0x8:
       switch(op3) {
         case 0x0:
           /* 8XY0 - vX = vY*/
-          _vs[op1] = _vs[op2];
+          _state.vs[op1] = _state.vs[op2];
           break;
         
         case 0x1:
           /* 8XY1 - vX = vX | vY*/
-          _vs[op1] = _vs[op1] | _vs[op2];
-          if(_vfreset) _vs[FLAG_REG] = 0;
+          _state.vs[op1] = _state.vs[op1] | _state.vs[op2];
+          if constexpr(QUIRKS & QUIRK_VFRESET) _state.vs[FLAG_REG] = 0;
           break;
 
         case 0x2:
           /* 8XY2 - vX = vX & vY*/
-          _vs[op1] = _vs[op1] & _vs[op2];
-          if(_vfreset) _vs[FLAG_REG] = 0;
+          _state.vs[op1] = _state.vs[op1] & _state.vs[op2];
+          if constexpr(QUIRKS & QUIRK_VFRESET) _state.vs[FLAG_REG] = 0;
           break;
 
         case 0x3:
           /* 8XY3 - vX = vX ^ vY*/
-          _vs[op1] = _vs[op1] ^ _vs[op2];
-          if(_vfreset) _vs[FLAG_REG] = 0;
+          _state.vs[op1] = _state.vs[op1] ^ _state.vs[op2];
+          if constexpr(QUIRKS & QUIRK_VFRESET) _state.vs[FLAG_REG] = 0;
           break;
 
         case 0x4:
           {
             /* 8XY4 - vX += vY */
-            uint initial_val = _vs[op1];
-            _vs[op1] += _vs[op2];
+            uint initial_val = _state.vs[op1];
+            _state.vs[op1] += _state.vs[op2];
             /* If overflow has happened, set the flag register to 1, otherwise 0 */
-            _vs[FLAG_REG] = (_vs[op1] < initial_val ? 1 : 0);
+            _state.vs[FLAG_REG] = (_state.vs[op1] < initial_val ? 1 : 0);
           }
           break;
 
         case 0x5:
           {
             /* 8XY5 - vX = vX - vY */
-            uint8_t initial_value = _vs[op1];
-            _vs[op1] = _vs[op1] - _vs[op2];
+            uint8_t initial_value = _state.vs[op1];
+            _state.vs[op1] = _state.vs[op1] - _state.vs[op2];
             /* If underflow has happened, set flag register to 0, otherwise 1 */
-            _vs[FLAG_REG] = (_vs[op1] > initial_value ? 0 : 1);
+            _state.vs[FLAG_REG] = (_state.vs[op1] > initial_value ? 0 : 1);
           }
           break;
         
         case 0x6:
           {
             /* 8XY6 - set vX = vY, then shift vX 1 bit to the right */
-            if(!_shiftx) _vs[op1] = _vs[op2];
+            if constexpr(!(QUIRKS & QUIRK_SHIFTX)) _state.vs[op1] = _state.vs[op2];
             /* Get bit that will be shifted out */
-            uint8_t shifted_bit = _vs[op1] & BIT_MASK;
-            _vs[op1] >>= 1;
+            uint8_t shifted_bit = _state.vs[op1] & BIT_MASK;
+            _state.vs[op1] >>= 1;
             /* Set flag register to the bit that was shifted out */
-            _vs[FLAG_REG] = shifted_bit;
+            _state.vs[FLAG_REG] = shifted_bit;
           }
           break;
 
         case 0x7:
           {
             /* 8XY7 - vX = vY - vX */
-            uint8_t initial_value = _vs[op2];
-            _vs[op1] = _vs[op2] - _vs[op1];
+            uint8_t initial_value = _state.vs[op2];
+            _state.vs[op1] = _state.vs[op2] - _state.vs[op1];
             /* If underflow has happened, set flag register to 0, otherwise 1 */
-            _vs[FLAG_REG] = (_vs[op1] > initial_value ? 0 : 1);
+            _state.vs[FLAG_REG] = (_state.vs[op1] > initial_value ? 0 : 1);
           }
           break;
 
         case 0xE:
           {
             /* 8XYE - set vX = vY, then shift vX 1 bit to the left */
-            if(!_shiftx) _vs[op1] = _vs[op2];
+            if constexpr(!(QUIRKS & QUIRK_SHIFTX)) _state.vs[op1] = _state.vs[op2];
             /* Get bit that will be shifted out */
-            uint8_t shifted_bit = (_vs[op1] & (BIT_MASK << (BYTE_SIZE - 1))) >> (BYTE_SIZE - 1);
-            _vs[op1] <<= 1;
+            uint8_t shifted_bit = (_state.vs[op1] & (BIT_MASK << (BYTE_SIZE - 1))) >> (BYTE_SIZE - 1);
+            _state.vs[op1] <<= 1;
             /* Set flag register to the bit that was shifted out */
-            _vs[FLAG_REG] = shifted_bit;
+            _state.vs[FLAG_REG] = shifted_bit;
           }
           break;
       }
@@ -238,7 +720,7 @@ void Chip_8::run_cycle() {
 
     case 0x9:
       /* 9XY0 - Skips one instruction is vX != vY */
-      if(_vs[op1] != _vs[op2]) _program_counter += 2;
+      if(_state.vs[op1] != _state.vs[op2]) _skip_instruction();
       break;
 
     case 0xA:
@@ -246,7 +728,7 @@ void Chip_8::run_cycle() {
       /* Concat the three opcodes*/
       {
         uint16_t new_index = (op1 << (NIBBLE_SIZE * 2)) | (op2 << NIBBLE_SIZE) | op3;
-        _index_register = new_index;
+        _state.index_register = new_index;
       }
       break;
     
@@ -255,21 +737,21 @@ void Chip_8::run_cycle() {
       {
         uint16_t new_address;
         new_address = (op1 << (NIBBLE_SIZE * 2)) | (op2 << NIBBLE_SIZE) | op3;
-        if(_jumpx) {
-          new_address += _vs[op1];
+        if constexpr(QUIRKS & QUIRK_JUMPX) {
+          new_address += _state.vs[op1];
         } else {
-          new_address += _vs[0];
+          new_address += _state.vs[0];
         }
-        _program_counter = new_address;
+        _state.program_counter = new_address;
       }
       break;
 
     case 0xC:
       /* CXNN - Generates a random number, bitwise AND with the value NN and stores in vX */
       {
-        uint8_t random_number = _uni_int_dist(_mt);
+        uint8_t random_number = next_random_byte(_state.random_state);
         random_number &= second_byte;
-        _vs[op1] = random_number;
+        _state.vs[op1] = random_number;
       }
       break;
 
@@ -278,107 +760,80 @@ void Chip_8::run_cycle() {
         DXYN - Draws sprite N tall starting at the coordinates (x, y) 
         from the registers defined by X and Y respectively 
       */
-      /* Get x and y from their respective registers */
-      {
-        if(_dw) {
-          switch(_refresh_state) {
-            case Refresh_State::FREE:
-              _refresh_state = Refresh_State::WAITING;
-              _program_counter -= INSTRUCTION_SIZE;
-              break;
-            
-            case Refresh_State::WAITING:
-              _program_counter -= INSTRUCTION_SIZE;
-              break;
-
-            case Refresh_State::REFRESH_FINISHED:
-              _refresh_state = Refresh_State::FREE;
-              _draw_sprite(op1, op2, op3);
-              break;
-          }
-        } else {
-          _draw_sprite(op1, op2, op3);
-        }
-      }
+      _draw_sprite_with_wait<QUIRKS>(op1, op2, op3);
       break;
     
     case 0xE:
       switch(second_byte) {
         case 0x9E:
           /* EX9E - Skip one instruction if the key corresponding to the value in vX is pressed */
-          if(_keyboard[_vs[op1]]) _program_counter += INSTRUCTION_SIZE;
+          if(_state.vs[op1] < NUMBER_OF_KEYS && (_state.keypad & (1 << _state.vs[op1]))) _skip_instruction();
           break;
 
         case 0xA1:
           /* EXA1 - Skip one instruction if the key corresponding to the value in vX is not pressed */
-          if(!_keyboard[_vs[op1]]) _program_counter += INSTRUCTION_SIZE;
+          if(_state.vs[op1] >= NUMBER_OF_KEYS || !(_state.keypad & (1 << _state.vs[op1]))) _skip_instruction();
           break;
       }
       break;
 
     case 0xF:
       switch(second_byte) {
+        case 0x00:
+          /* F000 NNNN - Set the index register to the address NNNN */
+          if(op1 == 0x0 && _platform == Platform::XO_CHIP) _load_long_index();
+          break;
+
+        case 0x01:
+          /* FN01 - Select the planes drawn to by their mask N */
+          if(_platform == Platform::XO_CHIP) _state.plane_mask = op1;
+          break;
+
+        case 0x02:
+          /* F002 - Load the audio pattern from memory starting at index register */
+          if(op1 == 0x0 && _platform == Platform::XO_CHIP) _load_audio_pattern();
+          break;
+
         case 0x0A:
           /* FX0A - Blocks until a character is pressed (by decrementing program counter) and sets vX to it */
-          {
-            bool key_is_pressed = false;
-            for(const std::pair<const uint8_t, bool> &key : _keyboard) {
-              key_is_pressed |= key.second;
-            }
-
-            if(!key_is_pressed && _curr_pressed_key == NO_KEY) {
-              /* If no key is pressed, block */
-              _program_counter -= INSTRUCTION_SIZE;
-            } else if(_curr_pressed_key == NO_KEY) {
-              /* If a key has been pressed, find the key */
-              for(const std::pair<const uint8_t, bool> &key : _keyboard) {
-                if(key.second) {
-                  _curr_pressed_key = key.first;
-                  break;
-                }
-              }
-              _program_counter -= INSTRUCTION_SIZE;
-            } else {
-              /* If the key is still being pressed, block */
-              if(_keyboard[_curr_pressed_key]) {
-                _program_counter -= INSTRUCTION_SIZE;
-              } else {
-                /* Set vX to the key that was pressed and released */
-                _vs[op1] = _curr_pressed_key;
-                _curr_pressed_key = NO_KEY;
-              }
-            }
-          }
+          _wait_for_key(op1);
           break;
 
         case 0x07:
           /* FX07 - Set vX to the value of the delay timer */
-          _vs[op1] = _delay_timer;
+          _state.vs[op1] = _state.delay_timer;
           break;
 
         case 0x15:
           /* FX15 - Set delay timer to the value in vX */
-          _delay_timer = _vs[op1];
+          _state.delay_timer = _state.vs[op1];
           break;
 
         case 0x18:
           /* FX18 - Set sound timer to the value in vX */
-          _sound_timer = _vs[op1];
+          _state.sound_timer = _state.vs[op1];
           break;
 
         case 0x1E:
           /* FX1E - Add vX to index register */
-          _index_register += _vs[op1];
+          _state.index_register += _state.vs[op1];
           /* 
             If index register goes above 0x1000 (the normal addressing range), 
-            set flag register 
+            set flag register. XO-CHIP addresses all 64KB, so it is never past it
           */
-          if(_index_register > ADDRESS_RANGE) _vs[FLAG_REG] = 1;
+          if(_state.index_register > platform_memory_size(_platform)) _state.vs[FLAG_REG] = 1;
           break;
 
         case 0x29:
           /* FX29 - Set index register to the font of the character stored in vX */
-          _index_register = FONT_ADDRESS + (_vs[op1] * FONT_SIZE);
+          _state.index_register = FONT_ADDRESS + (_state.vs[op1] * FONT_SIZE);
+          break;
+
+        case 0x30:
+          /* FX30 - Set index register to the large font of the digit stored in vX */
+          if(_platform != Platform::COSMAC_VIP) {
+            _state.index_register = LARGE_FONT_ADDRESS + (_state.vs[op1] & BACK_NIBBLE_MASK) * LARGE_FONT_SIZE;
+          }
           break;
       
         case 0x33:
@@ -387,7 +842,7 @@ void Chip_8::run_cycle() {
               FX33 - Split number in vX into each digit and store in memory starting 
               at index register 
             */
-            int num = _vs[op1];
+            int num = _state.vs[op1];
             std::vector<int> digits;
             /* Split into units, tens and hundreds and store in digits (reversed) */
             for(int i = 0; i < 3; i++) {
@@ -397,99 +852,878 @@ void Chip_8::run_cycle() {
 
             /* Store into memory starting at index register */
             for(int i = 0; i < 3; i++) {
-              _memory[_index_register + i] = digits[digits.size() - 1 - i];
+              _write_memory(_state.index_register + i, digits[digits.size() - 1 - i]);
             }
           }
           break;
 
+        case 0x3A:
+          /* FX3A - Set the pitch the audio pattern is played at to vX */
+          if(_platform == Platform::XO_CHIP) _state.pitch = _state.vs[op1];
+          break;
+
         case 0x55:
           /* FX55 - Store registers v0 to vX into memory starting at index register */
-          if(_meminc) {
+          if constexpr(QUIRKS & QUIRK_MEMINC) {
             for(int i = 0; i <= op1; i++) {
-              _memory[_index_register++] = _vs[i];
+              _write_memory(_state.index_register++, _state.vs[i]);
             }
           } else {
             for(int i = 0; i <= op1; i++) {
-              _memory[_index_register + i] = _vs[i];
+              _write_memory(_state.index_register + i, _state.vs[i]);
             }
           }
           break;
 
         case 0x65:
           /* FX65 - Load registers v0 to vX from memory starting at index register */
-          if(_meminc) {
+          if constexpr(QUIRKS & QUIRK_MEMINC) {
             for(int i = 0; i <= op1; i++) {
-              _vs[i] = _memory[_index_register++];
+              _state.vs[i] = _state.memory[_state.index_register++ & _address_mask];
             }
           } else {
             for(int i = 0; i <= op1; i++) {
-              _vs[i] = _memory[_index_register + i];
+              _state.vs[i] = _state.memory[(_state.index_register + i) & _address_mask];
             }
           }
           break;
+
+        case 0x75:
+          /* FX75 - Store registers v0 to vX in the flag registers */
+          if(_platform != Platform::COSMAC_VIP) std::copy(_state.vs, _state.vs + op1 + 1, _state.flag_registers);
+          break;
+
+        case 0x85:
+          /* FX85 - Load registers v0 to vX from the flag registers */
+          if(_platform != Platform::COSMAC_VIP) std::copy(_state.flag_registers, _state.flag_registers + op1 + 1, _state.vs);
+          break;
       }
       break;
   }
 }
 
-/* Draw sprite to _display */
-void Chip_8::_draw_sprite(uint8_t op1, uint8_t op2, uint8_t op3) {
-  uint8_t x = _vs[op1] % DISPLAY_WIDTH;
-  uint8_t y = _vs[op2] % DISPLAY_HEIGHT;
+/* Decodes the two bytes into a handler and its operands */
+template <uint8_t QUIRKS>
+Decoded_Instruction Chip_8::_decode(Platform platform, uint8_t first_byte, uint8_t second_byte) {
+  uint8_t opcode = (first_byte & FRONT_NIBBLE_MASK) >> NIBBLE_SIZE;
 
-  /* Set flag register to 0 */
-  _vs[FLAG_REG] = 0;
+  Decoded_Instruction instruction;
+  instruction.handler = &Instruction_Handlers::nop;
+  instruction.x = first_byte & BACK_NIBBLE_MASK;
+  instruction.y = (second_byte & FRONT_NIBBLE_MASK) >> NIBBLE_SIZE;
+  instruction.n = second_byte & BACK_NIBBLE_MASK;
+  instruction.nn = second_byte;
+  instruction.nnn = (instruction.x << (NIBBLE_SIZE * 2)) | second_byte;
 
-  for(uint16_t i = 0; i < static_cast<uint16_t>(op3); i++) {
-    uint8_t sprite_data = _memory[_index_register + i];
-    for(uint16_t j = 0; j < BYTE_SIZE; j++) {
-      /* Get current sprite pixel */
-      uint8_t sprite_pixel = (sprite_data & (BIT_MASK << (BYTE_SIZE - 1 - j))) >> (BYTE_SIZE - 1 - j);
-      uint8_t display_pixel = _display[(y + i) % DISPLAY_HEIGHT][(x + j) % DISPLAY_WIDTH];
+  switch(opcode) {
+    case 0x0:
+      if(second_byte == 0xE0) instruction.handler = &Instruction_Handlers::op_00E0;
+      if(second_byte == 0xEE) instruction.handler = &Instruction_Handlers::op_00EE;
+      if(platform == Platform::COSMAC_VIP) break;
+      switch(second_byte) {
+        case 0xFB: instruction.handler = &Instruction_Handlers::op_00FB; break;
+        case 0xFC: instruction.handler = &Instruction_Handlers::op_00FC; break;
+        case 0xFD: instruction.handler = &Instruction_Handlers::op_00FD; break;
+        case 0xFE: instruction.handler = &Instruction_Handlers::op_00FE; break;
+        case 0xFF: instruction.handler = &Instruction_Handlers::op_00FF; break;
+      }
+      if(instruction.y == 0xC) instruction.handler = &Instruction_Handlers::op_00CN;
+      if(instruction.y == 0xD && platform == Platform::XO_CHIP) instruction.handler = &Instruction_Handlers::op_00DN;
+      break;
+    case 0x1: instruction.handler = &Instruction_Handlers::op_1NNN; break;
+    case 0x2: instruction.handler = &Instruction_Handlers::op_2NNN; break;
+    case 0x3: instruction.handler = &Instruction_Handlers::op_3XNN; break;
+    case 0x4: instruction.handler = &Instruction_Handlers::op_4XNN; break;
+    case 0x5:
+      instruction.handler = &Instruction_Handlers::op_5XY0;
+      if(platform != Platform::XO_CHIP) break;
+      if(instruction.n == 0x2) instruction.handler = &Instruction_Handlers::op_5XY2;
+      if(instruction.n == 0x3) instruction.handler = &Instruction_Handlers::op_5XY3;
+      break;
+    case 0x6: instruction.handler = &Instruction_Handlers::op_6XNN; break;
+    case 0x7: instruction.handler = &Instruction_Handlers::op_7XNN; break;
+    case 0x8:
+      switch(instruction.n) {
+        case 0x0: instruction.handler = &Instruction_Handlers::op_8XY0; break;
+        case 0x1: instruction.handler = &Instruction_Handlers::op_8XY1<QUIRKS>; break;
+        case 0x2: instruction.handler = &Instruction_Handlers::op_8XY2<QUIRKS>; break;
+        case 0x3: instruction.handler = &Instruction_Handlers::op_8XY3<QUIRKS>; break;
+        case 0x4: instruction.handler = &Instruction_Handlers::op_8XY4; break;
+        case 0x5: instruction.handler = &Instruction_Handlers::op_8XY5; break;
+        case 0x6: instruction.handler = &Instruction_Handlers::op_8XY6<QUIRKS>; break;
+        case 0x7: instruction.handler = &Instruction_Handlers::op_8XY7; break;
+        case 0xE: instruction.handler = &Instruction_Handlers::op_8XYE<QUIRKS>; break;
+      }
+      break;
+    case 0x9: instruction.handler = &Instruction_Handlers::op_9XY0; break;
+    case 0xA: instruction.handler = &Instruction_Handlers::op_ANNN; break;
+    case 0xB: instruction.handler = &Instruction_Handlers::op_BNNN<QUIRKS>; break;
+    case 0xC: instruction.handler = &Instruction_Handlers::op_CXNN; break;
+    case 0xD: instruction.handler = &Instruction_Handlers::op_DXYN<QUIRKS>; break;
+    case 0xE:
+      if(second_byte == 0x9E) instruction.handler = &Instruction_Handlers::op_EX9E;
+      if(second_byte == 0xA1) instruction.handler = &Instruction_Handlers::op_EXA1;
+      break;
+    case 0xF:
+      switch(second_byte) {
+        case 0x07: instruction.handler = &Instruction_Handlers::op_FX07; break;
+        case 0x0A: instruction.handler = &Instruction_Handlers::op_FX0A; break;
+        case 0x15: instruction.handler = &Instruction_Handlers::op_FX15; break;
+        case 0x18: instruction.handler = &Instruction_Handlers::op_FX18; break;
+        case 0x1E: instruction.handler = &Instruction_Handlers::op_FX1E; break;
+        case 0x29: instruction.handler = &Instruction_Handlers::op_FX29; break;
+        case 0x33: instruction.handler = &Instruction_Handlers::op_FX33; break;
+        case 0x55: instruction.handler = &Instruction_Handlers::op_FX55<QUIRKS>; break;
+        case 0x65: instruction.handler = &Instruction_Handlers::op_FX65<QUIRKS>; break;
+      }
+      if(platform == Platform::COSMAC_VIP) break;
+      switch(second_byte) {
+        case 0x30: instruction.handler = &Instruction_Handlers::op_FX30; break;
+        case 0x75: instruction.handler = &Instruction_Handlers::op_FX75; break;
+        case 0x85: instruction.handler = &Instruction_Handlers::op_FX85; break;
+      }
+      if(platform != Platform::XO_CHIP) break;
+      if(second_byte == 0x00 && instruction.x == 0x0) instruction.handler = &Instruction_Handlers::op_F000;
+      if(second_byte == 0x01) instruction.handler = &Instruction_Handlers::op_FN01;
+      if(second_byte == 0x02 && instruction.x == 0x0) instruction.handler = &Instruction_Handlers::op_F002;
+      if(second_byte == 0x3A) instruction.handler = &Instruction_Handlers::op_FX3A;
+      break;
+  }
+  return instruction;
+}
 
-      /* If they are both on then set vF to 1 */
-      if(sprite_pixel && display_pixel) _vs[FLAG_REG] = 1;
+/* 
+  Writes to memory, wrapping the address, and invalidates the two cached instructions containing it. The 
+  instruction at the last address is fetched wrapped, so it contains byte 0 as well
+*/
+void Chip_8::_write_memory(uint16_t address, uint8_t value) {
+  address &= _address_mask;
+  _state.memory[address] = value;
+  if(!_decode_cache.empty()) {
+    _decode_cache[address] = _undecoded;
+    _decode_cache[(address - 1) & _address_mask] = _undecoded;
+  }
+  if(_jit) _jit->invalidate(address);
+}
 
-      /* Set display pixel to the XOR of both pixels */
-      _display[(y + i) % DISPLAY_HEIGHT][(x + j) % DISPLAY_WIDTH] = sprite_pixel ^ display_pixel;
+/* Pushes onto the stack, or holds the call on the stack overflow */
+bool Chip_8::_push_stack(uint16_t address) {
+  if(_state.stack_pointer == STACK_DEPTH) {
+    _state.fault = Machine_Fault::STACK_OVERFLOW;
+    _state.program_counter -= INSTRUCTION_SIZE;
+    _halt = Halt_State::STOPPED;
+    return false;
+  }
+  _state.stack[_state.stack_pointer++] = address;
+  return true;
+}
 
-      /* If the right edge of the screen is reached, stop drawing this row */
-      if(_clip) {
-        if(x + j == DISPLAY_WIDTH - 1) break;
-      }
-    } 
+/* Pops from the stack, or holds the return on the stack underflow */
+bool Chip_8::_pop_stack(uint16_t &address) {
+  if(_state.stack_pointer == 0) {
+    _state.fault = Machine_Fault::STACK_UNDERFLOW;
+    _state.program_counter -= INSTRUCTION_SIZE;
+    _halt = Halt_State::STOPPED;
+    return false;
+  }
+  address = _state.stack[--_state.stack_pointer];
+  return true;
+}
+
+/* Skips two bytes, or four over the F000 NNNN instruction of XO-CHIP */
+void Chip_8::_skip_instruction() {
+  uint16_t size = INSTRUCTION_SIZE;
+  if(_platform == Platform::XO_CHIP && _state.memory[_state.program_counter & _address_mask] == 0xF0 && 
+    _state.memory[(_state.program_counter + 1) & _address_mask] == 0x00) size = LONG_INSTRUCTION_SIZE;
+  _state.program_counter += size;
+}
+
+/* Only short jumps back are checked, long loops nearly always do more than wait */
+void Chip_8::_jump(uint16_t target, uint16_t jump) {
+  _state.program_counter = target;
+  if(target > jump || jump - target > IDLE_LOOP_MAX_LENGTH * INSTRUCTION_SIZE) return;
+  uint32_t period = _idle_loop_period(target, jump);
+  if(period == 0) return;
+  _halt = Halt_State::IDLE;
+  _idle_period = period;
+}
 
-    /* If the bottom edge of the screen is reached, stop */
-    if(_clip) {    
-      if(y + i == DISPLAY_HEIGHT - 1) break;
+/*
+  The delay timer, keypad and memory cannot change within a batch, so a pass that only sets registers from 
+  them or from constants and skips on them, and ends with the registers it started with, is repeated exactly 
+  by every pass after it. The pass has to reach the jump without leaving the loop
+*/
+uint32_t Chip_8::_idle_loop_period(uint16_t target, uint16_t jump) const {
+  uint8_t vs[NUMBER_OF_GENERAL_REGISTERS];
+  std::copy(_state.vs, _state.vs + NUMBER_OF_GENERAL_REGISTERS, vs);
+  uint32_t length = 0;
+  uint16_t address = target;
+  while(address != jump) {
+    if(address < target || address > jump || length == IDLE_LOOP_MAX_LENGTH) return 0;
+    uint8_t first_byte = _state.memory[address & _address_mask];
+    uint8_t second_byte = _state.memory[(address + 1) & _address_mask];
+    uint8_t x = first_byte & BACK_NIBBLE_MASK;
+    uint8_t y = second_byte >> NIBBLE_SIZE;
+    bool pressed = vs[x] < NUMBER_OF_KEYS && (_state.keypad & (1 << vs[x]));
+    bool skip = false;
+    switch(first_byte >> NIBBLE_SIZE) {
+      case 0x3: skip = vs[x] == second_byte; break;
+      case 0x4: skip = vs[x] != second_byte; break;
+      case 0x5:
+        if(second_byte & BACK_NIBBLE_MASK) return 0;
+        skip = vs[x] == vs[y];
+        break;
+      case 0x9: skip = vs[x] != vs[y]; break;
+      case 0x6: vs[x] = second_byte; break;
+      case 0xE:
+        if(second_byte == 0x9E) skip = pressed;
+        else if(second_byte == 0xA1) skip = !pressed;
+        else return 0;
+        break;
+      case 0xF:
+        if(second_byte != 0x07) return 0;
+        vs[x] = _state.delay_timer;
+        break;
+      default:
+        return 0;
     }
+    /* Skipping an XO-CHIP F000 NNNN steps over both halves, which no loop this short needs */
+    if(skip && _platform == Platform::XO_CHIP && _state.memory[(address + INSTRUCTION_SIZE) & _address_mask] == 0xF0 &&
+      _state.memory[(address + INSTRUCTION_SIZE + 1) & _address_mask] == 0x00) return 0;
+    address += skip ? 2 * INSTRUCTION_SIZE : INSTRUCTION_SIZE;
+    length++;
   }
+  if(!std::equal(vs, vs + NUMBER_OF_GENERAL_REGISTERS, _state.vs)) return 0;
+  return length + 1;
 }
 
-/* Sets all values held in _display to false */
-void Chip_8::clear_screen_data() {
-  for(size_t i = 0; i < DISPLAY_HEIGHT; i++) {
-    for(size_t j = 0; j < DISPLAY_WIDTH; j++) {
-      _display[i][j] = false;
+/* Only looks at the instructions, jumps out of the loop are allowed as a pass may skip over them */
+bool Chip_8::_is_idle_loop_candidate(uint16_t target, uint16_t jump) const {
+  if(target > jump || jump - target > IDLE_LOOP_MAX_LENGTH * INSTRUCTION_SIZE) return false;
+  for(uint16_t address = target; address < jump; address += INSTRUCTION_SIZE) {
+    uint8_t first_byte = _state.memory[address & _address_mask];
+    uint8_t second_byte = _state.memory[(address + 1) & _address_mask];
+    switch(first_byte >> NIBBLE_SIZE) {
+      case 0x1: case 0x3: case 0x4: case 0x5: case 0x6: case 0x9:
+        break;
+      case 0xE:
+        if(second_byte != 0x9E && second_byte != 0xA1) return false;
+        break;
+      case 0xF:
+        if(second_byte != 0x07) return false;
+        break;
+      default:
+        return false;
+    }
+  }
+  return true;
+}
+
+/* Changes resolution, the two modes do not share pixels so every plane is cleared */
+void Chip_8::_set_hires(bool hires) {
+  _state.display.hires = hires;
+  clear_planes(_state.display, (1 << DISPLAY_PLANES) - 1);
+  _dirty_rows = ALL_ROWS_DIRTY;
+}
+
+/* Stores from vX towards vY, which may be the lower register, leaving the index register as it is */
+void Chip_8::_store_register_range(uint8_t op1, uint8_t op2) {
+  int8_t step = op1 <= op2 ? 1 : -1;
+  for(uint8_t i = 0; i <= std::abs(op2 - op1); i++) {
+    _write_memory(_state.index_register + i, _state.vs[op1 + i * step]);
+  }
+}
+
+/* Loads from vX towards vY, which may be the lower register, leaving the index register as it is */
+void Chip_8::_load_register_range(uint8_t op1, uint8_t op2) {
+  int8_t step = op1 <= op2 ? 1 : -1;
+  for(uint8_t i = 0; i <= std::abs(op2 - op1); i++) {
+    _state.vs[op1 + i * step] = _state.memory[(_state.index_register + i) & _address_mask];
+  }
+}
+
+/* Reads the address from the two bytes after the instruction, which the program counter points at, and steps over them */
+void Chip_8::_load_long_index() {
+  _state.index_register = (_state.memory[_state.program_counter & _address_mask] << BYTE_SIZE) | 
+    _state.memory[(_state.program_counter + 1) & _address_mask];
+  _state.program_counter += INSTRUCTION_SIZE;
+}
+
+/* Copies the 16 bytes at the index register, wrapping around the end of memory, leaving the index register as it is */
+void Chip_8::_load_audio_pattern() {
+  for(uint8_t i = 0; i < AUDIO_PATTERN_SIZE; i++) {
+    _state.audio_pattern[i] = _state.memory[(_state.index_register + i) & _address_mask];
+  }
+}
+
+/* Draws the sprite, holding the program counter on DXYN until the display has refreshed */
+template <uint8_t QUIRKS>
+void Chip_8::_draw_sprite_with_wait(uint8_t op1, uint8_t op2, uint8_t op3) {
+  if constexpr(QUIRKS & QUIRK_DW) {
+    switch(_state.refresh_state) {
+      case Refresh_State::FREE:
+        _state.refresh_state = Refresh_State::WAITING;
+        _state.program_counter -= INSTRUCTION_SIZE;
+        _halt = Halt_State::DISPLAY_WAIT;
+        break;
+      
+      case Refresh_State::WAITING:
+        _state.program_counter -= INSTRUCTION_SIZE;
+        _halt = Halt_State::DISPLAY_WAIT;
+        break;
+
+      case Refresh_State::REFRESH_FINISHED:
+        _state.refresh_state = Refresh_State::FREE;
+        _draw_sprite<QUIRKS>(op1, op2, op3);
+        break;
     }
+  } else {
+    _draw_sprite<QUIRKS>(op1, op2, op3);
+  }
+}
+
+/* Holds the program counter on FX0A until a key has been pressed and released */
+void Chip_8::_wait_for_key(uint8_t op1) {
+  if(_state.curr_pressed_key == NO_KEY) {
+    /* Block until a key is pressed, then remember the lowest pressed key */
+    if(_state.keypad) {
+      uint8_t key = 0;
+      while(!(_state.keypad & (1 << key))) key++;
+      _state.curr_pressed_key = key;
+    }
+    _state.program_counter -= INSTRUCTION_SIZE;
+    _halt = Halt_State::KEY_WAIT;
+  } else if(_state.keypad & (1 << _state.curr_pressed_key)) {
+    /* If the key is still being pressed, block */
+    _state.program_counter -= INSTRUCTION_SIZE;
+    _halt = Halt_State::KEY_WAIT;
+  } else {
+    /* Set vX to the key that was pressed and released */
+    _state.vs[op1] = _state.curr_pressed_key;
+    _state.curr_pressed_key = NO_KEY;
+  }
+}
+
+/* 
+  Draw sprite to the display. DXY0 draws a 16x16 sprite on SUPER-CHIP and XO-CHIP. Each selected plane 
+  takes the next sprite in memory, so a sprite for two planes is two sprites back to back
+*/
+template <uint8_t QUIRKS>
+void Chip_8::_draw_sprite(uint8_t op1, uint8_t op2, uint8_t op3) {
+  uint8_t height = op3;
+  uint8_t width = SPRITE_WIDTH;
+  if(op3 == 0 && _platform != Platform::COSMAC_VIP) {
+    height = LARGE_SPRITE_WIDTH;
+    width = LARGE_SPRITE_WIDTH;
+  }
+  uint16_t sprite_size = height * (width / SPRITE_WIDTH);
+
+  uint32_t memory_size = _address_mask + 1;
+  uint16_t address = _state.index_register & _address_mask;
+  bool collision = false;
+  for(uint8_t plane = 0; plane < DISPLAY_PLANES; plane++) {
+    if(!(_state.plane_mask & (1 << plane))) continue;
+
+    /* Sprites running past the end of memory wrap around to the start */
+    const uint8_t *sprite = &_state.memory[address];
+    uint8_t wrapped_sprite[LARGE_SPRITE_WIDTH * LARGE_SPRITE_WIDTH / SPRITE_WIDTH];
+    if(address + sprite_size > memory_size) {
+      for(uint16_t i = 0; i < sprite_size; i++) {
+        wrapped_sprite[i] = _state.memory[(address + i) & _address_mask];
+      }
+      sprite = wrapped_sprite;
+    }
+    collision |= blit_sprite(_state.display, plane, _state.vs[op1], _state.vs[op2], sprite, height, width, 
+      QUIRKS & QUIRK_CLIP, _dirty_rows);
+    address = (address + sprite_size) & _address_mask;
+  }
+  /* Set flag register to 1 if any pixel was turned off, otherwise 0 */
+  _state.vs[FLAG_REG] = collision ? 1 : 0;
+}
+
+/* Turns off all pixels held in the selected planes */
+void Chip_8::clear_screen_data() {
+  clear_planes(_state.display, _state.plane_mask);
+  _dirty_rows = ALL_ROWS_DIRTY;
+}
+
+/* Get data held in the display */
+const Framebuffer &Chip_8::get_data() const {
+  return _state.display;
+}
+
+/* Hands over the rows changed since the last call */
+uint64_t Chip_8::take_dirty_rows() {
+  uint64_t dirty_rows = _dirty_rows;
+  _dirty_rows = 0;
+  return dirty_rows;
+}
+
+/* Hash the packed rows of the display */
+uint64_t Chip_8::get_display_hash() const {
+  return framebuffer_hash(_state.display);
+}
+
+/* Get the dispatch in use */
+Dispatch_Mode Chip_8::get_dispatch() const {
+  return _dispatch;
+}
+
+/* Reseeds the random number generator */
+void Chip_8::seed_random(uint32_t seed) {
+  seed_random_state(_state.random_state, seed);
+}
+
+/* Hash everything a program can observe, used to compare two machines */
+uint64_t Chip_8::get_state_hash() const {
+  uint64_t hash = fnv1a_64(_state.memory, _address_mask + 1);
+  hash = framebuffer_hash(_state.display, hash);
+  hash = fnv1a_64(_state.vs, NUMBER_OF_GENERAL_REGISTERS, hash);
+  hash = fnv1a_64(&_state.program_counter, sizeof(_state.program_counter), hash);
+  hash = fnv1a_64(&_state.index_register, sizeof(_state.index_register), hash);
+  hash = fnv1a_64(&_state.delay_timer, sizeof(_state.delay_timer), hash);
+  hash = fnv1a_64(&_state.sound_timer, sizeof(_state.sound_timer), hash);
+  /* Registers only the later platforms have, left out on the original so its hashes stay the same */
+  if(_platform != Platform::COSMAC_VIP) {
+    hash = fnv1a_64(&_state.plane_mask, sizeof(_state.plane_mask), hash);
+    hash = fnv1a_64(_state.flag_registers, NUMBER_OF_FLAG_REGISTERS, hash);
+  }
+  if(_platform == Platform::XO_CHIP) {
+    hash = fnv1a_64(_state.audio_pattern, AUDIO_PATTERN_SIZE, hash);
+    hash = fnv1a_64(&_state.pitch, sizeof(_state.pitch), hash);
+  }
+  /* Stack from the top down */
+  for(uint8_t level = _state.stack_pointer; level > 0; level--) {
+    hash = fnv1a_64(&_state.stack[level - 1], sizeof(uint16_t), hash);
+  }
+  return hash;
+}
+
+const Machine_State &Chip_8::get_state() const {
+  return _state;
+}
+
+/* Copies the state in, the cached instructions and translated blocks belong to the old memory */
+/* 
+  Only the instructions containing bytes that change are invalidated, so restoring a state over the same program keeps 
+  its decoded instructions and translated blocks
+*/
+void Chip_8::set_state(const Machine_State &state) {
+  uint32_t memory_size = platform_memory_size(_platform);
+  for(uint32_t address = 0; address < memory_size; address++) {
+    if(_state.memory[address] != state.memory[address]) _write_memory(address, state.memory[address]);
   }
+  copy_state(_state, state, _platform);
+  _dirty_rows = ALL_ROWS_DIRTY;
+  /* A state still waiting or faulted halts again on its first cycle, a machine stopped by the debugger stays stopped */
+  if(_halt != Halt_State::BREAK) _halt = Halt_State::RUNNING;
+}
+
+Machine_Fault Chip_8::get_fault() const {
+  return _state.fault;
+}
+
+Halt_State Chip_8::get_halt_state() const {
+  return _halt;
 }
 
-/* Get data held in _display */
-std::vector<std::vector<bool>> Chip_8::get_data() {
-  return _display;
+uint8_t Chip_8::get_quirk_bits() const {
+  return _quirks;
 }
 
-/* Updates the status of the keyboard */
-void Chip_8::update_keyboard_status() {
-  for(const std::pair<const sf::Keyboard::Key, uint8_t> &mapping : keyboard_mapping) {
-    _keyboard[mapping.second] = sf::Keyboard::isKeyPressed(mapping.first);
+Platform Chip_8::get_platform() const {
+  return _platform;
+}
+
+uint64_t Chip_8::get_cycle_count() const {
+  return _cycle_count;
+}
+
+/* Applies every pending key event to the keypad and records how long each one waited */
+void Chip_8::update_keyboard_status(Input_Source &input) {
+  Key_Event event;
+  std::chrono::steady_clock::time_point now;
+  bool polled = false;
+  while(input.poll_event(event)) {
+    if(!polled) {
+      now = std::chrono::steady_clock::now();
+      polled = true;
+    }
+    set_key(event.key, event.pressed);
+
+    std::chrono::nanoseconds latency = now - event.timestamp;
+    _input_latency.events++;
+    _input_latency.total += latency;
+    if(latency > _input_latency.max) _input_latency.max = latency;
   }
 }
 
+/* Sets or clears the bit of the key */
+void Chip_8::set_key(uint8_t key, bool pressed) {
+  if(key >= NUMBER_OF_KEYS) return;
+  if(_halt == Halt_State::KEY_WAIT) _halt = Halt_State::RUNNING;
+  if(pressed) {
+    _state.keypad |= 1 << key;
+  } else {
+    _state.keypad &= ~(1 << key);
+  }
+}
+
+uint16_t Chip_8::get_keypad() const {
+  return _state.keypad;
+}
+
+const Input_Latency &Chip_8::get_input_latency() const {
+  return _input_latency;
+}
+
 /* Updates refresh state to refresh finished if it is currently waiting */
 void Chip_8::set_refresh_state() {
-  if(_dw) {
-    if(_refresh_state == Refresh_State::WAITING) _refresh_state = Refresh_State::REFRESH_FINISHED;
+  if(_quirks & QUIRK_DW) {
+    if(_state.refresh_state == Refresh_State::WAITING) _state.refresh_state = Refresh_State::REFRESH_FINISHED;
+    if(_halt == Halt_State::DISPLAY_WAIT) _halt = Halt_State::RUNNING;
   }
+}
+
+/* Runs the cycles of one frame, then does the 60Hz timer and refresh updates */
+void Chip_8::run_frame(uint32_t cycles) {
+  run_cycles(cycles);
+  if(_halt == Halt_State::BREAK) {
+    /* The frame ends once resume_frame has run the rest of it */
+    _break_in_frame = true;
+    return;
+  }
+  _end_frame();
+}
+
+void Chip_8::resume_frame() {
+  if(_halt != Halt_State::BREAK) return;
+  bool in_frame = _break_in_frame;
+  _halt = Halt_State::RUNNING;
+  _resuming = true;
+  run_cycles(_break_remaining);
+  _resuming = false;
+  if(_halt == Halt_State::BREAK) {
+    _break_in_frame = in_frame;
+    return;
+  }
+  if(in_frame) _end_frame();
+}
+
+void Chip_8::_end_frame() {
+  /* The buzzer sounds for the whole tick if the sound timer is still running at its end */
+  if(_audio) _audio->tick(_state);
+  decrease_delay_timer();
+  decrease_sound_timer();
+  set_refresh_state();
+}
+
+void Chip_8::set_audio(Audio_Generator *audio) {
+  _audio = audio;
+}
+
+/* Decodes the instruction that was just fetched, caches it and runs it */
+template <uint8_t QUIRKS>
+void Instruction_Handlers::decode(Chip_8 &chip_8, const Decoded_Instruction &) {
+  uint16_t address = (chip_8._state.program_counter - INSTRUCTION_SIZE) & chip_8._address_mask;
+  Decoded_Instruction instruction = Chip_8::_decode<QUIRKS>(chip_8._platform, chip_8._state.memory[address], 
+    chip_8._state.memory[(address + 1) & chip_8._address_mask]);
+  chip_8._decode_cache[address] = instruction;
+  instruction.handler(chip_8, instruction);
+}
+
+/* Unknown instructions do nothing */
+void Instruction_Handlers::nop(Chip_8 &, const Decoded_Instruction &) {}
+
+/* 00E0 - Clear screen instruction */
+void Instruction_Handlers::op_00E0(Chip_8 &chip_8, const Decoded_Instruction &) {
+  chip_8.clear_screen_data();
+}
+
+/* 00EE - Return from subroutine */
+void Instruction_Handlers::op_00EE(Chip_8 &chip_8, const Decoded_Instruction &) {
+  uint16_t return_address;
+  if(chip_8._pop_stack(return_address)) chip_8._state.program_counter = return_address;
+}
+
+/* 00CN - Scroll the display down by N rows */
+void Instruction_Handlers::op_00CN(Chip_8 &chip_8, const Decoded_Instruction &instruction) {
+  scroll_down(chip_8._state.display, chip_8._state.plane_mask, instruction.n);
+  chip_8._dirty_rows = ALL_ROWS_DIRTY;
+}
+
+/* 00DN - Scroll the display up by N rows */
+void Instruction_Handlers::op_00DN(Chip_8 &chip_8, const Decoded_Instruction &instruction) {
+  scroll_up(chip_8._state.display, chip_8._state.plane_mask, instruction.n);
+  chip_8._dirty_rows = ALL_ROWS_DIRTY;
+}
+
+/* 00FB - Scroll the display right by 4 pixels */
+void Instruction_Handlers::op_00FB(Chip_8 &chip_8, const Decoded_Instruction &) {
+  scroll_right(chip_8._state.display, chip_8._state.plane_mask, HORIZONTAL_SCROLL);
+  chip_8._dirty_rows = ALL_ROWS_DIRTY;
+}
+
+/* 00FC - Scroll the display left by 4 pixels */
+void Instruction_Handlers::op_00FC(Chip_8 &chip_8, const Decoded_Instruction &) {
+  scroll_left(chip_8._state.display, chip_8._state.plane_mask, HORIZONTAL_SCROLL);
+  chip_8._dirty_rows = ALL_ROWS_DIRTY;
+}
+
+/* 00FD - Exit the interpreter, which holds the program counter on this instruction */
+void Instruction_Handlers::op_00FD(Chip_8 &chip_8, const Decoded_Instruction &) {
+  chip_8._state.program_counter -= INSTRUCTION_SIZE;
+  chip_8._halt = Halt_State::STOPPED;
+}
+
+/* 00FE - Switch to the 64x32 mode */
+void Instruction_Handlers::op_00FE(Chip_8 &chip_8, const Decoded_Instruction &) {
+  chip_8._set_hires(false);
+}
+
+/* 00FF - Switch to the 128x64 mode */
+void Instruction_Handlers::op_00FF(Chip_8 &chip_8, const Decoded_Instruction &) {
+  chip_8._set_hires(true);
+}
+
+/* 1NNN - Sets the program counter to NNN */
+void Instruction_Handlers::op_1NNN(Chip_8 &chip_8, const Decoded_Instruction &instruction) {
+  chip_8._jump(instruction.nnn, (chip_8._state.program_counter - INSTRUCTION_SIZE) & chip_8._address_mask);
+}
+
+/* 2NNN - Call subroutine at location NNN */
+void Instruction_Handlers::op_2NNN(Chip_8 &chip_8, const Decoded_Instruction &instruction) {
+  if(chip_8._push_stack(chip_8._state.program_counter)) chip_8._state.program_counter = instruction.nnn;
+}
+
+/* 3XNN - Skip one instruction if vX == NN */
+void Instruction_Handlers::op_3XNN(Chip_8 &chip_8, const Decoded_Instruction &instruction) {
+  if(chip_8._state.vs[instruction.x] == instruction.nn) chip_8._skip_instruction();
+}
+
+/* 4XNN - Skip one instruction if vX != NN */
+void Instruction_Handlers::op_4XNN(Chip_8 &chip_8, const Decoded_Instruction &instruction) {
+  if(chip_8._state.vs[instruction.x] != instruction.nn) chip_8._skip_instruction();
+}
+
+/* 5XY0 - Skips one instruction is vX == vY */
+void Instruction_Handlers::op_5XY0(Chip_8 &chip_8, const Decoded_Instruction &instruction) {
+  if(chip_8._state.vs[instruction.x] == chip_8._state.vs[instruction.y]) chip_8._skip_instruction();
+}
+
+/* 5XY2 - Store vX to vY in memory starting at index register */
+void Instruction_Handlers::op_5XY2(Chip_8 &chip_8, const Decoded_Instruction &instruction) {
+  chip_8._store_register_range(instruction.x, instruction.y);
+}
+
+/* 5XY3 - Load vX to vY from memory starting at index register */
+void Instruction_Handlers::op_5XY3(Chip_8 &chip_8, const Decoded_Instruction &instruction) {
+  chip_8._load_register_range(instruction.x, instruction.y);
+}
+
+/* 6XNN - vX = NN */
+void Instruction_Handlers::op_6XNN(Chip_8 &chip_8, const Decoded_Instruction &instruction) {
+  chip_8._state.vs[instruction.x] = instruction.nn;
+}
+
+/* 7XNN - vX += NN */
+void Instruction_Handlers::op_7XNN(Chip_8 &chip_8, const Decoded_Instruction &instruction) {
+  chip_8._state.vs[instruction.x] += instruction.nn;
+}
+
+/* 8XY0 - vX = vY */
+void Instruction_Handlers::op_8XY0(Chip_8 &chip_8, const Decoded_Instruction &instruction) {
+  chip_8._state.vs[instruction.x] = chip_8._state.vs[instruction.y];
+}
+
+/* 8XY1 - vX = vX | vY */
+template <uint8_t QUIRKS>
+void Instruction_Handlers::op_8XY1(Chip_8 &chip_8, const Decoded_Instruction &instruction) {
+  chip_8._state.vs[instruction.x] |= chip_8._state.vs[instruction.y];
+  if constexpr(QUIRKS & QUIRK_VFRESET) chip_8._state.vs[FLAG_REG] = 0;
+}
+
+/* 8XY2 - vX = vX & vY */
+template <uint8_t QUIRKS>
+void Instruction_Handlers::op_8XY2(Chip_8 &chip_8, const Decoded_Instruction &instruction) {
+  chip_8._state.vs[instruction.x] &= chip_8._state.vs[instruction.y];
+  if constexpr(QUIRKS & QUIRK_VFRESET) chip_8._state.vs[FLAG_REG] = 0;
+}
+
+/* 8XY3 - vX = vX ^ vY */
+template <uint8_t QUIRKS>
+void Instruction_Handlers::op_8XY3(Chip_8 &chip_8, const Decoded_Instruction &instruction) {
+  chip_8._state.vs[instruction.x] ^= chip_8._state.vs[instruction.y];
+  if constexpr(QUIRKS & QUIRK_VFRESET) chip_8._state.vs[FLAG_REG] = 0;
+}
+
+/* 8XY4 - vX += vY, vF is set to 1 on overflow */
+void Instruction_Handlers::op_8XY4(Chip_8 &chip_8, const Decoded_Instruction &instruction) {
+  uint16_t sum = chip_8._state.vs[instruction.x] + chip_8._state.vs[instruction.y];
+  chip_8._state.vs[instruction.x] = static_cast<uint8_t>(sum);
+  chip_8._state.vs[FLAG_REG] = sum >> BYTE_SIZE;
+}
+
+/* 8XY5 - vX = vX - vY, vF is set to 0 on underflow */
+void Instruction_Handlers::op_8XY5(Chip_8 &chip_8, const Decoded_Instruction &instruction) {
+  uint8_t not_borrow = chip_8._state.vs[instruction.x] >= chip_8._state.vs[instruction.y];
+  chip_8._state.vs[instruction.x] -= chip_8._state.vs[instruction.y];
+  chip_8._state.vs[FLAG_REG] = not_borrow;
+}
+
+/* 8XY6 - set vX = vY, then shift vX 1 bit to the right */
+template <uint8_t QUIRKS>
+void Instruction_Handlers::op_8XY6(Chip_8 &chip_8, const Decoded_Instruction &instruction) {
+  if constexpr(!(QUIRKS & QUIRK_SHIFTX)) chip_8._state.vs[instruction.x] = chip_8._state.vs[instruction.y];
+  uint8_t shifted_bit = chip_8._state.vs[instruction.x] & BIT_MASK;
+  chip_8._state.vs[instruction.x] >>= 1;
+  chip_8._state.vs[FLAG_REG] = shifted_bit;
+}
+
+/* 8XY7 - vX = vY - vX, vF is set to 0 on underflow */
+void Instruction_Handlers::op_8XY7(Chip_8 &chip_8, const Decoded_Instruction &instruction) {
+  uint8_t not_borrow = chip_8._state.vs[instruction.y] >= chip_8._state.vs[instruction.x];
+  chip_8._state.vs[instruction.x] = chip_8._state.vs[instruction.y] - chip_8._state.vs[instruction.x];
+  chip_8._state.vs[FLAG_REG] = not_borrow;
+}
+
+/* 8XYE - set vX = vY, then shift vX 1 bit to the left */
+template <uint8_t QUIRKS>
+void Instruction_Handlers::op_8XYE(Chip_8 &chip_8, const Decoded_Instruction &instruction) {
+  if constexpr(!(QUIRKS & QUIRK_SHIFTX)) chip_8._state.vs[instruction.x] = chip_8._state.vs[instruction.y];
+  uint8_t shifted_bit = chip_8._state.vs[instruction.x] >> (BYTE_SIZE - 1);
+  chip_8._state.vs[instruction.x] <<= 1;
+  chip_8._state.vs[FLAG_REG] = shifted_bit;
+}
+
+/* 9XY0 - Skips one instruction is vX != vY */
+void Instruction_Handlers::op_9XY0(Chip_8 &chip_8, const Decoded_Instruction &instruction) {
+  if(chip_8._state.vs[instruction.x] != chip_8._state.vs[instruction.y]) chip_8._skip_instruction();
+}
+
+/* ANNN - Sets the index register to NNN */
+void Instruction_Handlers::op_ANNN(Chip_8 &chip_8, const Decoded_Instruction &instruction) {
+  chip_8._state.index_register = instruction.nnn;
+}
+
+/* BNNN - Jump to the address NNN + the value in v0 (or vX) */
+template <uint8_t QUIRKS>
+void Instruction_Handlers::op_BNNN(Chip_8 &chip_8, const Decoded_Instruction &instruction) {
+  chip_8._state.program_counter = instruction.nnn + chip_8._state.vs[(QUIRKS & QUIRK_JUMPX) ? instruction.x : 0];
+}
+
+/* CXNN - vX = random number & NN */
+void Instruction_Handlers::op_CXNN(Chip_8 &chip_8, const Decoded_Instruction &instruction) {
+  uint8_t random_number = next_random_byte(chip_8._state.random_state);
+  chip_8._state.vs[instruction.x] = random_number & instruction.nn;
+}
+
+/* DXYN - Draws sprite N tall at the coordinates (vX, vY) */
+template <uint8_t QUIRKS>
+void Instruction_Handlers::op_DXYN(Chip_8 &chip_8, const Decoded_Instruction &instruction) {
+  chip_8._draw_sprite_with_wait<QUIRKS>(instruction.x, instruction.y, instruction.n);
+}
+
+/* EX9E - Skip one instruction if the key in vX is pressed */
+void Instruction_Handlers::op_EX9E(Chip_8 &chip_8, const Decoded_Instruction &instruction) {
+  uint8_t key = chip_8._state.vs[instruction.x];
+  if(key < NUMBER_OF_KEYS && (chip_8._state.keypad & (1 << key))) chip_8._skip_instruction();
+}
+
+/* EXA1 - Skip one instruction if the key in vX is not pressed */
+void Instruction_Handlers::op_EXA1(Chip_8 &chip_8, const Decoded_Instruction &instruction) {
+  uint8_t key = chip_8._state.vs[instruction.x];
+  if(key >= NUMBER_OF_KEYS || !(chip_8._state.keypad & (1 << key))) chip_8._skip_instruction();
+}
+
+/* F000 NNNN - Set the index register to the address NNNN */
+void Instruction_Handlers::op_F000(Chip_8 &chip_8, const Decoded_Instruction &) {
+  chip_8._load_long_index();
+}
+
+/* FN01 - Select the planes drawn to by their mask N */
+void Instruction_Handlers::op_FN01(Chip_8 &chip_8, const Decoded_Instruction &instruction) {
+  chip_8._state.plane_mask = instruction.x;
+}
+
+/* F002 - Load the audio pattern from memory starting at index register */
+void Instruction_Handlers::op_F002(Chip_8 &chip_8, const Decoded_Instruction &) {
+  chip_8._load_audio_pattern();
+}
+
+/* FX07 - Set vX to the value of the delay timer */
+void Instruction_Handlers::op_FX07(Chip_8 &chip_8, const Decoded_Instruction &instruction) {
+  chip_8._state.vs[instruction.x] = chip_8._state.delay_timer;
+}
+
+/* FX0A - Blocks until a key is pressed and released and sets vX to it */
+void Instruction_Handlers::op_FX0A(Chip_8 &chip_8, const Decoded_Instruction &instruction) {
+  chip_8._wait_for_key(instruction.x);
+}
+
+/* FX15 - Set delay timer to the value in vX */
+void Instruction_Handlers::op_FX15(Chip_8 &chip_8, const Decoded_Instruction &instruction) {
+  chip_8._state.delay_timer = chip_8._state.vs[instruction.x];
+}
+
+/* FX18 - Set sound timer to the value in vX */
+void Instruction_Handlers::op_FX18(Chip_8 &chip_8, const Decoded_Instruction &instruction) {
+  chip_8._state.sound_timer = chip_8._state.vs[instruction.x];
+}
+
+/* FX1E - Add vX to index register, setting vF if it goes past the addressing range of the platform */
+void Instruction_Handlers::op_FX1E(Chip_8 &chip_8, const Decoded_Instruction &instruction) {
+  chip_8._state.index_register += chip_8._state.vs[instruction.x];
+  if(chip_8._state.index_register > platform_memory_size(chip_8._platform)) chip_8._state.vs[FLAG_REG] = 1;
+}
+
+/* FX29 - Set index register to the font of the character stored in vX */
+void Instruction_Handlers::op_FX29(Chip_8 &chip_8, const Decoded_Instruction &instruction) {
+  chip_8._state.index_register = FONT_ADDRESS + (chip_8._state.vs[instruction.x] * FONT_SIZE);
+}
+
+/* FX30 - Set index register to the large font of the digit stored in vX */
+void Instruction_Handlers::op_FX30(Chip_8 &chip_8, const Decoded_Instruction &instruction) {
+  chip_8._state.index_register = LARGE_FONT_ADDRESS + (chip_8._state.vs[instruction.x] & BACK_NIBBLE_MASK) * LARGE_FONT_SIZE;
+}
+
+/* FX33 - Store the hundreds, tens and units of vX in memory starting at index register */
+void Instruction_Handlers::op_FX33(Chip_8 &chip_8, const Decoded_Instruction &instruction) {
+  uint8_t num = chip_8._state.vs[instruction.x];
+  chip_8._write_memory(chip_8._state.index_register, num / 100);
+  chip_8._write_memory(chip_8._state.index_register + 1, (num / 10) % 10);
+  chip_8._write_memory(chip_8._state.index_register + 2, num % 10);
+}
+
+/* FX3A - Set the pitch the audio pattern is played at to vX */
+void Instruction_Handlers::op_FX3A(Chip_8 &chip_8, const Decoded_Instruction &instruction) {
+  chip_8._state.pitch = chip_8._state.vs[instruction.x];
+}
+
+/* FX55 - Store registers v0 to vX into memory starting at index register */
+template <uint8_t QUIRKS>
+void Instruction_Handlers::op_FX55(Chip_8 &chip_8, const Decoded_Instruction &instruction) {
+  for(int i = 0; i <= instruction.x; i++) {
+    chip_8._write_memory(chip_8._state.index_register + i, chip_8._state.vs[i]);
+  }
+  if constexpr(QUIRKS & QUIRK_MEMINC) chip_8._state.index_register += instruction.x + 1;
+}
+
+/* FX65 - Load registers v0 to vX from memory starting at index register */
+template <uint8_t QUIRKS>
+void Instruction_Handlers::op_FX65(Chip_8 &chip_8, const Decoded_Instruction &instruction) {
+  for(int i = 0; i <= instruction.x; i++) {
+    chip_8._state.vs[i] = chip_8._state.memory[(chip_8._state.index_register + i) & chip_8._address_mask];
+  }
+  if constexpr(QUIRKS & QUIRK_MEMINC) chip_8._state.index_register += instruction.x + 1;
+}
+
+/* FX75 - Store registers v0 to vX in the flag registers */
+void Instruction_Handlers::op_FX75(Chip_8 &chip_8, const Decoded_Instruction &instruction) {
+  std::copy(chip_8._state.vs, chip_8._state.vs + instruction.x + 1, chip_8._state.flag_registers);
+}
+
+/* FX85 - Load registers v0 to vX from the flag registers */
+void Instruction_Handlers::op_FX85(Chip_8 &chip_8, const Decoded_Instruction &instruction) {
+  std::copy(chip_8._state.flag_registers, chip_8._state.flag_registers + instruction.x + 1, chip_8._state.vs);
 }
\ No newline at end of file
@@ -1,25 +1,27 @@
 #ifndef CHIP_8_H
 #define CHIP_8_H
 
-#include <random>
-#include <SFML/Window.hpp>
-#include <stack>
+#include <memory>
+#include <optional>
 #include <stdint.h>
 #include <string>
-#include <unordered_map>
 #include <vector>
-
-#define MEMORY_SIZE 4096
-
-#define DISPLAY_HEIGHT 32
-#define DISPLAY_WIDTH 64
-
-#define NUMBER_OF_GENERAL_REGISTERS 16
+#include "audio.h"
+#include "framebuffer.h"
+#include "input_source.h"
+#include "jit.h"
+#include "machine_state.h"
+#include "debugger.h"
+#include "profiler.h"
+#include "trace.h"
+#include "rom_cache.h"
 
 #define FONT_SIZE 5
+#define LARGE_FONT_SIZE 10
 
 #define FONT_ADDRESS 0x50
-#define PROGRAM_ADDRESS 0x200
+/* The 8x10 digits of SUPER-CHIP and XO-CHIP follow the small font */
+#define LARGE_FONT_ADDRESS 0xA0
 #define ADDRESS_RANGE 0x1000
 
 #define BIT_MASK 0x1
@@ -29,11 +31,39 @@
 #define NIBBLE_SIZE 4
 #define BYTE_SIZE 8
 #define INSTRUCTION_SIZE 2
+/* Size of the XO-CHIP F000 NNNN instruction, which skips jump over whole */
+#define LONG_INSTRUCTION_SIZE 4
 
 #define FLAG_REG 0xF
 
 #define NO_KEY 0xFF
 
+/* Most instructions before the jump back of a loop that is checked for only waiting */
+#define IDLE_LOOP_MAX_LENGTH 8
+
+/* Pixels 00FB and 00FC scroll the display by */
+#define HORIZONTAL_SCROLL 4
+
+/* Quirk bits, the interpreter is compiled once for every combination of them */
+#define QUIRK_DW 0x01
+#define QUIRK_VFRESET 0x02
+#define QUIRK_MEMINC 0x04
+#define QUIRK_CLIP 0x08
+#define QUIRK_SHIFTX 0x10
+#define QUIRK_JUMPX 0x20
+#define QUIRK_COMBINATIONS 0x40
+
+/* Quirks of well-known platforms */
+#define QUIRK_PROFILE_VIP (QUIRK_DW | QUIRK_VFRESET | QUIRK_MEMINC | QUIRK_CLIP)
+#define QUIRK_PROFILE_SCHIP (QUIRK_CLIP | QUIRK_SHIFTX | QUIRK_JUMPX)
+#define QUIRK_PROFILE_XOCHIP (QUIRK_MEMINC)
+
+/* Audio pattern until a program loads its own, a 500Hz square wave at the default pitch */
+#define DEFAULT_AUDIO_PATTERN_BYTE 0xF0
+
+/* Number of cycles run between two 60Hz timer ticks */
+#define DEFAULT_CYCLES_PER_FRAME 166
+
 const std::vector<uint8_t> font = {
   0xF0, 0x90, 0x90, 0x90, 0xF0, 
   0x20, 0x60, 0x20, 0x20, 0x70, 
@@ -53,30 +83,51 @@ const std::vector<uint8_t> font = {
   0xF0, 0x80, 0xF0, 0x80, 0x80
 };
 
-const std::unordered_map<sf::Keyboard::Key, uint8_t> keyboard_mapping = {
-  {sf::Keyboard::Key::Num1, 0x1},
-  {sf::Keyboard::Key::Num2, 0x2},
-  {sf::Keyboard::Key::Num3, 0x3},
-  {sf::Keyboard::Key::Num4, 0xC},
-  {sf::Keyboard::Key::Q, 0x4},
-  {sf::Keyboard::Key::W, 0x5},
-  {sf::Keyboard::Key::E, 0x6},
-  {sf::Keyboard::Key::R, 0xD},
-  {sf::Keyboard::Key::A, 0x7},
-  {sf::Keyboard::Key::S, 0x8},
-  {sf::Keyboard::Key::D, 0x9},
-  {sf::Keyboard::Key::F, 0xE},
-  {sf::Keyboard::Key::Z, 0xA},
-  {sf::Keyboard::Key::X, 0x0},
-  {sf::Keyboard::Key::C, 0xB},
-  {sf::Keyboard::Key::V, 0xF}
+const std::vector<uint8_t> large_font = {
+  0xFF, 0xFF, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 
+  0x18, 0x78, 0x78, 0x18, 0x18, 0x18, 0x18, 0x18, 0xFF, 0xFF, 
+  0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 
+  0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 
+  0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0x03, 0x03, 
+  0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 
+  0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 
+  0xFF, 0xFF, 0x03, 0x03, 0x06, 0x0C, 0x18, 0x18, 0x18, 0x18, 
+  0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 
+  0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 
+  0x7E, 0xFF, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, 
+  0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, 
+  0x3C, 0xFF, 0xC3, 0xC0, 0xC0, 0xC0, 0xC0, 0xC3, 0xFF, 0x3C, 
+  0xFC, 0xFE, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFE, 0xFC, 
+  0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 
+  0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xC0, 0xC0
 };
 
-typedef enum Refresh_State {
-  FREE,
-  WAITING,
-  REFRESH_FINISHED
-} Refresh_State;
+/* 
+  Why the machine is not running instructions. A halted machine would only keep re-running the instruction 
+  at the program counter without changing any state, so the cycle loops stop early instead
+*/
+typedef enum Halt_State {
+  RUNNING,
+  /* DXYN waiting for the vertical blank, until set_refresh_state */
+  DISPLAY_WAIT,
+  /* FX0A waiting for a key to be pressed and released, until the keypad changes */
+  KEY_WAIT,
+  /* Stack fault or 00FD, until the state is replaced */
+  STOPPED,
+  /* 
+    Jump to itself, or a short loop polling the delay timer, keys or registers that would come back to 
+    the same state every pass, for the rest of the batch. Whole passes are skipped, the cycles left over run
+  */
+  IDLE,
+  /* Stopped by the debugger at an instruction boundary, until resume_frame */
+  BREAK
+} Halt_State;
+
+typedef enum Dispatch_Mode {
+  SWITCH,
+  THREADED,
+  JIT
+} Dispatch_Mode;
 
 typedef struct Arguments {
   std::string file_name;
@@ -86,66 +137,239 @@ typedef struct Arguments {
   bool clip;
   bool shiftx;
   bool jumpx;
+  /* Machine the ROM is written for, which sets the instructions, memory and display it has */
+  Platform platform;
+  Dispatch_Mode dispatch;
+  /* Seed of the random number generator, drawn from the host if empty */
+  std::optional<uint32_t> seed;
 } Arguments;
 
+/* Time between key events happening on the host and reaching the keypad */
+typedef struct Input_Latency {
+  uint64_t events;
+  std::chrono::nanoseconds total;
+  std::chrono::nanoseconds max;
+} Input_Latency;
+
+/* Get the quirk bits for the flags in the arguments */
+uint8_t get_quirks(const Arguments &args);
+/* Set the flags in the arguments from quirk bits */
+void set_quirks(Arguments &args, uint8_t quirks);
+
+class Chip_8;
+struct Decoded_Instruction;
+
+/* Function executing one predecoded instruction */
+typedef void (*Instruction_Handler)(Chip_8 &chip_8, const Decoded_Instruction &instruction);
+
+/* Instruction with its handler and operands extracted ahead of time */
+typedef struct Decoded_Instruction {
+  Instruction_Handler handler;
+  uint16_t nnn;
+  uint8_t x;
+  uint8_t y;
+  uint8_t n;
+  uint8_t nn;
+} Decoded_Instruction;
+
 class Chip_8 {
   public:
     /* Construtor*/
     Chip_8(Arguments args);
-    /* Load ROM data into memory */
+    /* Destructor */
+    ~Chip_8();
+    /* Load ROM data into memory, returns false if the file could not be read or does not fit in memory of the platform */
     bool load_ROM();
+    /* Load ROM data already read from a file into memory, returns false if it does not fit */
+    bool load_ROM(const std::vector<uint8_t> &rom);
+    /* Get the hash of the contents of the loaded ROM */
+    uint64_t get_rom_hash() const;
+    /* Predecode the instructions and translate the blocks an earlier run of the same ROM found */
+    void warm_start(const Rom_Cache &cache);
+    /* Add the instructions and blocks found so far to the cache, starting it afresh if it is for another ROM */
+    void fill_rom_cache(Rom_Cache &cache) const;
     /* Decreases delay timer by 1 if its value is bigger than 0 */
     void decrease_delay_timer();
     /* Decreases sound timer by 1 if its value is bigger than 0 */
     void decrease_sound_timer();
     /* Run the fetch, decode and execute cycle */
     void run_cycle();
-    /* Clears the display data by turning all values to false */
+    /* Run a number of fetch, decode and execute cycles */
+    void run_cycles(uint32_t count);
+    /* Clears the display data by turning all pixels of the selected planes off */
     void clear_screen_data();
-    /* Get the data stored in _display */
-    std::vector<std::vector<bool>> get_data();
-    /* Updates the status of the keyboard */
-    void update_keyboard_status();
+    /* Get a read-only view of the data stored in the display */
+    const Framebuffer &get_data() const;
+    /* Get a hash of the packed rows of the display, see framebuffer_hash */
+    uint64_t get_display_hash() const;
+    /* Get the rows changed by drawing, clearing or scrolling since the last call (bit N is row N), and clear them */
+    uint64_t take_dirty_rows();
+    /* Updates the keypad from all key events pending in the input source */
+    void update_keyboard_status(Input_Source &input);
+    /* Press or release one key of the keypad */
+    void set_key(uint8_t key, bool pressed);
+    /* Get the keypad, bit N is set while key N is pressed */
+    uint16_t get_keypad() const;
+    /* Get the latency of the key events applied so far */
+    const Input_Latency &get_input_latency() const;
     /* Set the refresh state */
     void set_refresh_state();
+    /* Run a number of cycles, then render the tick's audio, decrease both timers and set the refresh state */
+    void run_frame(uint32_t cycles);
+    /* Render the audio of every frame from now on with the generator, or stop rendering it if it is null */
+    void set_audio(Audio_Generator *audio);
+    /* Get the dispatch in use, which falls back to threaded if the JIT is not available or the platform is XO-CHIP */
+    Dispatch_Mode get_dispatch() const;
+    /* Reseed the random number generator */
+    void seed_random(uint32_t seed);
+    /* Get a hash of all guest visible state: memory, display, registers, stack and timers */
+    uint64_t get_state_hash() const;
+    /* 
+      Get all guest visible state, a copy of it can be restored with set_state. Only the memory of the platform is 
+      held, so it is copied with copy_state rather than assigned
+    */
+    const Machine_State &get_state() const;
+    /* Replace all guest visible state, dropping everything cached from the memory that changes */
+    void set_state(const Machine_State &state);
+    /* Get the error that stopped the machine, NO_FAULT while it is running */
+    Machine_Fault get_fault() const;
+    /* Get what the machine is waiting for, RUNNING if it is running instructions */
+    Halt_State get_halt_state() const;
+    /* Get the quirk bits the machine runs with */
+    uint8_t get_quirk_bits() const;
+    Platform get_platform() const;
+    /* Get the number of cycles run since the machine was created */
+    uint64_t get_cycle_count() const;
+#if CHIP_8_PROFILER
+    /* Count every instruction run from now on in the profiler, or stop counting if it is null */
+    void set_profiler(Profiler *profiler);
+#endif
+    /* Record every instruction run from now on in the tracer, or stop recording if it is null */
+    void set_tracer(Tracer *tracer);
+    /* 
+      Stop on the breakpoints, watchpoints and steps of the debugger, or stop checking if it is null. Set it 
+      again after changing them, the checks are only made while it is active
+    */
+    void set_debugger(Debugger *debugger);
+    /* Run the rest of the cycles the machine stopped in after a BREAK, ending the frame if they were part of one */
+    void resume_frame();
   private:
-    /* Draw sprite to _display */
-    void _draw_sprite(uint8_t op1, uint8_t op2, uint8_t op3);
-    /* Memory - 4KB */
-    std::vector<uint8_t> _memory;
-    /* Display - 64x32 pixels */
-    std::vector<std::vector<bool>> _display;
-    /* Program counter */
-    uint16_t _program_counter;
-    /* Index register */
-    uint16_t _index_register;
-    /* Stack for 16-bit addresses */
-    std::stack<uint16_t> _stack;
-    /* Delay timer */
-    uint8_t _delay_timer;
-    /* Sound timer */
-    uint8_t _sound_timer;
-    /* 16 8-bit general registers named v0 to vF */
-    std::vector<uint8_t> _vs;
-    /* Value to keep track of whether we have written to the screen before */
-    bool _has_written;
-    /* Random number generation */
-    std::random_device _rand_dev;
-    std::mt19937 _mt;
-    std::uniform_int_distribution<std::mt19937::result_type> _uni_int_dist;
-    /* Chip 8 Keyboard */
-    std::unordered_map<uint8_t, bool> _keyboard;
-    uint8_t _curr_pressed_key;
-    /* Refresh State */
-    Refresh_State _refresh_state;
+    friend struct Instruction_Handlers;
+    friend class Jit;
+    /* Function running a number of cycles with one combination of quirks, returns the number run before halting */
+    typedef uint32_t (Chip_8::*Run_Function)(uint32_t count);
+    /* Function decoding an instruction with one combination of quirks */
+    typedef Decoded_Instruction (*Decode_Function)(Platform platform, uint8_t first_byte, uint8_t second_byte);
+    /* Pick the functions compiled for the quirks, searching from the combination QUIRKS upwards */
+    template <uint8_t QUIRKS> void _select_quirk_functions(uint8_t quirks);
+    /* Run cycles by walking the opcode switch */
+    template <uint8_t QUIRKS> uint32_t _run_switch_cycles(uint32_t count);
+    /* Run one cycle by walking the opcode switch */
+    template <uint8_t QUIRKS> void _run_switch_cycle();
+    /* Run cycles from the predecoded instruction cache */
+    uint32_t _run_threaded_cycles(uint32_t count);
+    /* Run one cycle from the predecoded instruction cache */
+    void _run_threaded_cycle();
+    /* Run cycles with the block translator */
+    uint32_t _run_jit_cycles(uint32_t count);
+#if CHIP_8_PROFILER
+    /* Run cycles one at a time with the loop of the dispatch, recording each in the profiler */
+    uint32_t _run_profiled_cycles(uint32_t count);
+#endif
+    /* Run cycles one at a time with the loop from before tracing, recording each in the tracer */
+    uint32_t _run_traced_cycles(uint32_t count);
+    /* Run cycles one at a time with the loop from before debugging, stopping on the debugger's checks */
+    uint32_t _run_debugged_cycles(uint32_t count);
+    /* Bytes from the index register the instruction will read and write, 0 if it does not access memory */
+    void _memory_access(uint16_t opcode, uint16_t &read_length, uint16_t &write_length) const;
+    /* Render the tick's audio, decrease both timers and set the refresh state */
+    void _end_frame();
+    /* Decode the instruction made of the two bytes, instructions the platform does not have decode as nops */
+    template <uint8_t QUIRKS> static Decoded_Instruction _decode(Platform platform, uint8_t first_byte, uint8_t second_byte);
+    /* Write a byte to memory and drop the cached instructions overlapping it */
+    void _write_memory(uint16_t address, uint8_t value);
+    /* Draw sprite to the display, waiting for the display refresh first if enabled */
+    template <uint8_t QUIRKS> void _draw_sprite_with_wait(uint8_t op1, uint8_t op2, uint8_t op3);
+    /* Skip the next instruction, both halves of it if it is an XO-CHIP F000 NNNN */
+    void _skip_instruction();
+    /* Switch between the 64x32 and 128x64 modes, clearing the display */
+    void _set_hires(bool hires);
+    /* XO-CHIP 5XY2 and 5XY3 - Store or load vX to vY, in either direction, at the index register */
+    void _store_register_range(uint8_t op1, uint8_t op2);
+    void _load_register_range(uint8_t op1, uint8_t op2);
+    /* XO-CHIP F000 NNNN - Set the index register to the 16-bit address following the instruction */
+    void _load_long_index();
+    /* XO-CHIP F002 - Load the audio pattern from memory starting at the index register */
+    void _load_audio_pattern();
+    /* Jump to target from the 1NNN at jump, halting as idle if it closes a loop that only waits */
+    void _jump(uint16_t target, uint16_t jump);
+    /* 
+      Run one pass of the loop from target back to the jump on a copy of the registers, returns the cycles 
+      of a pass including the jump if it only ran instructions reading the timers, keys and registers and 
+      left the registers as they were, or 0 otherwise
+    */
+    uint32_t _idle_loop_period(uint16_t target, uint16_t jump) const;
+    /* Check if the jump back to target could close an idle loop, for the translator to leave it to the interpreter */
+    bool _is_idle_loop_candidate(uint16_t target, uint16_t jump) const;
+    /* Block until a key is pressed and released, then store it in vX */
+    void _wait_for_key(uint8_t op1);
+    /* Draw sprite to the selected planes of the display, one after another in memory */
+    template <uint8_t QUIRKS> void _draw_sprite(uint8_t op1, uint8_t op2, uint8_t op3);
+    /* Push a return address, returns false and faults with the call held if the stack is full */
+    bool _push_stack(uint16_t address);
+    /* Pop a return address, returns false and faults with the return held if the stack is empty */
+    bool _pop_stack(uint16_t &address);
+    /* 
+      Memory, display, registers, stack, timers, keypad and random generator. The storage only holds the memory 
+      of the platform, so the 4KB platforms do not carry the 64KB of XO-CHIP
+    */
+    std::unique_ptr<uint8_t[]> _state_storage;
+    Machine_State &_state;
+    /* Predecoded instruction for each address, decoded the first time it is run */
+    std::vector<Decoded_Instruction> _decode_cache;
+    /* Cache entry that decodes with the handlers compiled for the quirks */
+    Decoded_Instruction _undecoded;
+    Decode_Function _decode_function;
+    /* Block translator, only created when the JIT dispatch is chosen */
+    std::unique_ptr<Jit> _jit;
+    /* Rows of the display changed since they were last taken */
+    uint64_t _dirty_rows;
+    /* Set by the instructions that hold the program counter, the cycles left in a batch are skipped while halted */
+    Halt_State _halt;
+    /* Cycles of one pass of the loop found while halted as idle */
+    uint32_t _idle_period;
+    Input_Latency _input_latency;
+    /* Cycles run so far, input logs are keyed by it */
+    uint64_t _cycle_count;
+    uint64_t _rom_hash;
+    uint32_t _rom_size;
     /* Flags passed to construtor */
     std::string _file_name;
-    bool _dw;
-    bool _vfreset;
-    bool _meminc;
-    bool _clip;
-    bool _shiftx;
-    bool _jumpx;
+    uint8_t _quirks;
+    Platform _platform;
+    Dispatch_Mode _dispatch;
+    /* Addresses wrap around at the end of the memory of the platform */
+    uint16_t _address_mask;
+    /* Cycle loop chosen once for the dispatch and quirks */
+    Run_Function _run_cycles;
+    /* Renders the buzzer at the end of every frame, null when nothing is listening */
+    Audio_Generator *_audio;
+#if CHIP_8_PROFILER
+    Profiler *_profiler;
+    /* Loop stepped by the profiled loop, the cycle loop from before the profiler was set */
+    Run_Function _run_unprofiled_cycles;
+#endif
+    Tracer *_tracer;
+    /* Loop stepped by the traced loop, the cycle loop from before the tracer was set */
+    Run_Function _run_untraced_cycles;
+    Debugger *_debugger;
+    /* Loop stepped by the debugged loop, the cycle loop from before the debugger was made active */
+    Run_Function _run_undebugged_cycles;
+    /* Cycles of the batch not run when the machine stopped at a BREAK, and whether the batch was a frame */
+    uint32_t _break_remaining;
+    bool _break_in_frame;
+    /* Set while resuming, so the breakpoint the machine stopped at lets its instruction run */
+    bool _resuming;
 };
 
 #endif
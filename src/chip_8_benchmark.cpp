@@ -0,0 +1,155 @@
+#include <boost/program_options.hpp>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+#include "benchmark.h"
+#include "chip_8.h"
+
+typedef struct Benchmark_Arguments {
+  uint32_t repetitions;
+  uint64_t cycles;
+  /* Only run the ROM with this name, empty runs all of them */
+  std::string rom;
+  std::vector<Dispatch_Mode> dispatches;
+  /* File the JSON report is written to, empty if none */
+  std::string json;
+  /* Report to compare against, empty if none */
+  std::string baseline;
+  double threshold;
+} Benchmark_Arguments;
+
+std::optional<Benchmark_Arguments> parse_arguments(int argc, char **argv) {
+  /* Descriptions of the optional flags a user can provide */
+  boost::program_options::options_description description("Options");
+  description.add_options()
+    ("help", "Print help message and exit")
+    ("repetitions", boost::program_options::value<uint32_t>()->default_value(DEFAULT_BENCHMARK_REPETITIONS), 
+      "Number of timed runs of each benchmark")
+    ("cycles", boost::program_options::value<uint64_t>()->default_value(DEFAULT_BENCHMARK_CYCLES), 
+      "Number of cycles in each run")
+    ("rom", boost::program_options::value<std::string>(), "Only run one benchmark ROM: alu, draw, memory or call")
+    ("dispatch", boost::program_options::value<std::string>()->default_value("all"), 
+      "Dispatch to benchmark: threaded, switch, jit or all")
+    ("json", boost::program_options::value<std::string>(), "Write the results as JSON to this file")
+    ("baseline", boost::program_options::value<std::string>(), 
+      "Compare against a JSON report written by an earlier run, exiting with 1 if any benchmark regressed")
+    ("threshold", boost::program_options::value<double>()->default_value(DEFAULT_REGRESSION_THRESHOLD), 
+      "Slowdown in percent of the median ns per instruction that counts as a regression");
+  boost::program_options::variables_map variables_map;
+
+  boost::program_options::store(
+    boost::program_options::command_line_parser(argc, argv)
+      .options(description)
+      .run(),
+    variables_map
+  );
+
+  boost::program_options::notify(variables_map);
+
+  /* Check for the help flag */
+  if(variables_map.count("help")) {
+    std::cout << "Usage: ./chip_8_benchmark [OPTIONS]" << std::endl;
+    std::cout << std::endl;
+    std::cout << description << std::endl;
+    return {};
+  }
+
+  Benchmark_Arguments benchmark_args{variables_map["repetitions"].as<uint32_t>(), 
+    variables_map["cycles"].as<uint64_t>(), "", {}, "", "", variables_map["threshold"].as<double>()};
+  if(benchmark_args.repetitions == 0 || benchmark_args.cycles == 0) {
+    std::cout << "--repetitions and --cycles must be bigger than 0" << std::endl;
+    return {};
+  }
+  if(variables_map.count("rom")) benchmark_args.rom = variables_map["rom"].as<std::string>();
+  if(variables_map.count("json")) benchmark_args.json = variables_map["json"].as<std::string>();
+  if(variables_map.count("baseline")) benchmark_args.baseline = variables_map["baseline"].as<std::string>();
+
+  std::string dispatch = variables_map["dispatch"].as<std::string>();
+  if(dispatch == "all") {
+    benchmark_args.dispatches = {Dispatch_Mode::SWITCH, Dispatch_Mode::THREADED, Dispatch_Mode::JIT};
+  } else if(dispatch == "threaded") {
+    benchmark_args.dispatches = {Dispatch_Mode::THREADED};
+  } else if(dispatch == "switch") {
+    benchmark_args.dispatches = {Dispatch_Mode::SWITCH};
+  } else if(dispatch == "jit") {
+    benchmark_args.dispatches = {Dispatch_Mode::JIT};
+  } else {
+    std::cout << "Unknown dispatch " << dispatch << ", use threaded, switch, jit or all" << std::endl;
+    return {};
+  }
+
+  return {benchmark_args};
+}
+
+int main(int argc, char **argv) {
+  /* Parse command line arguments */
+  std::optional<Benchmark_Arguments> opt_arguments = parse_arguments(argc, argv);
+  /* If the command line arguments parsing failed, return from the program */
+  if(!opt_arguments) return 0;
+  Benchmark_Arguments benchmark_args = *opt_arguments;
+
+  std::map<std::string, double> baseline;
+  if(!benchmark_args.baseline.empty() && !load_benchmark_baseline(benchmark_args.baseline, baseline)) {
+    std::cout << benchmark_args.baseline << " could not be read" << std::endl;
+    return 1;
+  }
+
+  std::vector<Benchmark_Result> results;
+  size_t regressions = 0;
+  std::cout << std::left << std::setw(20) << "benchmark" << std::right << std::setw(12) << "ns/instr" 
+    << std::setw(10) << "stddev" << std::setw(14) << "instr/s" << std::setw(12) << "us/frame";
+  if(!baseline.empty()) std::cout << std::setw(12) << "baseline";
+  std::cout << std::endl;
+
+  for(const Benchmark_Rom &rom : benchmark_roms()) {
+    if(!benchmark_args.rom.empty() && rom.name != benchmark_args.rom) continue;
+    for(Dispatch_Mode dispatch : benchmark_args.dispatches) {
+      Benchmark_Result result = run_benchmark(rom, dispatch, benchmark_args.cycles, benchmark_args.repetitions);
+      /* A JIT that is not available falls back to threaded, which has already been run */
+      bool repeated = false;
+      for(const Benchmark_Result &earlier : results) {
+        repeated = repeated || earlier.name == result.name;
+      }
+      if(repeated) continue;
+
+      Benchmark_Statistics instruction = get_statistics(result.ns_per_instruction);
+      Benchmark_Statistics frame = get_statistics(result.frame_ns);
+      std::cout << std::left << std::setw(20) << result.name << std::right << std::fixed 
+        << std::setprecision(3) << std::setw(12) << instruction.median << std::setw(10) << instruction.stddev 
+        << std::setprecision(0) << std::setw(14) << (instruction.median > 0 ? 1e9 / instruction.median : 0) 
+        << std::setprecision(2) << std::setw(12) << frame.median / 1000;
+
+      /* Compare medians, which are not moved by the odd slow repetition */
+      std::map<std::string, double>::const_iterator reference = baseline.find(result.name);
+      if(reference != baseline.end() && reference->second > 0) {
+        double change = (instruction.median / reference->second - 1) * 100;
+        std::cout << std::setw(11) << std::showpos << change << std::noshowpos << "%";
+        if(change > benchmark_args.threshold) {
+          std::cout << " REGRESSION";
+          regressions++;
+        }
+      }
+      std::cout << std::endl;
+      results.push_back(result);
+    }
+  }
+
+  if(!benchmark_args.json.empty()) {
+    std::ofstream json(benchmark_args.json);
+    if(!json.is_open()) {
+      std::cout << benchmark_args.json << " could not be opened for writing" << std::endl;
+      return 1;
+    }
+    write_benchmark_report(json, results);
+  }
+
+  if(regressions > 0) {
+    std::cout << regressions << " benchmarks regressed by more than " << benchmark_args.threshold << "%" << std::endl;
+    return 1;
+  }
+  return 0;
+}
\ No newline at end of file
@@ -1,26 +1,66 @@
 #include <boost/program_options.hpp>
-#include <chrono>
+#include <cerrno>
 #include <iostream>
 #include <memory>
+#include <random>
 #include <string>
+#include "audio.h"
+#include "audio_stream.h"
 #include "chip_8.h"
+#include "emulation_thread.h"
+#include "frame_capture.h"
+#include "hash.h"
+#include "input_log.h"
+#include "keyboard_input.h"
+#include "options.h"
+#include "rom_cache.h"
+#include "scheduler.h"
 #include "screen.h"
+#include "shared_memory_export.h"
 
-#define TIMER_FRAME_DURATION 16.666
-#define CYCLE_FRAME_DURATION 0.1
+typedef struct Emulator_Arguments {
+  Arguments args;
+  uint32_t cycles_per_frame;
+  Speed_Mode speed;
+  uint32_t turbo_factor;
+  /* File the key presses are recorded to, empty if none */
+  std::string record_input;
+  /* Directory of the caches of what earlier runs learnt about each ROM, empty to not use them */
+  std::string cache_directory;
+  /* A profile or quirk flag was given, so the quirks cached for the ROM are not used */
+  bool quirks_given;
+  bool mute;
+  /* Destination of the display of every frame, empty if none */
+  std::string capture;
+  Capture_Format capture_format;
+  /* Name of the shared memory object frames are published to, empty if none */
+  std::string shared_memory;
+} Emulator_Arguments;
 
-std::optional<Arguments> parse_arguments(int argc, char **argv) {
+std::optional<Emulator_Arguments> parse_arguments(int argc, char **argv) {
   /* Descriptions of the optional flags a user can provide */
   boost::program_options::options_description description("Options");
   description.add_options()
     ("help", "Print help message and exit")
     ("input-file", boost::program_options::value<std::string>(), "Specify the path of the ROM to be loaded")
-    ("dw", "Sets display waiting to off (default: on)")
-    ("vfreset", "AND, OR, XOR reset flag register to 0 to off (default: on)")
-    ("meminc", "Increments index register when loading from and storing to memory to off (default: on)")
-    ("noclip", "Clip sprite at edge of screen to off (default: on)")
-    ("shiftx", "Shift operations will only affect register x to on (default: off)")
-    ("jumpx", "Jumps will use register x to on (default: off)");
+    ("cycles-per-frame", boost::program_options::value<uint32_t>()->default_value(DEFAULT_CYCLES_PER_FRAME),
+      "Number of cycles run in each 60Hz frame")
+    ("speed", boost::program_options::value<std::string>()->default_value("normal"),
+      "normal (60 frames per second), turbo (several frames per 60Hz deadline) or unthrottled")
+    ("turbo-factor", boost::program_options::value<uint32_t>()->default_value(DEFAULT_TURBO_FACTOR),
+      "Number of frames run per 60Hz deadline in turbo speed")
+    ("record-input", boost::program_options::value<std::string>(), 
+      "Record the seed and every key press to this file, to be replayed by chip_8_headless --replay")
+    ("cache-dir", boost::program_options::value<std::string>()->default_value(default_rom_cache_directory()), 
+      "Directory of the caches of decoded instructions, translated blocks and quirks of each ROM")
+    ("no-cache", "Start without a cache and do not write one")
+    ("mute", "Do not play the buzzer")
+    ("shm", boost::program_options::value<std::string>(), 
+      "Publish the display and registers of every frame to this POSIX shared memory object (e.g. /chip8) "
+      "and take key presses from it, see chip_8_shm.h");
+  add_quirk_options(description);
+  add_execution_options(description);
+  add_capture_options(description);
   /* Make the input-file flag optional, user can provide a file name only without using the input-file flag */
   boost::program_options::positional_options_description pod;
   pod.add("input-file", -1);
@@ -46,7 +86,8 @@ std::optional<Arguments> parse_arguments(int argc, char **argv) {
     return {};
   }
 
-  Arguments args{"", true, true, true, true, false, false};
+  Emulator_Arguments emulator_args{default_arguments(), 0, Speed_Mode::NORMAL, 0, "", "", false, false, "", 
+    Capture_Format::Y4M, ""};
 
   /* Check for the input-file flag */
   if(!variables_map.count("input-file")) {
@@ -54,87 +95,193 @@ std::optional<Arguments> parse_arguments(int argc, char **argv) {
     std::cout << "Use --help for more info" << std::endl;
     return {};
   } else {
-    args.file_name = variables_map["input-file"].as<std::string>();
+    emulator_args.args.file_name = variables_map["input-file"].as<std::string>();
   }
 
-  if(variables_map.count("dw")) {
-    args.dw = false;
-  }
-
-  if(variables_map.count("vfreset")) {
-    args.vfreset = false;
-  }
-
-  if(variables_map.count("meminc")) {
-    args.meminc = false;
-  }
+  emulator_args.cycles_per_frame = variables_map["cycles-per-frame"].as<uint32_t>();
+  emulator_args.turbo_factor = variables_map["turbo-factor"].as<uint32_t>();
+  if(variables_map.count("record-input")) emulator_args.record_input = variables_map["record-input"].as<std::string>();
+  if(!variables_map.count("no-cache")) emulator_args.cache_directory = variables_map["cache-dir"].as<std::string>();
+  emulator_args.quirks_given = has_quirk_options(variables_map);
+  emulator_args.mute = variables_map.count("mute") > 0;
+  if(variables_map.count("shm")) emulator_args.shared_memory = variables_map["shm"].as<std::string>();
 
-  if(variables_map.count("noclip")) {
-    args.clip = false;
-  }
-  
-  if(variables_map.count("shiftx")) {
-    args.shiftx = true;
+  std::string speed = variables_map["speed"].as<std::string>();
+  if(speed == "normal") {
+    emulator_args.speed = Speed_Mode::NORMAL;
+  } else if(speed == "turbo") {
+    emulator_args.speed = Speed_Mode::TURBO;
+  } else if(speed == "unthrottled") {
+    emulator_args.speed = Speed_Mode::UNTHROTTLED;
+  } else {
+    std::cout << "Unknown speed " << speed << ", use normal, turbo or unthrottled" << std::endl;
+    return {};
   }
 
-  if(variables_map.count("jumpx")) {
-    args.jumpx = true;
-  }
+  if(!apply_quirk_options(variables_map, emulator_args.args)) return {};
+  if(!apply_execution_options(variables_map, emulator_args.args)) return {};
+  if(!apply_capture_options(variables_map, emulator_args.capture, emulator_args.capture_format)) return {};
 
-  return {args};
+  return {emulator_args};
 }
 
 int main(int argc, char **argv) {
   /* Parse command line arguments */
-  std::optional<Arguments> opt_arguments = parse_arguments(argc, argv);
+  std::optional<Emulator_Arguments> opt_arguments = parse_arguments(argc, argv);
   /* If the command line arguments parsing failed, return from the program */
   if(!opt_arguments) return 0;
-  Arguments args = *opt_arguments;
+  Emulator_Arguments emulator_args = *opt_arguments;
+  Arguments args = emulator_args.args;
+
+  /* A recording has to know its seed, so draw one here if none was given */
+  bool recording = !emulator_args.record_input.empty();
+  if(recording && !args.seed) {
+    std::random_device random_device;
+    args.seed = random_device();
+  }
+
+  /* Read the ROM first, the hash of its contents names the cache of what earlier runs learnt about it */
+  std::vector<uint8_t> rom;
+  if(!read_rom_file(args.file_name, rom)) {
+    std::cout << args.file_name << " could not be loaded. Check if this file exists, the path supplied "
+      "is correct and the ROM fits in the " << MAX_ROM_SIZE << " bytes of program memory" << std::endl;
+    return 0;
+  }
+  uint64_t rom_hash = fnv1a_64(rom.data(), rom.size());
+  std::string cache_path = emulator_args.cache_directory.empty() ? "" : rom_cache_path(emulator_args.cache_directory, rom_hash);
+  Rom_Cache rom_cache;
+  bool cached = !cache_path.empty() && load_rom_cache(cache_path, rom_hash, rom_cache);
+  if(!cached) init_rom_cache(rom_cache, rom_hash, rom.size(), get_quirks(args), args.platform);
+
+  /* Unless told otherwise, run the ROM on the platform and with the quirks it was last run with */
+  if(cached && !emulator_args.quirks_given) {
+    set_quirks(args, rom_cache.quirks);
+    args.platform = static_cast<Platform>(rom_cache.platform);
+  }
 
   std::unique_ptr<Chip_8> chip_8 = std::make_unique<Chip_8>(args);
-  /* Load the ROM and check if it was successful */
-  bool success = chip_8->load_ROM();
-  if(!success) {
-    std::cout << args.file_name << " could not be opened. Check "
-      "if this file exists and the path supplied is correct" << std::endl;
+  if(!chip_8->load_ROM(rom)) {
+    std::cout << args.file_name << " does not fit in the " << platform_memory_size(args.platform) - PROGRAM_ADDRESS 
+      << " bytes of program memory of the platform, XO-CHIP ROMs need --profile xochip" << std::endl;
+    return 0;
+  }
+  if(cached) chip_8->warm_start(rom_cache);
+
+  /* The window is sized for the 64x32 mode, the 128x64 mode is drawn at half the scale */
+  std::unique_ptr<Screen> screen = std::make_unique<Screen>(LORES_HEIGHT, LORES_WIDTH);
+  Keyboard_Input keyboard_input;
+  /* Key events are logged with the cycle they reach the keypad at, on the emulation thread */
+  Input_Log input_log{args.seed.value_or(0), chip_8->get_quirk_bits(), chip_8->get_platform(), 
+    emulator_args.cycles_per_frame, 0, 0, {}};
+  /* Keys set by shared memory clients are merged with the keyboard's, and recorded with them */
+  Shared_Memory_Export shared_memory(keyboard_input);
+  if(!emulator_args.shared_memory.empty() && !shared_memory.open(emulator_args.shared_memory)) {
+    if(errno == EEXIST) {
+      std::cout << emulator_args.shared_memory << " is already in use as shared memory, by another instance or one that "
+        "did not exit cleanly, in which case it can be removed from /dev/shm" << std::endl;
+    } else {
+      std::cout << emulator_args.shared_memory << " could not be created as shared memory" << std::endl;
+    }
     return 0;
   }
+  Input_Recorder recorder(shared_memory, *chip_8, input_log);
+  Input_Source &input = recording ? static_cast<Input_Source &>(recorder) : shared_memory;
+
+  /* Emulate on its own thread, this thread keeps the window since some platforms only allow it on the main thread */
+  Emulation_Thread emulation(*chip_8, input, emulator_args.cycles_per_frame, 
+    emulator_args.speed, emulator_args.turbo_factor);
+  /* Poll events and present at 60Hz, independent of the emulation speed */
+  Frame_Scheduler present_scheduler(Speed_Mode::NORMAL);
+  /* Display currently in the window, used to find the rows a new frame changed */
+  Framebuffer presented{};
+  uint64_t forced_rows = ALL_ROWS_DIRTY;
 
-  std::unique_ptr<Screen> screen = std::make_unique<Screen>(DISPLAY_HEIGHT, DISPLAY_WIDTH);
+  /* Save states go next to the ROM */
+  emulation.set_state_file(args.file_name + ".state");
 
-  /* Get the current time */
-  std::chrono::system_clock::time_point prev_timer_time = std::chrono::system_clock::now();
-  std::chrono::system_clock::time_point prev_cycle_time = std::chrono::system_clock::now();
-  std::chrono::system_clock::time_point curr_time = std::chrono::system_clock::now();
+  /* The emulation thread renders each frame's audio into the ring, SFML's audio thread plays it */
+  Audio_Ring audio_ring;
+  Audio_Generator audio_generator(audio_ring);
+  Audio_Stream audio_stream(audio_ring);
+  if(!emulator_args.mute) chip_8->set_audio(&audio_generator);
+
+  /* Frames are copied out on the emulation thread and written on the capture's own thread */
+  std::unique_ptr<Frame_Capture> capture;
+  if(!emulator_args.capture.empty()) {
+    capture = std::make_unique<Frame_Capture>(emulator_args.capture_format);
+    if(!capture->open(emulator_args.capture)) {
+      std::cout << emulator_args.capture << " could not be opened for writing" << std::endl;
+      return 0;
+    }
+    emulation.set_capture(capture.get());
+  }
+  if(!emulator_args.shared_memory.empty()) emulation.set_shared_memory(&shared_memory);
 
+  emulation.start();
+  if(!emulator_args.mute) audio_stream.play();
   while(screen->is_open()) {
-    curr_time = std::chrono::system_clock::now();
-    std::chrono::duration<double, std::milli> cycle_time_passed = curr_time - prev_cycle_time;
-    std::chrono::duration<double, std::milli> timer_time_passed = curr_time - prev_timer_time;
-
-    /* 
-      If enough time has passed since we lasted checked, run one cycle
-      (Around 700 times per second) 
-    */
-    if(cycle_time_passed.count() >= CYCLE_FRAME_DURATION) {
-      prev_cycle_time = curr_time;
-      screen->poll_events();
-      chip_8->update_keyboard_status();
-      chip_8->run_cycle();
+    screen->poll_events(keyboard_input);
+    Emulator_Command command;
+    while(keyboard_input.poll_command(command)) {
+      emulation.send_command(command);
     }
 
-    /* 
-      If enough time has passed since we lasted checked, decrease both timers
-      and update screen 
-      (Decrease around 60 times per second) 
-    */
-    if(timer_time_passed.count() >= TIMER_FRAME_DURATION) {
-      prev_timer_time = curr_time;
-      chip_8->decrease_delay_timer();
-      chip_8->decrease_sound_timer();
-      screen->display(chip_8->get_data());
-      chip_8->set_refresh_state();
+    /* Frames published since the last present were overwritten, so compare against what is on screen */
+    if(const Published_Frame *frame = emulation.take_frame()) {
+      screen->display(frame->framebuffer, framebuffer_changed_rows(presented, frame->framebuffer) | forced_rows);
+      presented = frame->framebuffer;
+      forced_rows = 0;
+    } else {
+      /* Paused or waiting on the emulation, the window is still repainted in case it was uncovered */
+      screen->present();
     }
+
+    /* Skip any deadlines missed while the window was busy, then sleep until the next one */
+    present_scheduler.frames_to_run();
+    present_scheduler.wait_for_deadline();
+  }
+  emulation.stop();
+  audio_stream.stop();
+
+  if(capture) {
+    if(!capture->close()) std::cout << emulator_args.capture << " could not be written" << std::endl;
+    Capture_Statistics capture_statistics = capture->get_statistics();
+    std::cout << "Captured " << capture_statistics.frames_written << " frames to " << emulator_args.capture;
+    if(capture_statistics.frames_dropped > 0) std::cout << ", " << capture_statistics.frames_dropped << " dropped";
+    std::cout << std::endl;
+  }
+
+  if(!cache_path.empty()) {
+    chip_8->fill_rom_cache(rom_cache);
+    if(!save_rom_cache(cache_path, rom_cache)) std::cout << cache_path << " could not be written" << std::endl;
+  }
+
+  if(recording) {
+    input_log.total_cycles = chip_8->get_cycle_count();
+    input_log.final_state_hash = chip_8->get_state_hash();
+    if(save_input_log(emulator_args.record_input, input_log)) {
+      std::cout << "Recorded " << input_log.events.size() << " key events to " << emulator_args.record_input << std::endl;
+    } else {
+      std::cout << emulator_args.record_input << " could not be written" << std::endl;
+    }
+  }
+
+  /* Report how long key events waited before the emulator saw them */
+  const Input_Latency &latency = chip_8->get_input_latency();
+  if(latency.events > 0) {
+    std::cout << "Input latency: average " 
+      << std::chrono::duration_cast<std::chrono::microseconds>(latency.total).count() / latency.events
+      << "us, max " << std::chrono::duration_cast<std::chrono::microseconds>(latency.max).count()
+      << "us over " << latency.events << " key events" << std::endl;
+  }
+  if(keyboard_input.get_dropped_events() > 0) {
+    std::cout << "Dropped " << keyboard_input.get_dropped_events() << " key events" << std::endl;
+  }
+  /* Underruns are heard as gaps, dropped samples as skips when emulation runs ahead of playback */
+  Audio_Statistics audio_statistics = audio_ring.get_statistics();
+  if(audio_statistics.underruns > 0 || audio_statistics.samples_dropped > 0) {
+    std::cout << "Audio: " << audio_statistics.underruns << " underruns, " << audio_statistics.samples_dropped 
+      << " samples dropped" << std::endl;
   }
 
   return 0;
@@ -0,0 +1,648 @@
+#include <algorithm>
+#include <boost/program_options.hpp>
+#include <cerrno>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include "chip_8.h"
+#include "audio.h"
+#include "conformance.h"
+#include "frame_capture.h"
+#include "gdb_stub.h"
+#include "input_log.h"
+#include "multi_chip_8.h"
+#include "options.h"
+#include "rom_cache.h"
+#include "save_state.h"
+#include "shared_memory_export.h"
+#include "trace.h"
+#include "wav_sink.h"
+#include "work_stealing_pool.h"
+
+typedef struct Headless_Arguments {
+  Arguments args;
+  Run_Length run_length;
+  bool verify;
+  /* Manifest of conformance cases to run instead of a single ROM, empty if none */
+  std::string manifest;
+  /* File the conformance report is written to, empty for standard output */
+  std::string report;
+  size_t jobs;
+  /* Number of machines run in lockstep by the multi-instance engine, 0 runs a single Chip_8 */
+  size_t lanes;
+  /* Save state to resume from and to write at the end, empty if none */
+  std::string load_state;
+  std::string save_state;
+  /* Input log to replay, which also sets the seed, quirks and run length, empty if none */
+  std::string replay;
+  /* File the display hash after every frame is written to, empty if none */
+  std::string hash_trace;
+  /* Files the guest profile is written to, empty if none */
+  std::string profile_json;
+  std::string profile_folded;
+  /* Directory of the caches of what earlier runs learnt about each ROM, empty to not use them */
+  std::string cache_directory;
+  /* File the audio of every frame is written to as WAV, empty if none */
+  std::string wav;
+  /* Destination of the display of every frame, empty if none */
+  std::string capture;
+  Capture_Format capture_format;
+  /* Name of the shared memory object frames are published to, empty if none */
+  std::string shared_memory;
+  /* File every instruction run is traced to, empty if none */
+  std::string trace;
+  /* Port or Unix socket path a GDB client is waited for on, empty to run without one */
+  std::string gdb;
+} Headless_Arguments;
+
+std::optional<Headless_Arguments> parse_arguments(int argc, char **argv) {
+  /* Descriptions of the optional flags a user can provide */
+  boost::program_options::options_description description("Options");
+  description.add_options()
+    ("help", "Print help message and exit")
+    ("input-file", boost::program_options::value<std::string>(), "Specify the path of the ROM to be loaded")
+    ("verify", "Run a switch dispatch machine in lockstep and stop at the first frame where their states differ")
+    ("manifest", boost::program_options::value<std::string>(), 
+      "Run every ROM listed in the manifest in parallel and report which ones end on their expected framebuffer hash")
+    ("report", boost::program_options::value<std::string>(), "Write the JSON conformance report to this file instead of the standard output")
+    ("jobs", boost::program_options::value<size_t>()->default_value(0), "Number of threads running the manifest, 0 uses one per core")
+    ("lanes", boost::program_options::value<size_t>()->default_value(0), 
+      "Run this many copies of the ROM in lockstep, lane N seeded with N, and report their combined speed")
+    ("load-state", boost::program_options::value<std::string>(), "Resume from this save state instead of the start of the ROM")
+    ("save-state", boost::program_options::value<std::string>(), "Write the state of the machine to this file after the run")
+    ("replay", boost::program_options::value<std::string>(), 
+      "Run the ROM with the seed, quirks and key presses of an input log recorded by the emulator, and check it ends on the same state")
+    ("hash-trace", boost::program_options::value<std::string>(), "Write the display hash after every frame to this file")
+    ("wav", boost::program_options::value<std::string>(), 
+      "Write the buzzer to this WAV file, read from the audio ring at the rate a sound card would, and report underruns")
+    ("shm", boost::program_options::value<std::string>(), 
+      "Publish the display and registers of every frame to this POSIX shared memory object (e.g. /chip8) "
+      "and take key presses from it, see chip_8_shm.h")
+    ("trace", boost::program_options::value<std::string>(), 
+      "Record every instruction run to this binary trace, to be compared with chip_8_trace_diff")
+    ("gdb", boost::program_options::value<std::string>(), 
+      "Wait for a GDB client on this port of 127.0.0.1, or on a Unix socket at this path, and let it debug the ROM")
+    ("cache-dir", boost::program_options::value<std::string>(), 
+      "Start from the decoded instructions and translated blocks cached for the ROM in this directory, and update them");
+#if CHIP_8_PROFILER
+  description.add_options()
+    ("profile-json", boost::program_options::value<std::string>(), 
+      "Write the instructions run per opcode and address, the calls and the loops as JSON to this file")
+    ("profile-folded", boost::program_options::value<std::string>(), 
+      "Write the instructions run in each guest call stack to this file, in the folded format of flame graph tools");
+#endif
+  add_run_length_options(description);
+  add_quirk_options(description);
+  add_execution_options(description);
+  add_capture_options(description);
+  /* Make the input-file flag optional, user can provide a file name only without using the input-file flag */
+  boost::program_options::positional_options_description pod;
+  pod.add("input-file", -1);
+  boost::program_options::variables_map variables_map;
+
+  boost::program_options::store(
+    boost::program_options::command_line_parser(argc, argv)
+      .options(description)
+      .positional(pod)
+      .run(),
+    variables_map
+  );
+
+  boost::program_options::notify(variables_map);
+
+  /* Check for the help flag */
+  if(variables_map.count("help")) {
+    std::cout << "Usage: ./chip_8_headless [OPTIONS] (--cycles N | --frames N) <PATH-TO-ROM>" << std::endl;
+    std::cout << "       ./chip_8_headless [OPTIONS] --replay <PATH-TO-INPUT-LOG> <PATH-TO-ROM>" << std::endl;
+    std::cout << "       ./chip_8_headless --manifest <PATH-TO-MANIFEST> [--report <PATH>] [--jobs N]" << std::endl;
+    std::cout << std::endl;
+    std::cout << description << std::endl;
+    return {};
+  }
+
+  Headless_Arguments headless_args{default_arguments(), {0, 0, 0}, false, "", "", 0, 0, "", "", "", "", "", "", "", "", "", 
+    Capture_Format::Y4M, "", "", ""};
+
+  /* A manifest carries the ROMs and run lengths itself */
+  if(variables_map.count("manifest")) {
+    headless_args.manifest = variables_map["manifest"].as<std::string>();
+    if(variables_map.count("report")) headless_args.report = variables_map["report"].as<std::string>();
+    headless_args.jobs = variables_map["jobs"].as<size_t>();
+    return {headless_args};
+  }
+
+  /* Check for the input-file flag */
+  if(!variables_map.count("input-file")) {
+    std::cout << "Please provide a path to a Chip 8 ROM" << std::endl;
+    std::cout << "Use --help for more info" << std::endl;
+    return {};
+  } else {
+    headless_args.args.file_name = variables_map["input-file"].as<std::string>();
+  }
+
+  if(variables_map.count("hash-trace")) headless_args.hash_trace = variables_map["hash-trace"].as<std::string>();
+  if(variables_map.count("trace")) headless_args.trace = variables_map["trace"].as<std::string>();
+  if(variables_map.count("gdb")) headless_args.gdb = variables_map["gdb"].as<std::string>();
+  if(variables_map.count("shm")) headless_args.shared_memory = variables_map["shm"].as<std::string>();
+  if(variables_map.count("wav")) headless_args.wav = variables_map["wav"].as<std::string>();
+  if(variables_map.count("cache-dir")) headless_args.cache_directory = variables_map["cache-dir"].as<std::string>();
+  if(variables_map.count("profile-json")) headless_args.profile_json = variables_map["profile-json"].as<std::string>();
+  if(variables_map.count("profile-folded")) headless_args.profile_folded = variables_map["profile-folded"].as<std::string>();
+
+  /* A replay runs for as long as the recording did */
+  if(variables_map.count("replay")) {
+    headless_args.replay = variables_map["replay"].as<std::string>();
+    if(variables_map.count("verify") || variables_map["lanes"].as<size_t>() > 0) {
+      std::cout << "--replay cannot be used with --verify or --lanes" << std::endl;
+      return {};
+    }
+  } else if(!apply_run_length_options(variables_map, headless_args.run_length)) {
+    std::cout << "Use --help for more info" << std::endl;
+    return {};
+  }
+
+  headless_args.verify = variables_map.count("verify") > 0;
+  headless_args.lanes = variables_map["lanes"].as<size_t>();
+  if(variables_map.count("load-state")) headless_args.load_state = variables_map["load-state"].as<std::string>();
+  if(variables_map.count("save-state")) headless_args.save_state = variables_map["save-state"].as<std::string>();
+
+  if(!apply_quirk_options(variables_map, headless_args.args)) return {};
+  if(!apply_execution_options(variables_map, headless_args.args)) return {};
+  if(!apply_capture_options(variables_map, headless_args.capture, headless_args.capture_format)) return {};
+
+  if(headless_args.lanes > 0 && headless_args.args.platform != Platform::COSMAC_VIP) {
+    std::cout << "--lanes only runs ROMs for the original platform (--profile vip)" << std::endl;
+    return {};
+  }
+
+  if(!headless_args.wav.empty() && (headless_args.verify || headless_args.lanes > 0)) {
+    std::cout << "--wav cannot be used with --verify or --lanes" << std::endl;
+    return {};
+  }
+
+  if((!headless_args.capture.empty() || !headless_args.shared_memory.empty() || !headless_args.trace.empty()) && 
+    (headless_args.verify || headless_args.lanes > 0)) {
+    std::cout << "--capture, --shm and --trace cannot be used with --verify or --lanes" << std::endl;
+    return {};
+  }
+
+  if(!headless_args.gdb.empty() && (headless_args.verify || headless_args.lanes > 0 || !headless_args.trace.empty())) {
+    std::cout << "--gdb cannot be used with --verify, --lanes or --trace" << std::endl;
+    return {};
+  }
+
+  return {headless_args};
+}
+
+/* 
+  Number of cycles into the frame after which the machine first differs from a switch dispatch reference, 
+  found by running both afresh up to the frame and halving the cycles run in it, with the address of the 
+  instruction that made them differ. Returns the cycles of the frame if they only differ once it has ended
+*/
+uint64_t find_first_difference(const Arguments &args, const std::vector<uint8_t> &rom, const Rom_Cache *warm_cache, 
+  const Run_Length &run_length, uint64_t frame, uint16_t &address) {
+  auto differs_after = [&](uint64_t cycles) {
+    Arguments reference_args = args;
+    reference_args.dispatch = Dispatch_Mode::SWITCH;
+    std::unique_ptr<Chip_8> machine = std::make_unique<Chip_8>(args);
+    std::unique_ptr<Chip_8> reference = std::make_unique<Chip_8>(reference_args);
+    machine->load_ROM(rom);
+    reference->load_ROM(rom);
+    if(warm_cache) machine->warm_start(*warm_cache);
+    machine->seed_random(args.seed.value_or(0));
+    reference->seed_random(args.seed.value_or(0));
+    for(uint64_t i = 0; i < frame; i++) {
+      machine->run_frame(run_length.cycles_per_frame);
+      reference->run_frame(run_length.cycles_per_frame);
+    }
+    machine->run_cycles(cycles);
+    reference->run_cycles(cycles - 1);
+    address = reference->get_state().program_counter;
+    reference->run_cycles(1);
+    return machine->get_state_hash() != reference->get_state_hash();
+  };
+
+  uint64_t frame_cycles = std::min<uint64_t>(run_length.cycles_per_frame, 
+    run_length.cycles - frame * run_length.cycles_per_frame);
+  if(frame_cycles == 0 || !differs_after(frame_cycles)) return frame_cycles;
+  /* The states are the same after low cycles, and differ after high */
+  uint64_t low = 0;
+  uint64_t high = frame_cycles;
+  while(high - low > 1) {
+    uint64_t middle = low + (high - low) / 2;
+    if(differs_after(middle)) {
+      high = middle;
+    } else {
+      low = middle;
+    }
+  }
+  differs_after(high);
+  return high;
+}
+
+/* Run the ROM on the multi-instance engine, checking every lane against its own switch dispatch machine with --verify */
+int run_lanes(const Headless_Arguments &headless_args) {
+  const Run_Length &run_length = headless_args.run_length;
+  std::unique_ptr<Multi_Chip_8> multi_chip_8 = std::make_unique<Multi_Chip_8>(headless_args.args, headless_args.lanes);
+  if(!multi_chip_8->load_ROM()) {
+    std::cout << headless_args.args.file_name << " could not be loaded. Check if this file exists, the path supplied "
+      "is correct and the ROM fits in the " << MEMORY_SIZE - PROGRAM_ADDRESS << " bytes of program memory" << std::endl;
+    return 1;
+  }
+
+  if(headless_args.verify) {
+    Arguments reference_args = headless_args.args;
+    reference_args.dispatch = Dispatch_Mode::SWITCH;
+    std::vector<std::unique_ptr<Chip_8>> references;
+    for(size_t lane = 0; lane < headless_args.lanes; lane++) {
+      references.push_back(std::make_unique<Chip_8>(reference_args));
+      references.back()->load_ROM();
+      references.back()->seed_random(lane);
+    }
+
+    uint64_t frames = (run_length.cycles + run_length.cycles_per_frame - 1) / run_length.cycles_per_frame;
+    for(uint64_t i = 0; i < frames; i++) {
+      uint64_t cycles = std::min<uint64_t>(run_length.cycles_per_frame, run_length.cycles - i * run_length.cycles_per_frame);
+      multi_chip_8->run_frame(cycles);
+      for(size_t lane = 0; lane < headless_args.lanes; lane++) {
+        references[lane]->run_frame(cycles);
+        if(references[lane]->get_state_hash() != multi_chip_8->get_state_hash(lane)) {
+          std::cout << "verify: FAILED, lane " << lane << " differs after frame " << i << std::endl;
+          return 1;
+        }
+      }
+    }
+    std::cout << "verify: passed " << frames << " frames on " << headless_args.lanes << " lanes" << std::endl;
+    return 0;
+  }
+
+  std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+  uint64_t whole_frames = run_length.cycles / run_length.cycles_per_frame;
+  for(uint64_t i = 0; i < whole_frames; i++) {
+    multi_chip_8->run_frame(run_length.cycles_per_frame);
+  }
+  multi_chip_8->run_cycles(run_length.cycles % run_length.cycles_per_frame);
+  std::chrono::steady_clock::time_point end_time = std::chrono::steady_clock::now();
+
+  std::chrono::duration<double> elapsed = end_time - start_time;
+  uint64_t instructions = run_length.cycles * headless_args.lanes;
+  double instructions_per_second = elapsed.count() > 0 ? instructions / elapsed.count() : 0;
+  double groups_per_cycle = multi_chip_8->get_cycle_count() > 0 ? 
+    static_cast<double>(multi_chip_8->get_group_count()) / multi_chip_8->get_cycle_count() : 0;
+
+  std::cout << "lanes: " << headless_args.lanes << std::endl;
+  std::cout << "cycles: " << run_length.cycles << std::endl;
+  std::cout << "frames: " << whole_frames << std::endl;
+  std::cout << "elapsed_seconds: " << std::fixed << std::setprecision(6) << elapsed.count() << std::endl;
+  std::cout << "instructions_per_second: " << std::setprecision(0) << instructions_per_second << std::endl;
+  std::cout << "groups_per_cycle: " << std::setprecision(3) << groups_per_cycle << std::endl;
+  std::cout << "framebuffer_hash: " << std::hex << std::setw(16) << std::setfill('0')
+    << multi_chip_8->get_display_hash(0) << std::endl;
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  /* Parse command line arguments */
+  std::optional<Headless_Arguments> opt_arguments = parse_arguments(argc, argv);
+  /* If the command line arguments parsing failed, return from the program */
+  if(!opt_arguments) return 0;
+  Headless_Arguments headless_args = *opt_arguments;
+
+  /* Run every case of the manifest and fail if any of them did not end on its expected hash */
+  if(!headless_args.manifest.empty()) {
+    std::vector<Conformance_Case> cases;
+    if(!load_manifest(headless_args.manifest, cases)) return 1;
+
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+    Work_Stealing_Pool pool(headless_args.jobs);
+    std::vector<Conformance_Result> results = run_conformance(cases, pool);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+
+    if(headless_args.report.empty()) {
+      write_conformance_report(std::cout, cases, results, pool.get_thread_count(), elapsed.count());
+    } else {
+      std::ofstream report(headless_args.report);
+      if(!report.is_open()) {
+        std::cout << headless_args.report << " could not be opened for writing" << std::endl;
+        return 1;
+      }
+      write_conformance_report(report, cases, results, pool.get_thread_count(), elapsed.count());
+    }
+
+    size_t failures = std::count_if(results.begin(), results.end(), [](const Conformance_Result &result) {
+      return result.status == Conformance_Status::FAILED || result.status == Conformance_Status::ERRORED;
+    });
+    if(!headless_args.report.empty()) {
+      std::cout << "conformance: " << failures << " of " << cases.size() << " cases failed in " 
+        << std::fixed << std::setprecision(3) << elapsed.count() << "s" << std::endl;
+    }
+    return failures > 0 ? 1 : 0;
+  }
+
+  /* A replay runs with the seed, quirks, platform and length of the recording */
+  Input_Log input_log{0, 0, Platform::COSMAC_VIP, 0, 0, 0, {}};
+  if(!headless_args.replay.empty()) {
+    if(!load_input_log(headless_args.replay, input_log)) {
+      std::cout << headless_args.replay << " is not a valid input log" << std::endl;
+      return 1;
+    }
+    headless_args.args.seed = input_log.seed;
+    set_quirks(headless_args.args, input_log.quirks);
+    headless_args.args.platform = input_log.platform;
+    headless_args.run_length = Run_Length{input_log.total_cycles, 
+      input_log.total_cycles / input_log.cycles_per_frame, input_log.cycles_per_frame};
+  }
+
+  const Run_Length &run_length = headless_args.run_length;
+
+  if(headless_args.lanes > 0) return run_lanes(headless_args);
+
+  std::unique_ptr<Chip_8> chip_8 = std::make_unique<Chip_8>(headless_args.args);
+  /* Load the ROM and check if it was successful */
+  std::vector<uint8_t> rom;
+  if(!read_rom_file(headless_args.args.file_name, rom) || !chip_8->load_ROM(rom)) {
+    std::cout << headless_args.args.file_name << " could not be loaded. Check if this file exists, the path supplied "
+      "is correct and the ROM fits in the " << platform_memory_size(headless_args.args.platform) - PROGRAM_ADDRESS 
+      << " bytes of program memory" << std::endl;
+    return 1;
+  }
+
+  /* The cache only changes how soon instructions are decoded and translated, never what they do */
+  std::string cache_path = headless_args.cache_directory.empty() ? "" : 
+    rom_cache_path(headless_args.cache_directory, chip_8->get_rom_hash());
+  Rom_Cache rom_cache;
+  bool warm = false;
+  if(!cache_path.empty() && load_rom_cache(cache_path, chip_8->get_rom_hash(), rom_cache)) {
+    warm = true;
+    chip_8->warm_start(rom_cache);
+  } else {
+    init_rom_cache(rom_cache, chip_8->get_rom_hash(), rom.size(), chip_8->get_quirk_bits(), chip_8->get_platform());
+  }
+
+  /* 
+    Run the machine in lockstep with a switch dispatch reference, comparing their states every frame, and 
+    narrow a difference down to the instruction it first shows after
+  */
+  if(headless_args.verify) {
+    Arguments reference_args = headless_args.args;
+    reference_args.dispatch = Dispatch_Mode::SWITCH;
+    std::unique_ptr<Chip_8> reference = std::make_unique<Chip_8>(reference_args);
+    reference->load_ROM(rom);
+    /* Both machines have to draw the same random numbers */
+    chip_8->seed_random(headless_args.args.seed.value_or(0));
+    reference->seed_random(headless_args.args.seed.value_or(0));
+
+    uint64_t frames = (run_length.cycles + run_length.cycles_per_frame - 1) / run_length.cycles_per_frame;
+    for(uint64_t i = 0; i < frames; i++) {
+      uint64_t cycles = std::min<uint64_t>(run_length.cycles_per_frame, 
+        run_length.cycles - i * run_length.cycles_per_frame);
+      chip_8->run_frame(cycles);
+      reference->run_frame(cycles);
+      if(chip_8->get_state_hash() != reference->get_state_hash()) {
+        uint16_t address = 0;
+        uint64_t cycle = find_first_difference(headless_args.args, rom, warm ? &rom_cache : nullptr, run_length, i, 
+          address);
+        std::cout << "verify: FAILED, states differ after frame " << i;
+        if(cycle < run_length.cycles_per_frame) {
+          std::cout << ", first after cycle " << i * run_length.cycles_per_frame + cycle << " running the instruction at 0x" 
+            << std::hex << std::setw(3) << std::setfill('0') << address << std::dec;
+        } else {
+          std::cout << ", first at the end of the frame";
+        }
+        std::cout << std::endl;
+        return 1;
+      }
+    }
+    std::cout << "verify: passed " << frames << " frames" << std::endl;
+    return 0;
+  }
+
+  /* Same seed as a manifest run, so the printed hash can be used as an expected hash */
+  chip_8->seed_random(headless_args.args.seed.value_or(0));
+
+  /* A save state replaces the whole machine, including the random number generator */
+  if(!headless_args.load_state.empty()) {
+    Machine_State state;
+    uint8_t quirks;
+    Platform platform;
+    if(!load_state_file(headless_args.load_state, state, quirks, platform)) {
+      std::cout << headless_args.load_state << " is not a valid save state" << std::endl;
+      return 1;
+    }
+    if(platform != chip_8->get_platform()) {
+      std::cout << headless_args.load_state << " was saved on another platform" << std::endl;
+      return 1;
+    }
+    if(quirks != chip_8->get_quirk_bits()) {
+      std::cout << "warning: state was saved with different quirks" << std::endl;
+    }
+    chip_8->set_state(state);
+  }
+
+  /* Key presses only come from a replayed log */
+  No_Input no_input;
+  Input_Replayer replayer(input_log, *chip_8);
+  Input_Source &replayed = headless_args.replay.empty() ? static_cast<Input_Source &>(no_input) : replayer;
+  /* Shared memory clients can press keys on top of the replayed ones */
+  Shared_Memory_Export shared_memory(replayed);
+  if(!headless_args.shared_memory.empty() && !shared_memory.open(headless_args.shared_memory)) {
+    if(errno == EEXIST) {
+      std::cout << headless_args.shared_memory << " is already in use as shared memory, by another instance or one that "
+        "did not exit cleanly, in which case it can be removed from /dev/shm" << std::endl;
+    } else {
+      std::cout << headless_args.shared_memory << " could not be created as shared memory" << std::endl;
+    }
+    return 1;
+  }
+  Input_Source &input = shared_memory;
+
+  std::ofstream hash_trace;
+  if(!headless_args.hash_trace.empty()) {
+    hash_trace.open(headless_args.hash_trace);
+    if(!hash_trace.is_open()) {
+      std::cout << headless_args.hash_trace << " could not be opened for writing" << std::endl;
+      return 1;
+    }
+    hash_trace << std::hex << std::setfill('0');
+  }
+
+  /* Audio goes through the same ring as in the emulator, drained one tick after each frame */
+  Audio_Ring audio_ring;
+  Audio_Generator audio_generator(audio_ring);
+  Wav_Sink wav_sink(audio_ring);
+  if(!headless_args.wav.empty()) {
+    if(!wav_sink.open(headless_args.wav)) {
+      std::cout << headless_args.wav << " could not be opened for writing" << std::endl;
+      return 1;
+    }
+    chip_8->set_audio(&audio_generator);
+  }
+
+  /* Frames are written on their own thread, frames it cannot keep up with are dropped rather than slowing the run */
+  std::unique_ptr<Frame_Capture> capture;
+  if(!headless_args.capture.empty()) {
+    capture = std::make_unique<Frame_Capture>(headless_args.capture_format);
+    if(!capture->open(headless_args.capture)) {
+      std::cout << headless_args.capture << " could not be opened for writing" << std::endl;
+      return 1;
+    }
+  }
+
+#if CHIP_8_PROFILER
+  Profiler profiler;
+  if(!headless_args.profile_json.empty() || !headless_args.profile_folded.empty()) chip_8->set_profiler(&profiler);
+#endif
+
+  /* Records are encoded and written on the tracer's own thread, in blocks */
+  std::unique_ptr<Tracer> tracer;
+  if(!headless_args.trace.empty()) {
+    tracer = std::make_unique<Tracer>();
+    if(!tracer->open(headless_args.trace, chip_8->get_platform(), chip_8->get_quirk_bits())) {
+      std::cout << headless_args.trace << " could not be opened for writing" << std::endl;
+      return 1;
+    }
+    chip_8->set_tracer(tracer.get());
+  }
+
+  /* The client gets the machine stopped before its first instruction, and again at every break */
+  Debugger debugger;
+  Gdb_Stub gdb_stub(*chip_8, debugger);
+  if(!headless_args.gdb.empty()) {
+    if(!gdb_stub.listen(headless_args.gdb)) {
+      std::cout << "gdb: could not listen on " << headless_args.gdb << std::endl;
+      return 1;
+    }
+    std::cout << "gdb: waiting for a connection on " << headless_args.gdb << std::endl;
+    if(!gdb_stub.attach()) {
+      std::cout << "gdb: the client could not connect" << std::endl;
+      return 1;
+    }
+  }
+
+  /* Run whole frames as fast as possible, then the cycles left over */
+  std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+  uint64_t whole_frames = run_length.cycles / run_length.cycles_per_frame;
+  uint64_t remaining_cycles = run_length.cycles % run_length.cycles_per_frame;
+  bool killed = false;
+  for(uint64_t i = 0; i < whole_frames && !killed; i++) {
+    chip_8->update_keyboard_status(input);
+    chip_8->run_frame(run_length.cycles_per_frame);
+    killed = !gdb_stub.after_frame(i);
+    if(!headless_args.wav.empty()) wav_sink.pull_tick();
+    if(capture) capture->capture(chip_8->get_data());
+    if(!headless_args.shared_memory.empty()) shared_memory.publish(*chip_8, i + 1);
+    if(hash_trace.is_open()) hash_trace << std::setw(16) << chip_8->get_display_hash() << "\n";
+  }
+  if(!killed) {
+    chip_8->update_keyboard_status(input);
+    chip_8->run_cycles(remaining_cycles);
+    gdb_stub.after_frame(whole_frames);
+  }
+  std::chrono::steady_clock::time_point end_time = std::chrono::steady_clock::now();
+  if(killed) {
+    std::cout << "gdb: killed by the client" << std::endl;
+    return 1;
+  }
+  gdb_stub.finish(0);
+
+  std::chrono::duration<double> elapsed = end_time - start_time;
+  double instructions_per_second = elapsed.count() > 0 ? run_length.cycles / elapsed.count() : 0;
+
+  std::cout << "cycles: " << run_length.cycles << std::endl;
+  std::cout << "frames: " << whole_frames << std::endl;
+  std::cout << "elapsed_seconds: " << std::fixed << std::setprecision(6) << elapsed.count() << std::endl;
+  std::cout << "instructions_per_second: " << std::setprecision(0) << instructions_per_second << std::endl;
+  std::cout << "framebuffer_hash: " << std::hex << std::setw(16) << std::setfill('0')
+    << chip_8->get_display_hash() << std::endl;
+
+  if(!headless_args.wav.empty()) {
+    Audio_Statistics statistics = audio_ring.get_statistics();
+    std::cout << std::dec;
+    std::cout << "audio_samples: " << statistics.samples_read << std::endl;
+    std::cout << "audio_underruns: " << statistics.underruns << std::endl;
+    std::cout << "audio_dropped_samples: " << statistics.samples_dropped << std::endl;
+    if(!wav_sink.close()) {
+      std::cout << headless_args.wav << " could not be written" << std::endl;
+      return 1;
+    }
+  }
+
+  if(tracer) {
+    chip_8->set_tracer(nullptr);
+    bool written = tracer->close();
+    Trace_Statistics statistics = tracer->get_statistics();
+    std::cout << std::dec;
+    std::cout << "trace_records: " << statistics.records << std::endl;
+    std::cout << "trace_bytes: " << statistics.bytes_written << std::endl;
+    std::cout << "trace_stalls: " << statistics.stalls << std::endl;
+    if(!written) {
+      std::cout << headless_args.trace << " could not be written" << std::endl;
+      return 1;
+    }
+  }
+
+  if(capture) {
+    bool written = capture->close();
+    Capture_Statistics statistics = capture->get_statistics();
+    std::cout << std::dec;
+    std::cout << "capture_frames: " << statistics.frames_written << std::endl;
+    std::cout << "capture_dropped_frames: " << statistics.frames_dropped << std::endl;
+    if(!written) {
+      std::cout << headless_args.capture << " could not be written" << std::endl;
+      return 1;
+    }
+  }
+
+#if CHIP_8_PROFILER
+  if(!headless_args.profile_json.empty()) {
+    std::ofstream profile(headless_args.profile_json);
+    if(!profile.is_open()) {
+      std::cout << headless_args.profile_json << " could not be opened for writing" << std::endl;
+      return 1;
+    }
+    profiler.write_json(profile);
+  }
+  if(!headless_args.profile_folded.empty()) {
+    std::ofstream profile(headless_args.profile_folded);
+    if(!profile.is_open()) {
+      std::cout << headless_args.profile_folded << " could not be opened for writing" << std::endl;
+      return 1;
+    }
+    profiler.write_folded(profile);
+  }
+#endif
+
+  if(!cache_path.empty()) {
+    chip_8->fill_rom_cache(rom_cache);
+    if(!save_rom_cache(cache_path, rom_cache)) std::cout << cache_path << " could not be written" << std::endl;
+  }
+
+  if(!headless_args.save_state.empty() && 
+    !save_state_file(headless_args.save_state, chip_8->get_state(), chip_8->get_quirk_bits(), chip_8->get_platform())) {
+    std::cout << headless_args.save_state << " could not be written" << std::endl;
+    return 1;
+  }
+
+  if(!headless_args.replay.empty()) {
+    if(chip_8->get_state_hash() != input_log.final_state_hash) {
+      std::cout << "replay: FAILED, the state differs from the one the recording ended on" << std::endl;
+      return 1;
+    }
+    std::cout << "replay: matched the recorded state after " << std::dec << input_log.events.size() << " key events" << std::endl;
+  }
+
+  /* A stack fault holds the machine on the faulting instruction */
+  if(chip_8->get_fault() == Machine_Fault::STACK_OVERFLOW) {
+    std::cout << "fault: stack overflow" << std::endl;
+    return 1;
+  } else if(chip_8->get_fault() == Machine_Fault::STACK_UNDERFLOW) {
+    std::cout << "fault: stack underflow" << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
\ No newline at end of file
@@ -0,0 +1,146 @@
+#ifndef CHIP_8_SHM_H
+#define CHIP_8_SHM_H
+
+/*
+  C interface to a running emulator started with --shm <NAME>. The emulator publishes the display and 
+  registers of every frame into a POSIX shared memory object under a sequence lock, and reads the keypad 
+  clients write into it. Clients include this header alone and need no other part of the emulator:
+
+    Shared_Region *region = chip_8_shm_attach("/chip8");
+    Shared_Frame frame;
+    uint64_t frames = chip_8_shm_read_frame(region, &frame);
+    chip_8_shm_set_key(region, 0x5, 1);
+    chip_8_shm_detach(region);
+
+  The atomics are GCC and Clang builtins, so the header is the same in C and C++
+*/
+
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/* "C8SM" in the first four bytes of the region */
+#define CHIP_8_SHM_MAGIC 0x4D533843
+/* Bumped whenever the layout below changes */
+#define CHIP_8_SHM_VERSION 1
+#define CHIP_8_SHM_CACHE_LINE 64
+
+#define CHIP_8_SHM_PLANES 4
+#define CHIP_8_SHM_HEIGHT 64
+#define CHIP_8_SHM_ROW_WORDS 2
+#define CHIP_8_SHM_REGISTERS 16
+#define CHIP_8_SHM_STACK_DEPTH 16
+#define CHIP_8_SHM_KEYS 16
+
+/* Set in closed once the emulator has stopped publishing */
+#define CHIP_8_SHM_CLOSED 1
+
+/* State of the machine at the end of one frame */
+typedef struct Shared_Frame {
+  /* Frames run since the emulator started, and the cycles run in them */
+  uint64_t frame_number;
+  uint64_t cycle_count;
+  /* 
+    Display planes of 64 rows of two 64-bit words, the leftmost pixel in the top bit of the first word. 
+    In the 64x32 mode only the first word of the first 32 rows is used
+  */
+  uint64_t planes[CHIP_8_SHM_PLANES][CHIP_8_SHM_HEIGHT][CHIP_8_SHM_ROW_WORDS];
+  /* Set in the 128x64 mode */
+  uint8_t hires;
+  uint8_t plane_mask;
+  uint8_t stack_pointer;
+  uint8_t delay_timer;
+  uint8_t sound_timer;
+  /* Stack fault holding the machine, 0 if none */
+  uint8_t fault;
+  /* Keys the machine sees pressed, bit N is key N */
+  uint16_t keypad;
+  uint8_t vs[CHIP_8_SHM_REGISTERS];
+  uint16_t stack[CHIP_8_SHM_STACK_DEPTH];
+  uint16_t program_counter;
+  uint16_t index_register;
+  uint8_t reserved[4];
+} Shared_Frame;
+
+/* Layout of the shared memory object. The sequence and the keypad are on their own cache lines */
+typedef struct Shared_Region {
+  uint32_t magic;
+  uint32_t version;
+  /* Size of this struct, so a client built against another layout can tell */
+  uint32_t size;
+  uint32_t closed;
+  /* Odd while the emulator is writing the frame, even once it is complete */
+  uint64_t sequence __attribute__((aligned(CHIP_8_SHM_CACHE_LINE)));
+  Shared_Frame frame;
+  /* Keys held by clients, bit N is key N. Only clients write it, the emulator turns changes into key events */
+  uint16_t keypad __attribute__((aligned(CHIP_8_SHM_CACHE_LINE)));
+} Shared_Region;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Map the region the emulator created under the name, returns null if it does not exist or has another layout */
+static inline Shared_Region *chip_8_shm_attach(const char *name) {
+  int fd = shm_open(name, O_RDWR, 0);
+  if(fd < 0) return NULL;
+  void *memory = mmap(NULL, sizeof(Shared_Region), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if(memory == MAP_FAILED) return NULL;
+
+  Shared_Region *region = (Shared_Region *)memory;
+  if(region->magic != CHIP_8_SHM_MAGIC || region->version != CHIP_8_SHM_VERSION || 
+    region->size != sizeof(Shared_Region)) {
+    munmap(memory, sizeof(Shared_Region));
+    return NULL;
+  }
+  return region;
+}
+
+static inline void chip_8_shm_detach(Shared_Region *region) {
+  munmap(region, sizeof(Shared_Region));
+}
+
+/* 
+  Copy the latest complete frame out, retrying while the emulator is writing it. Returns the number of 
+  frames published so far, 0 if none has been yet
+*/
+static inline uint64_t chip_8_shm_read_frame(const Shared_Region *region, Shared_Frame *frame) {
+  while(1) {
+    uint64_t start = __atomic_load_n(&region->sequence, __ATOMIC_ACQUIRE);
+    if(start & 1) continue;
+    memcpy(frame, (const void *)&region->frame, sizeof(Shared_Frame));
+    /* The copy has to be done before the sequence is checked again */
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if(__atomic_load_n(&region->sequence, __ATOMIC_RELAXED) == start) return start / 2;
+  }
+}
+
+/* Check if the emulator has stopped, the last frame it published can still be read */
+static inline int chip_8_shm_is_closed(const Shared_Region *region) {
+  return __atomic_load_n(&region->closed, __ATOMIC_ACQUIRE) & CHIP_8_SHM_CLOSED;
+}
+
+/* Replace the keys held by this client, bit N is key N */
+static inline void chip_8_shm_set_keypad(Shared_Region *region, uint16_t keypad) {
+  __atomic_store_n(&region->keypad, keypad, __ATOMIC_RELEASE);
+}
+
+/* Press or release one key (0x0 to 0xF) */
+static inline void chip_8_shm_set_key(Shared_Region *region, uint8_t key, int pressed) {
+  if(key >= CHIP_8_SHM_KEYS) return;
+  if(pressed) {
+    __atomic_fetch_or(&region->keypad, (uint16_t)(1 << key), __ATOMIC_RELEASE);
+  } else {
+    __atomic_fetch_and(&region->keypad, (uint16_t)~(1 << key), __ATOMIC_RELEASE);
+  }
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
\ No newline at end of file
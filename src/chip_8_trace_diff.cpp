@@ -0,0 +1,177 @@
+#include <boost/program_options.hpp>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <string>
+#include "trace.h"
+
+#define DEFAULT_TRACE_CONTEXT 8
+
+typedef struct Trace_Diff_Arguments {
+  std::string first;
+  std::string second;
+  /* Number of matching records printed before the divergence */
+  uint32_t context;
+  /* Pair records by their position in the traces instead of by cycle */
+  bool by_index;
+} Trace_Diff_Arguments;
+
+std::optional<Trace_Diff_Arguments> parse_arguments(int argc, char **argv) {
+  /* Descriptions of the optional flags a user can provide */
+  boost::program_options::options_description description("Options");
+  description.add_options()
+    ("help", "Print help message and exit")
+    ("traces", boost::program_options::value<std::vector<std::string>>(), "The two traces to compare")
+    ("context", boost::program_options::value<uint32_t>()->default_value(DEFAULT_TRACE_CONTEXT),
+      "Number of matching instructions printed before the first divergence")
+    ("by-index", "Pair the Nth records of the traces, instead of the records of the same cycle");
+  boost::program_options::positional_options_description pod;
+  pod.add("traces", 2);
+  boost::program_options::variables_map variables_map;
+
+  boost::program_options::store(
+    boost::program_options::command_line_parser(argc, argv)
+      .options(description)
+      .positional(pod)
+      .run(),
+    variables_map
+  );
+
+  boost::program_options::notify(variables_map);
+
+  if(variables_map.count("help")) {
+    std::cout << "Usage: ./chip_8_trace_diff [OPTIONS] <TRACE> <TRACE>" << std::endl;
+    std::cout << std::endl;
+    std::cout << description << std::endl;
+    return {};
+  }
+
+  if(!variables_map.count("traces") || variables_map["traces"].as<std::vector<std::string>>().size() != 2) {
+    std::cout << "Please provide the paths of two traces written by chip_8_headless --trace" << std::endl;
+    std::cout << "Use --help for more info" << std::endl;
+    return {};
+  }
+
+  std::vector<std::string> traces = variables_map["traces"].as<std::vector<std::string>>();
+  return {Trace_Diff_Arguments{traces[0], traces[1], variables_map["context"].as<uint32_t>(), 
+    variables_map.count("by-index") > 0}};
+}
+
+/* One line per record, e.g. "   1042 0x0204 6A02 I=0x0000 vA=02 vF=00" */
+void print_record(const char *label, const Trace_Record &record) {
+  std::cout << label << std::dec << std::setfill(' ') << std::setw(10) << record.cycle << std::hex << std::setfill('0')
+    << " 0x" << std::setw(4) << record.address << " " << std::uppercase << std::setw(4) << record.opcode
+    << std::nouppercase << " I=0x" << std::setw(4) << record.index_register;
+  if(record.changed_register != TRACE_NO_REGISTER && record.changed_register != 0xF) {
+    std::cout << " v" << std::uppercase << static_cast<int>(record.changed_register) << std::nouppercase 
+      << "=" << std::setw(2) << static_cast<int>(record.register_value);
+  }
+  std::cout << " vF=" << std::setw(2) << static_cast<int>(record.flag_register);
+  if(record.write_length) {
+    std::cout << " wrote " << std::dec << static_cast<int>(record.write_length) << " at 0x" << std::hex 
+      << std::setw(4) << record.write_address;
+  }
+  std::cout << std::dec << std::endl;
+}
+
+bool same_record(const Trace_Record &a, const Trace_Record &b) {
+  return a.cycle == b.cycle && a.address == b.address && a.opcode == b.opcode && 
+    a.index_register == b.index_register && a.write_address == b.write_address && 
+    a.write_length == b.write_length && a.changed_register == b.changed_register && 
+    a.register_value == b.register_value && a.flag_register == b.flag_register;
+}
+
+/* Names of the fields of a record that differ, comma separated */
+std::string differing_fields(const Trace_Record &a, const Trace_Record &b) {
+  std::string fields;
+  auto add = [&fields](bool differs, const char *name) {
+    if(!differs) return;
+    if(!fields.empty()) fields += ", ";
+    fields += name;
+  };
+  add(a.cycle != b.cycle, "cycle");
+  add(a.address != b.address, "address");
+  add(a.opcode != b.opcode, "opcode");
+  add(a.index_register != b.index_register, "index register");
+  add(a.write_address != b.write_address || a.write_length != b.write_length, "memory write");
+  add(a.changed_register != b.changed_register || a.register_value != b.register_value, "changed register");
+  add(a.flag_register != b.flag_register, "vF");
+  return fields;
+}
+
+/* A tracer set part way into a run starts at a later cycle, so the trace starting earlier is caught up */
+bool align_by_cycle(Trace_Reader &first, Trace_Reader &second, Trace_Record &a, Trace_Record &b, bool &has_a, bool &has_b) {
+  while(has_a && has_b && a.cycle != b.cycle) {
+    if(static_cast<int32_t>(a.cycle - b.cycle) < 0) {
+      has_a = first.next(a);
+    } else {
+      has_b = second.next(b);
+    }
+  }
+  return has_a && has_b;
+}
+
+/* A trace cut short, e.g. by the run being killed, is compared up to its last whole block */
+void warn_if_damaged(const Trace_Reader &reader, const std::string &path) {
+  if(reader.is_damaged()) std::cout << "warning: " << path << " ends in a damaged block" << std::endl;
+}
+
+int main(int argc, char **argv) {
+  std::optional<Trace_Diff_Arguments> opt_arguments = parse_arguments(argc, argv);
+  if(!opt_arguments) return 0;
+  Trace_Diff_Arguments diff_args = *opt_arguments;
+
+  Trace_Reader first;
+  Trace_Reader second;
+  for(std::pair<Trace_Reader *, const std::string *> trace : {std::make_pair(&first, &diff_args.first), 
+    std::make_pair(&second, &diff_args.second)}) {
+    if(!trace.first->open(*trace.second)) {
+      std::cout << *trace.second << " is not a trace written by chip_8_headless --trace" << std::endl;
+      return 2;
+    }
+  }
+  if(first.get_platform() != second.get_platform() || first.get_quirks() != second.get_quirks()) {
+    std::cout << "note: the traces were run with different platforms or quirks" << std::endl;
+  }
+
+  Trace_Record a;
+  Trace_Record b;
+  bool has_a = first.next(a);
+  bool has_b = second.next(b);
+  if(!diff_args.by_index && !align_by_cycle(first, second, a, b, has_a, has_b)) {
+    warn_if_damaged(first, diff_args.first);
+    warn_if_damaged(second, diff_args.second);
+    std::cout << "The traces do not share any cycle" << std::endl;
+    return 1;
+  }
+
+  /* Matching records kept for the context printed before a divergence */
+  std::deque<Trace_Record> context;
+  uint64_t matched = 0;
+  while(has_a && has_b) {
+    if(!same_record(a, b)) {
+      std::cout << "Diverged after " << matched << " matching instructions, in the " << differing_fields(a, b) 
+        << std::endl;
+      for(const Trace_Record &record : context) {
+        print_record("  ", record);
+      }
+      print_record("< ", a);
+      print_record("> ", b);
+      return 1;
+    }
+    matched++;
+    context.push_back(a);
+    if(context.size() > diff_args.context) context.pop_front();
+    has_a = first.next(a);
+    has_b = second.next(b);
+  }
+
+  warn_if_damaged(first, diff_args.first);
+  warn_if_damaged(second, diff_args.second);
+  std::cout << "Matched " << matched << " instructions";
+  if(has_a) std::cout << ", " << diff_args.first << " continues past the end of " << diff_args.second;
+  if(has_b) std::cout << ", " << diff_args.second << " continues past the end of " << diff_args.first;
+  std::cout << std::endl;
+  return 0;
+}
\ No newline at end of file
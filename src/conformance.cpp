@@ -0,0 +1,220 @@
+#include <boost/program_options.hpp>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include "conformance.h"
+
+/* Flags accepted on a manifest line */
+static boost::program_options::options_description manifest_line_options() {
+  boost::program_options::options_description description("Manifest line options");
+  description.add_options()
+    ("input-file", boost::program_options::value<std::string>(), "Path of the ROM, relative to the manifest")
+    ("expect", boost::program_options::value<std::string>(), "Expected framebuffer hash in hex");
+  add_run_length_options(description);
+  add_quirk_options(description);
+  add_execution_options(description);
+  return description;
+}
+
+/* Parse one manifest line into a case, returns false if it is not valid */
+static bool parse_manifest_line(const std::string &text, const std::filesystem::path &directory,
+  const boost::program_options::options_description &description, Conformance_Case &conformance_case) {
+  boost::program_options::positional_options_description pod;
+  pod.add("input-file", -1);
+  boost::program_options::variables_map variables_map;
+
+  try {
+    boost::program_options::store(
+      boost::program_options::command_line_parser(boost::program_options::split_unix(text))
+        .options(description)
+        .positional(pod)
+        .run(),
+      variables_map
+    );
+    boost::program_options::notify(variables_map);
+  } catch(const boost::program_options::error &error) {
+    std::cout << error.what() << std::endl;
+    return false;
+  }
+
+  conformance_case.args = default_arguments();
+  if(!variables_map.count("input-file")) {
+    std::cout << "No ROM given" << std::endl;
+    return false;
+  }
+  std::filesystem::path rom = variables_map["input-file"].as<std::string>();
+  if(rom.is_relative()) rom = directory / rom;
+  conformance_case.args.file_name = rom.string();
+
+  if(!apply_run_length_options(variables_map, conformance_case.run_length)) return false;
+  if(!apply_quirk_options(variables_map, conformance_case.args)) return false;
+  if(!apply_execution_options(variables_map, conformance_case.args)) return false;
+
+  conformance_case.has_expected_hash = variables_map.count("expect") > 0;
+  conformance_case.expected_hash = 0;
+  if(conformance_case.has_expected_hash) {
+    std::string expected = variables_map["expect"].as<std::string>();
+    size_t parsed = 0;
+    try {
+      conformance_case.expected_hash = std::stoull(expected, &parsed, 16);
+    } catch(const std::exception &) {
+      parsed = 0;
+    }
+    if(parsed == 0 || parsed != expected.size()) {
+      std::cout << "Expected hash " << expected << " is not a hex number" << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+bool load_manifest(const std::string &path, std::vector<Conformance_Case> &cases) {
+  std::ifstream manifest(path);
+  if(!manifest.is_open()) {
+    std::cout << "Manifest " << path << " could not be opened" << std::endl;
+    return false;
+  }
+
+  boost::program_options::options_description description = manifest_line_options();
+  std::filesystem::path directory = std::filesystem::path(path).parent_path();
+  std::string text;
+  uint32_t line = 0;
+  while(std::getline(manifest, text)) {
+    line++;
+    size_t first = text.find_first_not_of(" \t\r");
+    if(first == std::string::npos || text[first] == '#') continue;
+
+    Conformance_Case conformance_case;
+    conformance_case.line = line;
+    if(!parse_manifest_line(text, directory, description, conformance_case)) {
+      std::cout << "in " << path << " on line " << line << std::endl;
+      return false;
+    }
+    cases.push_back(conformance_case);
+  }
+  return true;
+}
+
+Conformance_Result run_conformance_case(const Conformance_Case &conformance_case) {
+  Conformance_Result result{Conformance_Status::ERRORED, 0, 0, ""};
+  std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+
+  std::unique_ptr<Chip_8> chip_8 = std::make_unique<Chip_8>(conformance_case.args);
+  if(!chip_8->load_ROM()) {
+    result.message = "ROM could not be opened or does not fit in memory";
+    return result;
+  }
+  /* Hashes have to be the same on every run, so CXNN draws from a fixed seed unless the case gives one */
+  chip_8->seed_random(conformance_case.args.seed.value_or(0));
+
+  const Run_Length &run_length = conformance_case.run_length;
+  uint64_t whole_frames = run_length.cycles / run_length.cycles_per_frame;
+  for(uint64_t i = 0; i < whole_frames; i++) {
+    chip_8->run_frame(run_length.cycles_per_frame);
+  }
+  chip_8->run_cycles(run_length.cycles % run_length.cycles_per_frame);
+
+  result.hash = chip_8->get_display_hash();
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+  result.elapsed_seconds = elapsed.count();
+
+  if(!conformance_case.has_expected_hash) {
+    result.status = Conformance_Status::UNCHECKED;
+  } else if(result.hash == conformance_case.expected_hash) {
+    result.status = Conformance_Status::PASSED;
+  } else {
+    result.status = Conformance_Status::FAILED;
+  }
+  return result;
+}
+
+std::vector<Conformance_Result> run_conformance(const std::vector<Conformance_Case> &cases, Work_Stealing_Pool &pool) {
+  /* Each task writes only its own result, so no locking is needed around them */
+  std::vector<Conformance_Result> results(cases.size());
+  for(size_t i = 0; i < cases.size(); i++) {
+    pool.submit([&cases, &results, i]() {
+      results[i] = run_conformance_case(cases[i]);
+    });
+  }
+  pool.run();
+  return results;
+}
+
+static const char *status_name(Conformance_Status status) {
+  switch(status) {
+    case Conformance_Status::PASSED:
+      return "pass";
+    case Conformance_Status::FAILED:
+      return "fail";
+    case Conformance_Status::UNCHECKED:
+      return "unchecked";
+    default:
+      return "error";
+  }
+}
+
+/* Quote a string for JSON, escaping quotes, backslashes and control characters */
+static std::string json_string(const std::string &text) {
+  std::ostringstream out;
+  out << '"';
+  for(char c : text) {
+    if(c == '"' || c == '\\') {
+      out << '\\' << c;
+    } else if(static_cast<unsigned char>(c) < 0x20) {
+      out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec;
+    } else {
+      out << c;
+    }
+  }
+  out << '"';
+  return out.str();
+}
+
+static std::string hex_hash(uint64_t hash) {
+  std::ostringstream out;
+  out << std::hex << std::setw(16) << std::setfill('0') << hash;
+  return out.str();
+}
+
+void write_conformance_report(std::ostream &out, const std::vector<Conformance_Case> &cases,
+  const std::vector<Conformance_Result> &results, size_t jobs, double elapsed_seconds) {
+  size_t counts[4] = {0, 0, 0, 0};
+  for(const Conformance_Result &result : results) {
+    counts[result.status]++;
+  }
+
+  out << std::fixed << std::setprecision(6);
+  out << "{" << std::endl;
+  out << "  \"cases\": " << cases.size() << "," << std::endl;
+  out << "  \"passed\": " << counts[Conformance_Status::PASSED] << "," << std::endl;
+  out << "  \"failed\": " << counts[Conformance_Status::FAILED] << "," << std::endl;
+  out << "  \"unchecked\": " << counts[Conformance_Status::UNCHECKED] << "," << std::endl;
+  out << "  \"errors\": " << counts[Conformance_Status::ERRORED] << "," << std::endl;
+  out << "  \"jobs\": " << jobs << "," << std::endl;
+  out << "  \"elapsed_seconds\": " << elapsed_seconds << "," << std::endl;
+  out << "  \"results\": [";
+  for(size_t i = 0; i < cases.size(); i++) {
+    const Conformance_Case &conformance_case = cases[i];
+    const Conformance_Result &result = results[i];
+    out << (i == 0 ? "" : ",") << std::endl;
+    out << "    {\"line\": " << conformance_case.line
+      << ", \"rom\": " << json_string(conformance_case.args.file_name)
+      << ", \"quirks\": " << static_cast<uint32_t>(get_quirks(conformance_case.args))
+      << ", \"cycles\": " << conformance_case.run_length.cycles
+      << ", \"status\": \"" << status_name(result.status) << "\""
+      << ", \"hash\": \"" << hex_hash(result.hash) << "\"";
+    if(conformance_case.has_expected_hash) {
+      out << ", \"expected_hash\": \"" << hex_hash(conformance_case.expected_hash) << "\"";
+    }
+    if(!result.message.empty()) {
+      out << ", \"message\": " << json_string(result.message);
+    }
+    out << ", \"elapsed_seconds\": " << result.elapsed_seconds << "}";
+  }
+  out << std::endl << "  ]" << std::endl;
+  out << "}" << std::endl;
+}
\ No newline at end of file
@@ -0,0 +1,55 @@
+#ifndef CONFORMANCE_H
+#define CONFORMANCE_H
+
+#include <ostream>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "chip_8.h"
+#include "options.h"
+#include "work_stealing_pool.h"
+
+typedef enum Conformance_Status {
+  /* Final framebuffer hash matched the expected hash */
+  PASSED,
+  /* Final framebuffer hash differed from the expected hash */
+  FAILED,
+  /* No expected hash was given, the hash is only reported */
+  UNCHECKED,
+  /* The ROM could not be run */
+  ERRORED
+} Conformance_Status;
+
+/* One line of a manifest: a ROM, its quirks, how long to run it and the hash it should end on */
+typedef struct Conformance_Case {
+  /* Line of the manifest the case was read from */
+  uint32_t line;
+  Arguments args;
+  Run_Length run_length;
+  bool has_expected_hash;
+  uint64_t expected_hash;
+} Conformance_Case;
+
+typedef struct Conformance_Result {
+  Conformance_Status status;
+  uint64_t hash;
+  double elapsed_seconds;
+  std::string message;
+} Conformance_Result;
+
+/*
+  Read the cases of a manifest. Each line holds the headless flags for one run, with the ROM path 
+  relative to the manifest, and --expect giving the framebuffer hash. Blank lines and lines starting 
+  with # are skipped. Returns false if the manifest could not be read or a line is not valid
+*/
+bool load_manifest(const std::string &path, std::vector<Conformance_Case> &cases);
+/* Run one case from a fixed random seed and compare its framebuffer hash */
+Conformance_Result run_conformance_case(const Conformance_Case &conformance_case);
+/* Run every case on the work-stealing pool, returning the results in the order of the cases */
+std::vector<Conformance_Result> run_conformance(const std::vector<Conformance_Case> &cases, Work_Stealing_Pool &pool);
+/* Write the results of a run as a JSON report */
+void write_conformance_report(std::ostream &out, const std::vector<Conformance_Case> &cases,
+  const std::vector<Conformance_Result> &results, size_t jobs, double elapsed_seconds);
+
+#endif
\ No newline at end of file
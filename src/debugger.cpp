@@ -0,0 +1,124 @@
+#include "debugger.h"
+
+#define BITMAP_WORDS (MAX_MEMORY_SIZE / BITMAP_WORD_BITS)
+
+/* Set or clear the bit of the address, returns true if it changed */
+static bool set_bit(std::vector<uint64_t> &bitmap, uint16_t address, bool set) {
+  uint64_t bit = 1ULL << (address % BITMAP_WORD_BITS);
+  uint64_t &word = bitmap[address / BITMAP_WORD_BITS];
+  if(((word & bit) != 0) == set) return false;
+  word ^= bit;
+  return true;
+}
+
+static bool test_bit(const std::vector<uint64_t> &bitmap, uint16_t address) {
+  return (bitmap[address / BITMAP_WORD_BITS] >> (address % BITMAP_WORD_BITS)) & 0x1;
+}
+
+Debugger::Debugger() {
+  clear();
+}
+
+void Debugger::add_breakpoint(uint16_t address) {
+  if(set_bit(_breakpoints, address, true)) _breakpoint_count++;
+}
+
+void Debugger::remove_breakpoint(uint16_t address) {
+  if(set_bit(_breakpoints, address, false)) _breakpoint_count--;
+}
+
+/* 
+  Each kind has a bitmap of its own, so removing one kind of watchpoint leaves another on the same address. 
+  The count is the number of bits set over the three bitmaps
+*/
+void Debugger::add_watchpoint(uint16_t address, uint16_t length, Watch_Kind kind) {
+  std::vector<uint64_t> &bitmap = _get_watchpoints(kind);
+  for(uint32_t i = 0; i < length; i++) {
+    _watchpoint_count += set_bit(bitmap, static_cast<uint16_t>(address + i), true);
+  }
+}
+
+void Debugger::remove_watchpoint(uint16_t address, uint16_t length, Watch_Kind kind) {
+  std::vector<uint64_t> &bitmap = _get_watchpoints(kind);
+  for(uint32_t i = 0; i < length; i++) {
+    _watchpoint_count -= set_bit(bitmap, static_cast<uint16_t>(address + i), false);
+  }
+}
+
+std::vector<uint64_t> &Debugger::_get_watchpoints(Watch_Kind kind) {
+  switch(kind) {
+    case Watch_Kind::WATCH_READ:
+      return _read_watchpoints;
+    case Watch_Kind::WATCH_WRITE:
+      return _write_watchpoints;
+    default:
+      return _access_watchpoints;
+  }
+}
+
+void Debugger::clear() {
+  _breakpoints.assign(BITMAP_WORDS, 0);
+  _read_watchpoints.assign(BITMAP_WORDS, 0);
+  _write_watchpoints.assign(BITMAP_WORDS, 0);
+  _access_watchpoints.assign(BITMAP_WORDS, 0);
+  _breakpoint_count = 0;
+  _watchpoint_count = 0;
+  _step = false;
+  _stop_reason = Stop_Reason::NOT_STOPPED;
+  _stop_address = 0;
+  _stop_watch_kind = Watch_Kind::WATCH_ACCESS;
+}
+
+void Debugger::request_step() {
+  _step = true;
+}
+
+bool Debugger::is_active() const {
+  return _breakpoint_count > 0 || _watchpoint_count > 0 || _step;
+}
+
+bool Debugger::has_watchpoints() const {
+  return _watchpoint_count > 0;
+}
+
+/* An access watchpoint stops on either kind, a watchpoint of the kind itself is reported first */
+bool Debugger::check_watchpoints(uint16_t address, uint16_t length, uint16_t address_mask, Watch_Kind kind) {
+  const std::vector<uint64_t> &bitmap = kind == Watch_Kind::WATCH_READ ? _read_watchpoints : _write_watchpoints;
+  for(uint32_t i = 0; i < length; i++) {
+    uint16_t accessed = (address + i) & address_mask;
+    if(test_bit(bitmap, accessed)) {
+      _stop_watch_kind = kind;
+    } else if(test_bit(_access_watchpoints, accessed)) {
+      _stop_watch_kind = Watch_Kind::WATCH_ACCESS;
+    } else {
+      continue;
+    }
+    _stop_address = accessed;
+    return true;
+  }
+  return false;
+}
+
+bool Debugger::take_step() {
+  if(!_step) return false;
+  _step = false;
+  return true;
+}
+
+void Debugger::stop(Stop_Reason reason, uint16_t address) {
+  _stop_reason = reason;
+  /* A watchpoint keeps the address of the access it found */
+  if(reason != Stop_Reason::WATCHPOINT) _stop_address = address;
+}
+
+Stop_Reason Debugger::get_stop_reason() const {
+  return _stop_reason;
+}
+
+uint16_t Debugger::get_stop_address() const {
+  return _stop_address;
+}
+
+Watch_Kind Debugger::get_stop_watch_kind() const {
+  return _stop_watch_kind;
+}
\ No newline at end of file
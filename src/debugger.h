@@ -0,0 +1,83 @@
+#ifndef DEBUGGER_H
+#define DEBUGGER_H
+
+#include <stdint.h>
+#include <vector>
+#include "machine_state.h"
+
+#define BITMAP_WORD_BITS 64
+
+/* Why a machine being debugged stopped */
+typedef enum Stop_Reason {
+  NOT_STOPPED,
+  /* Before running the instruction at a breakpoint */
+  BREAKPOINT,
+  /* After running an instruction that accessed a watched address */
+  WATCHPOINT,
+  /* After running the one instruction of a single step */
+  STEP,
+  /* Between two frames, on request of the debugger client */
+  INTERRUPT
+} Stop_Reason;
+
+/* Accesses a watchpoint stops on, as bits so a read and write watchpoint can share an address */
+typedef enum Watch_Kind {
+  WATCH_READ = 0x1,
+  WATCH_WRITE = 0x2,
+  WATCH_ACCESS = 0x3
+} Watch_Kind;
+
+/*
+  Breakpoints on the program counter and watchpoints on memory, one bit per address of the largest 
+  memory so checking an address is a single bit test. Chip_8 only checks them while the debugger is 
+  active, otherwise it runs with its usual loops
+*/
+class Debugger {
+  public:
+    /* Constructor */
+    Debugger();
+    void add_breakpoint(uint16_t address);
+    void remove_breakpoint(uint16_t address);
+    /* Watch length bytes from the address for the kinds of access */
+    void add_watchpoint(uint16_t address, uint16_t length, Watch_Kind kind);
+    void remove_watchpoint(uint16_t address, uint16_t length, Watch_Kind kind);
+    /* Remove every breakpoint and watchpoint and forget any step or stop */
+    void clear();
+    /* Stop after the next instruction run */
+    void request_step();
+    /* Check if there is anything to stop on, Chip_8 only runs its checking loop while there is */
+    bool is_active() const;
+    bool has_watchpoints() const;
+    bool is_breakpoint(uint16_t address) const {
+      return (_breakpoints[address / BITMAP_WORD_BITS] >> (address % BITMAP_WORD_BITS)) & 0x1;
+    }
+    /* 
+      Check if any of length bytes from the address, wrapped by the mask, is watched for the kind of 
+      access. Sets the address found as the one the machine stops on
+    */
+    bool check_watchpoints(uint16_t address, uint16_t length, uint16_t address_mask, Watch_Kind kind);
+    /* Take a pending single step, returns false if there is none */
+    bool take_step();
+    /* Record why the machine stopped, and the address of the breakpoint or watched access */
+    void stop(Stop_Reason reason, uint16_t address);
+    Stop_Reason get_stop_reason() const;
+    uint16_t get_stop_address() const;
+    /* Kind of watchpoint stopped on, WATCH_ACCESS if the address was watched for both as one watchpoint */
+    Watch_Kind get_stop_watch_kind() const;
+  private:
+    /* Bitmap of the watchpoints of one kind */
+    std::vector<uint64_t> &_get_watchpoints(Watch_Kind kind);
+    std::vector<uint64_t> _breakpoints;
+    std::vector<uint64_t> _read_watchpoints;
+    std::vector<uint64_t> _write_watchpoints;
+    /* Addresses watched for both kinds as one watchpoint, checked for reads and writes alike */
+    std::vector<uint64_t> _access_watchpoints;
+    uint32_t _breakpoint_count;
+    uint32_t _watchpoint_count;
+    bool _step;
+    Stop_Reason _stop_reason;
+    uint16_t _stop_address;
+    Watch_Kind _stop_watch_kind;
+};
+
+#endif
\ No newline at end of file
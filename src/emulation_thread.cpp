@@ -0,0 +1,137 @@
+#include <iostream>
+#include "emulation_thread.h"
+#include "save_state.h"
+
+Emulation_Thread::Emulation_Thread(Chip_8 &chip_8, Input_Source &input, uint32_t cycles_per_frame, 
+  Speed_Mode mode, uint32_t turbo_factor) : _chip_8(chip_8), _input(input), 
+  _cycles_per_frame(cycles_per_frame), _scheduler(mode, turbo_factor), _frame_number(0), _capture(nullptr), 
+  _shared_memory(nullptr), _rewind(chip_8.get_platform()), _rewinding(false), _running(false) {}
+
+void Emulation_Thread::set_state_file(const std::string &path) {
+  _state_file = path;
+}
+
+void Emulation_Thread::set_capture(Frame_Capture *capture) {
+  _capture = capture;
+}
+
+void Emulation_Thread::set_shared_memory(Shared_Memory_Export *shared_memory) {
+  _shared_memory = shared_memory;
+}
+
+bool Emulation_Thread::send_command(Emulator_Command command) {
+  return _commands.push(command);
+}
+
+Emulation_Thread::~Emulation_Thread() {
+  stop();
+}
+
+void Emulation_Thread::start() {
+  if(_running.exchange(true)) return;
+  _thread = std::thread(&Emulation_Thread::_run, this);
+}
+
+void Emulation_Thread::stop() {
+  _running.store(false, std::memory_order_release);
+  if(_thread.joinable()) _thread.join();
+}
+
+const Published_Frame *Emulation_Thread::take_frame() {
+  if(!_frames.acquire()) return nullptr;
+  return &_frames.read_slot();
+}
+
+uint64_t Emulation_Thread::get_dropped_frames() const {
+  return _scheduler.get_dropped_frames();
+}
+
+void Emulation_Thread::_run() {
+  while(_running.load(std::memory_order_acquire)) {
+    Emulator_Command command;
+    while(_commands.pop(command)) {
+      _run_command(command);
+    }
+    _chip_8.update_keyboard_status(_input);
+
+    uint32_t frames = _scheduler.frames_to_run();
+    if(_rewinding) {
+      /* Play runs backwards one recorded frame per deadline, the newest frames are discarded */
+      Machine_State state;
+      if(_rewind.rewind(1, state) > 0) {
+        _chip_8.set_state(state);
+        if(_capture) _capture->capture(_chip_8.get_data());
+        if(_shared_memory) _shared_memory->publish(_chip_8, _frame_number);
+      }
+    } else {
+      /* 
+        Run the cycles of every frame that is due in one batch. Each frame ends in the vertical blank,
+        so a DXYN waiting for it is released by the emulated 60Hz clock rather than by the window
+      */
+      for(uint32_t i = 0; i < frames; i++) {
+        _chip_8.run_frame(_cycles_per_frame);
+        _rewind.push(_chip_8.get_state());
+        if(_capture) _capture->capture(_chip_8.get_data());
+        if(_shared_memory) _shared_memory->publish(_chip_8, _frame_number + i + 1);
+      }
+      _frame_number += frames;
+    }
+
+    if(_scheduler.should_present()) _publish();
+    _scheduler.wait_for_deadline();
+  }
+}
+
+void Emulation_Thread::_run_command(Emulator_Command command) {
+  switch(command) {
+    case Emulator_Command::SAVE_STATE:
+      if(save_state_file(_state_file, _chip_8.get_state(), _chip_8.get_quirk_bits(), _chip_8.get_platform())) {
+        std::cout << "Saved state to " << _state_file << std::endl;
+      } else {
+        std::cout << "Could not save state to " << _state_file << std::endl;
+      }
+      break;
+
+    case Emulator_Command::LOAD_STATE:
+      {
+        Machine_State state;
+        uint8_t quirks;
+        Platform platform;
+        if(!load_state_file(_state_file, state, quirks, platform)) {
+          std::cout << "Could not load state from " << _state_file << std::endl;
+          break;
+        }
+        /* The memory and instructions of the state are those of its platform */
+        if(platform != _chip_8.get_platform()) {
+          std::cout << "State was saved on another platform, it was not loaded" << std::endl;
+          break;
+        }
+        if(quirks != _chip_8.get_quirk_bits()) {
+          std::cout << "State was saved with different quirks, it may not run the same" << std::endl;
+        }
+        _chip_8.set_state(state);
+        /* Frames before the load cannot be stepped back into */
+        _rewind.clear();
+        _rewind.push(state);
+        std::cout << "Loaded state from " << _state_file << std::endl;
+      }
+      break;
+
+    case Emulator_Command::START_REWIND:
+      _rewinding = true;
+      break;
+
+    case Emulator_Command::STOP_REWIND:
+      _rewinding = false;
+      break;
+  }
+}
+
+/* Only copy the display out when something was drawn, the presenting thread keeps the last one */
+void Emulation_Thread::_publish() {
+  if(!_chip_8.take_dirty_rows()) return;
+  Published_Frame &frame = _frames.write_slot();
+  frame.framebuffer = _chip_8.get_data();
+  frame.frame_number = _frame_number;
+  _frames.publish();
+}
\ No newline at end of file
@@ -0,0 +1,92 @@
+#ifndef EMULATION_THREAD_H
+#define EMULATION_THREAD_H
+
+#include <atomic>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include "chip_8.h"
+#include "frame_capture.h"
+#include "framebuffer.h"
+#include "input_source.h"
+#include "rewind_buffer.h"
+#include "scheduler.h"
+#include "shared_memory_export.h"
+#include "spsc_ring.h"
+#include "triple_buffer.h"
+
+/* Number of commands that can be waiting for the emulation thread */
+#define EMULATOR_COMMAND_QUEUE_SIZE 64
+
+/* Requests from the window thread, run by the emulation thread between frames */
+typedef enum Emulator_Command {
+  SAVE_STATE,
+  LOAD_STATE,
+  /* Step back one frame per 60Hz deadline until STOP_REWIND */
+  START_REWIND,
+  STOP_REWIND
+} Emulator_Command;
+
+/* Display handed from the emulation thread to the thread presenting it */
+typedef struct Published_Frame {
+  Framebuffer framebuffer;
+  /* Number of emulated frames run when the display was published */
+  uint64_t frame_number;
+} Published_Frame;
+
+/*
+  Runs the Chip 8 on its own thread, paced by a frame scheduler. The display is published 
+  through a triple buffer whenever it changed, so presenting never blocks emulation and 
+  emulation never blocks presenting. Key events are read from the input source, which has 
+  to be safe to push into from the presenting thread
+*/
+class Emulation_Thread {
+  public:
+    /* Constructor */
+    Emulation_Thread(Chip_8 &chip_8, Input_Source &input, uint32_t cycles_per_frame, 
+      Speed_Mode mode, uint32_t turbo_factor = DEFAULT_TURBO_FACTOR);
+    /* Set the file SAVE_STATE writes to and LOAD_STATE reads from */
+    void set_state_file(const std::string &path);
+    /* Capture the display after every frame run or stepped back, set before the thread is started */
+    void set_capture(Frame_Capture *capture);
+    /* Publish every frame run or stepped back to shared memory, set before the thread is started */
+    void set_shared_memory(Shared_Memory_Export *shared_memory);
+    /* Queue a command for the emulation thread, returns false if the queue is full */
+    bool send_command(Emulator_Command command);
+    /* Destructor, stops the thread if it is still running */
+    ~Emulation_Thread();
+    /* Start running the Chip 8 */
+    void start();
+    /* Stop running the Chip 8 and wait for the thread to finish */
+    void stop();
+    /* Take the latest published display, returns null if nothing new was published since the last call */
+    const Published_Frame *take_frame();
+    /* Number of frames dropped by the scheduler, read after the thread has stopped */
+    uint64_t get_dropped_frames() const;
+  private:
+    /* Loop run on the thread */
+    void _run();
+    /* Run one command from the queue */
+    void _run_command(Emulator_Command command);
+    /* Copy the display out to the presenting thread */
+    void _publish();
+    Chip_8 &_chip_8;
+    Input_Source &_input;
+    uint32_t _cycles_per_frame;
+    Frame_Scheduler _scheduler;
+    Triple_Buffer<Published_Frame> _frames;
+    uint64_t _frame_number;
+    Spsc_Ring<Emulator_Command, EMULATOR_COMMAND_QUEUE_SIZE> _commands;
+    std::string _state_file;
+    /* Null if the display is not captured */
+    Frame_Capture *_capture;
+    /* Null if frames are not published to shared memory */
+    Shared_Memory_Export *_shared_memory;
+    /* State of every recent frame, for stepping back */
+    Rewind_Buffer _rewind;
+    bool _rewinding;
+    std::atomic<bool> _running;
+    std::thread _thread;
+};
+
+#endif
\ No newline at end of file
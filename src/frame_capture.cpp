@@ -0,0 +1,194 @@
+#include <chrono>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "frame_capture.h"
+
+#define Y4M_FRAME_HEADER "FRAME\n"
+#define RGB_SIZE 3
+/* Room for the longest PPM header, "P6\n128 64\n255\n" */
+#define PPM_HEADER_SIZE 32
+
+Frame_Capture::Frame_Capture(Capture_Format format) : _format(format), _frame{}, _frames_captured(0), 
+  _frames_dropped(0), _frames_written(0), _failed(false), _running(false) {
+  _image = std::vector<uint8_t>(DISPLAY_WIDTH * DISPLAY_HEIGHT * RGBA_SIZE);
+  _yuv = std::vector<uint8_t>(DISPLAY_WIDTH * DISPLAY_HEIGHT * RGB_SIZE);
+  _ppm = std::vector<uint8_t>(PPM_HEADER_SIZE + DISPLAY_WIDTH * DISPLAY_HEIGHT * RGB_SIZE);
+}
+
+Frame_Capture::~Frame_Capture() {
+  if(_running.load(std::memory_order_acquire)) close();
+}
+
+bool Frame_Capture::open(const std::string &path) {
+  if(_running.load(std::memory_order_acquire)) return false;
+  _path = path;
+  if(_format == Capture_Format::PPM) {
+    /* The files are created as frames are written, so only check the directory can be written to */
+    snprintf(_file_path, CAPTURE_PATH_SIZE, "%s%06llu.ppm", _path.c_str(), 0ULL);
+    std::ofstream file(_file_path, std::ios_base::binary);
+    if(!file.is_open()) return false;
+  } else {
+    /* A named pipe can be given as the path, opening it waits for the reader */
+    _file.open(path, std::ios_base::binary);
+    if(!_file.is_open()) return false;
+    if(_format == Capture_Format::Y4M) {
+      _file << "YUV4MPEG2 W" << DISPLAY_WIDTH << " H" << DISPLAY_HEIGHT << " F" << CAPTURE_FRAME_RATE 
+        << ":1 Ip A1:1 C444\n";
+    }
+  }
+
+  _failed.store(false, std::memory_order_relaxed);
+  _running.store(true, std::memory_order_release);
+  _thread = std::thread(&Frame_Capture::_run, this);
+  return true;
+}
+
+/* Copying into the ring is the only work done here, so the emulating thread never waits on the disk */
+void Frame_Capture::capture(const Framebuffer &framebuffer) {
+  uint64_t frame_number = _frames_captured.fetch_add(1, std::memory_order_relaxed);
+  if(!_running.load(std::memory_order_relaxed)) return;
+  Captured_Frame frame;
+  frame.framebuffer = framebuffer;
+  frame.frame_number = frame_number;
+  if(!_frames.push(frame)) {
+    _frames_dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  _wake.notify_one();
+}
+
+bool Frame_Capture::close() {
+  if(!_running.load(std::memory_order_acquire)) return false;
+  {
+    std::lock_guard<std::mutex> lock(_wake_mutex);
+    _running.store(false, std::memory_order_release);
+  }
+  _wake.notify_one();
+  if(_thread.joinable()) _thread.join();
+
+  if(_file.is_open()) {
+    _file.close();
+    if(_file.fail()) _failed.store(true, std::memory_order_relaxed);
+  }
+  return !_failed.load(std::memory_order_relaxed);
+}
+
+Capture_Statistics Frame_Capture::get_statistics() const {
+  return Capture_Statistics{_frames_captured.load(std::memory_order_relaxed), 
+    _frames_written.load(std::memory_order_relaxed), _frames_dropped.load(std::memory_order_relaxed)};
+}
+
+/* 
+  Sleeps until a frame is queued. The emulating thread notifies without taking the lock so it never 
+  waits on the writer, a wakeup lost to that race only delays the writer by the wait timeout
+*/
+void Frame_Capture::_run() {
+  while(true) {
+    while(_frames.pop(_frame)) {
+      if(!_write(_frame)) _failed.store(true, std::memory_order_relaxed);
+      _frames_written.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::unique_lock<std::mutex> lock(_wake_mutex);
+    if(!_running.load(std::memory_order_acquire)) break;
+    _wake.wait_for(lock, std::chrono::milliseconds(CAPTURE_WAIT_MILLISECONDS), [this]() {
+      return !_running.load(std::memory_order_acquire) || _frames.size() > 0;
+    });
+  }
+
+  /* Frames queued before the capture was closed are still written */
+  while(_frames.pop(_frame)) {
+    if(!_write(_frame)) _failed.store(true, std::memory_order_relaxed);
+    _frames_written.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+bool Frame_Capture::_write(const Captured_Frame &frame) {
+  _renderer.update(frame.framebuffer, ALL_ROWS_DIRTY);
+  switch(_format) {
+    case Capture_Format::Y4M:
+      _scale_image();
+      _convert_to_yuv();
+      _file.write(Y4M_FRAME_HEADER, sizeof(Y4M_FRAME_HEADER) - 1);
+      _file.write(reinterpret_cast<const char *>(_yuv.data()), _yuv.size());
+      break;
+
+    case Capture_Format::RGBA:
+      _scale_image();
+      _file.write(reinterpret_cast<const char *>(_image.data()), _image.size());
+      break;
+
+    case Capture_Format::PPM:
+      return _write_ppm(frame.frame_number);
+  }
+  return _file.good();
+}
+
+void Frame_Capture::_scale_image() {
+  uint16_t width = _renderer.get_width();
+  uint16_t height = _renderer.get_height();
+  if(width == DISPLAY_WIDTH) {
+    memcpy(_image.data(), _renderer.get_pixels(), _image.size());
+    return;
+  }
+
+  uint8_t scale_x = DISPLAY_WIDTH / width;
+  uint8_t scale_y = DISPLAY_HEIGHT / height;
+  uint8_t *pixel = _image.data();
+  for(uint16_t y = 0; y < DISPLAY_HEIGHT; y++) {
+    const uint8_t *row = _renderer.get_row(y / scale_y);
+    for(uint16_t x = 0; x < DISPLAY_WIDTH; x++, pixel += RGBA_SIZE) {
+      memcpy(pixel, &row[(x / scale_x) * RGBA_SIZE], RGBA_SIZE);
+    }
+  }
+}
+
+/* BT.601 in the limited range video tools expect, Y4M carries no alpha so it is dropped */
+void Frame_Capture::_convert_to_yuv() {
+  const size_t plane_size = DISPLAY_WIDTH * DISPLAY_HEIGHT;
+  uint8_t *y_plane = _yuv.data();
+  uint8_t *u_plane = y_plane + plane_size;
+  uint8_t *v_plane = u_plane + plane_size;
+  for(size_t i = 0; i < plane_size; i++) {
+    int32_t r = _image[i * RGBA_SIZE];
+    int32_t g = _image[i * RGBA_SIZE + 1];
+    int32_t b = _image[i * RGBA_SIZE + 2];
+    y_plane[i] = static_cast<uint8_t>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+    u_plane[i] = static_cast<uint8_t>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+    v_plane[i] = static_cast<uint8_t>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+  }
+}
+
+/* 
+  The whole file is built in the buffer allocated up front and written with one call, so no stream or 
+  buffer is created per frame
+*/
+bool Frame_Capture::_write_ppm(uint64_t frame_number) {
+  uint16_t width = _renderer.get_width();
+  uint16_t height = _renderer.get_height();
+  size_t header_size = snprintf(reinterpret_cast<char *>(_ppm.data()), PPM_HEADER_SIZE, "P6\n%u %u\n255\n", 
+    static_cast<unsigned int>(width), static_cast<unsigned int>(height));
+  uint8_t *rgb = _ppm.data() + header_size;
+  const uint8_t *rgba = _renderer.get_pixels();
+  for(size_t i = 0; i < static_cast<size_t>(width) * height; i++) {
+    memcpy(&rgb[i * RGB_SIZE], &rgba[i * RGBA_SIZE], RGB_SIZE);
+  }
+
+  snprintf(_file_path, CAPTURE_PATH_SIZE, "%s%06llu.ppm", _path.c_str(), static_cast<unsigned long long>(frame_number));
+  int file = ::open(_file_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if(file < 0) return false;
+  const uint8_t *data = _ppm.data();
+  size_t remaining = header_size + static_cast<size_t>(width) * height * RGB_SIZE;
+  /* A write can be cut short, by a signal or a full pipe, and is continued from where it stopped */
+  while(remaining > 0) {
+    ssize_t written = ::write(file, data, remaining);
+    if(written < 0 && errno == EINTR) continue;
+    if(written <= 0) break;
+    data += written;
+    remaining -= written;
+  }
+  return ::close(file) == 0 && remaining == 0;
+}
\ No newline at end of file
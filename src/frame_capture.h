@@ -0,0 +1,104 @@
+#ifndef FRAME_CAPTURE_H
+#define FRAME_CAPTURE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "frame_renderer.h"
+#include "framebuffer.h"
+#include "spsc_ring.h"
+
+/* Number of frames that can be waiting for the writer thread, frames captured while it is full are dropped */
+#define CAPTURE_QUEUE_SIZE 256
+/* Longest the writer thread sleeps before checking the queue again, in case a wakeup was missed */
+#define CAPTURE_WAIT_MILLISECONDS 5
+/* Frame rate written into the Y4M header, one frame per emulated 60Hz tick */
+#define CAPTURE_FRAME_RATE 60
+/* Longest name of one file of a PPM sequence */
+#define CAPTURE_PATH_SIZE 4096
+
+/* How captured frames are written */
+typedef enum Capture_Format {
+  /* YUV4MPEG2 stream of 4:4:4 frames, read by most video tools */
+  Y4M,
+  /* Headerless stream of RGBA frames */
+  RGBA,
+  /* One binary PPM file per frame, named by the path followed by the frame number */
+  PPM
+} Capture_Format;
+
+typedef struct Capture_Statistics {
+  /* Frames handed to the capture */
+  uint64_t frames_captured;
+  uint64_t frames_written;
+  /* Frames captured while the queue was full */
+  uint64_t frames_dropped;
+} Capture_Statistics;
+
+/* Frame waiting in the queue for the writer thread */
+typedef struct Captured_Frame {
+  Framebuffer framebuffer;
+  /* Number of frames captured before this one, dropped frames included */
+  uint64_t frame_number;
+} Captured_Frame;
+
+/*
+  Records the display of every frame on a background writer thread. Capturing copies the framebuffer 
+  into a slot of a queue allocated up front and never waits, when the writer falls behind the frame is 
+  dropped and counted. Stream formats are always 128x64, a 64x32 display is scaled up 2x so the frame 
+  size stays the same when a program switches resolution. PPM files are in the resolution of the frame
+*/
+class Frame_Capture {
+  public:
+    /* Constructor */
+    explicit Frame_Capture(Capture_Format format);
+    /* Destructor, finishes writing if the capture is still open */
+    ~Frame_Capture();
+    /* Create the stream, or check the first file of a sequence can be created, and start the writer thread */
+    bool open(const std::string &path);
+    /* Queue a copy of the display for the writer thread, from the emulating thread */
+    void capture(const Framebuffer &framebuffer);
+    /* Write the frames still queued, stop the writer thread and close the stream, returns false if any write failed */
+    bool close();
+    /* Counts of the frames so far, exact once the capture is closed */
+    Capture_Statistics get_statistics() const;
+  private:
+    /* Loop run on the writer thread */
+    void _run();
+    /* Convert one frame and write it out */
+    bool _write(const Captured_Frame &frame);
+    /* Fill the 128x64 RGBA image from the rendered frame, doubling the pixels of the 64x32 mode */
+    void _scale_image();
+    /* Convert the 128x64 image into the Y, U and V planes */
+    void _convert_to_yuv();
+    /* Write the rendered frame as a PPM file named after the frame number */
+    bool _write_ppm(uint64_t frame_number);
+    Capture_Format _format;
+    std::string _path;
+    std::ofstream _file;
+    /* Frames waiting for the writer thread, the slots are the preallocated pool frames are copied into */
+    Spsc_Ring<Captured_Frame, CAPTURE_QUEUE_SIZE> _frames;
+    /* Owned by the writer thread, the frame being written and its conversions */
+    Captured_Frame _frame;
+    Frame_Renderer _renderer;
+    std::vector<uint8_t> _image;
+    std::vector<uint8_t> _yuv;
+    /* Header and RGB pixels of the PPM file being written */
+    std::vector<uint8_t> _ppm;
+    char _file_path[CAPTURE_PATH_SIZE];
+    std::atomic<uint64_t> _frames_captured;
+    std::atomic<uint64_t> _frames_dropped;
+    std::atomic<uint64_t> _frames_written;
+    std::atomic<bool> _failed;
+    std::atomic<bool> _running;
+    std::mutex _wake_mutex;
+    std::condition_variable _wake;
+    std::thread _thread;
+};
+
+#endif
\ No newline at end of file
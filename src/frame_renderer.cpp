@@ -0,0 +1,76 @@
+#include <string.h>
+#include "frame_renderer.h"
+
+/* Colours of pixels on in more than the first plane, indexed by their plane bits. The first two are replaced */
+static const uint32_t plane_colours[DISPLAY_COLOURS] = {
+  PIXEL_OFF_COLOUR, PIXEL_ON_COLOUR, 0xAAAAAAFF, 0x555555FF, 0xFF0000FF, 0x00FF00FF, 0x0000FFFF, 0xFFFF00FF,
+  0x880000FF, 0x008800FF, 0x000088FF, 0x888800FF, 0xFF00FFFF, 0x00FFFFFF, 0x880088FF, 0x008888FF
+};
+
+Frame_Renderer::Frame_Renderer(uint32_t on_colour, uint32_t off_colour) {
+  for(int colour = 0; colour < DISPLAY_COLOURS; colour++) {
+    uint32_t rgba = plane_colours[colour];
+    if(colour == 0) rgba = off_colour;
+    if(colour == 1) rgba = on_colour;
+    for(int i = 0; i < RGBA_SIZE; i++) {
+      _palette[colour][i] = (rgba >> ((RGBA_SIZE - 1 - i) * 8)) & 0xFF;
+    }
+  }
+  /* Start in the 64x32 mode with every pixel off */
+  _width = LORES_WIDTH;
+  _height = LORES_HEIGHT;
+  _pixels = std::vector<uint8_t>(DISPLAY_WIDTH * DISPLAY_HEIGHT * RGBA_SIZE);
+  for(size_t i = 0; i < _pixels.size(); i += RGBA_SIZE) {
+    memcpy(&_pixels[i], _palette[0], RGBA_SIZE);
+  }
+}
+
+void Frame_Renderer::update(const Framebuffer &framebuffer, uint64_t dirty_rows) {
+  if(framebuffer_width(framebuffer) != _width) {
+    _width = framebuffer_width(framebuffer);
+    _height = framebuffer_height(framebuffer);
+    dirty_rows = ALL_ROWS_DIRTY;
+  }
+
+  while(dirty_rows) {
+    uint16_t row = __builtin_ctzll(dirty_rows);
+    dirty_rows &= dirty_rows - 1;
+    if(row >= _height) break;
+
+    /* Rows only drawn on the first plane, as on the original platform, are one bit per pixel */
+    uint64_t other_planes = 0;
+    for(uint8_t plane = 1; plane < DISPLAY_PLANES; plane++) {
+      for(uint8_t word = 0; word < ROW_WORDS; word++) {
+        other_planes |= framebuffer.planes[plane][row][word];
+      }
+    }
+
+    uint8_t *pixel = &_pixels[row * _width * RGBA_SIZE];
+    if(!other_planes) {
+      for(uint16_t x = 0; x < _width; x++, pixel += RGBA_SIZE) {
+        uint64_t bits = framebuffer.planes[0][row][x / WORD_BITS];
+        memcpy(pixel, _palette[(bits >> (WORD_BITS - 1 - x % WORD_BITS)) & 0x1], RGBA_SIZE);
+      }
+    } else {
+      for(uint16_t x = 0; x < _width; x++, pixel += RGBA_SIZE) {
+        memcpy(pixel, _palette[framebuffer_pixel(framebuffer, x, row)], RGBA_SIZE);
+      }
+    }
+  }
+}
+
+const uint8_t *Frame_Renderer::get_pixels() const {
+  return _pixels.data();
+}
+
+const uint8_t *Frame_Renderer::get_row(uint16_t row) const {
+  return &_pixels[row * _width * RGBA_SIZE];
+}
+
+uint16_t Frame_Renderer::get_width() const {
+  return _width;
+}
+
+uint16_t Frame_Renderer::get_height() const {
+  return _height;
+}
\ No newline at end of file
@@ -0,0 +1,40 @@
+#ifndef FRAME_RENDERER_H
+#define FRAME_RENDERER_H
+
+#include <stdint.h>
+#include <vector>
+#include "framebuffer.h"
+
+#define RGBA_SIZE 4
+
+/* Colours of pixels that are on and off, as 0xRRGGBBAA */
+#define PIXEL_ON_COLOUR 0xFFFFFFFF
+#define PIXEL_OFF_COLOUR 0x000000FF
+
+/* 
+  Converts the packed framebuffer into an RGBA image, one pixel per Chip 8 pixel, without a display. 
+  The image is the size of the resolution the framebuffer is in, and each pixel takes the colour 
+  indexed by its bits in the planes. Pixels only on in the first plane are the on colour
+*/
+class Frame_Renderer {
+  public:
+    /* Constructor */
+    Frame_Renderer(uint32_t on_colour = PIXEL_ON_COLOUR, uint32_t off_colour = PIXEL_OFF_COLOUR);
+    /* Redraw the dirty rows (bit N is row N) of the image from the framebuffer, or all of it if the resolution changed */
+    void update(const Framebuffer &framebuffer, uint64_t dirty_rows);
+    /* Get the RGBA image, get_width() * get_height() pixels row by row */
+    const uint8_t *get_pixels() const;
+    /* Get the RGBA data of one row */
+    const uint8_t *get_row(uint16_t row) const;
+    /* Size of the image, in the resolution of the last framebuffer drawn */
+    uint16_t get_width() const;
+    uint16_t get_height() const;
+  private:
+    /* Sized for the 128x64 mode, the 64x32 mode uses the start of it */
+    std::vector<uint8_t> _pixels;
+    uint8_t _palette[DISPLAY_COLOURS][RGBA_SIZE];
+    uint16_t _width;
+    uint16_t _height;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,224 @@
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include <array>
+#include <stdint.h>
+#include <string.h>
+#include "hash.h"
+
+/* Low resolution of the original platform */
+#define LORES_HEIGHT 32
+#define LORES_WIDTH 64
+/* High resolution of SUPER-CHIP and XO-CHIP, the size every plane is allocated with */
+#define DISPLAY_HEIGHT 64
+#define DISPLAY_WIDTH 128
+/* XO-CHIP bitplanes, the colour of a pixel is made of one bit from each */
+#define DISPLAY_PLANES 4
+#define DISPLAY_COLOURS (1 << DISPLAY_PLANES)
+
+#define WORD_BITS 64
+/* Words holding one row of a plane */
+#define ROW_WORDS (DISPLAY_WIDTH / WORD_BITS)
+
+#define SPRITE_WIDTH 8
+/* Width of the 16x16 sprites DXY0 draws on SUPER-CHIP and XO-CHIP */
+#define LARGE_SPRITE_WIDTH 16
+
+/* 64x32 display packed as one 64-bit word per row, the leftmost pixel is the top bit */
+typedef std::array<uint64_t, LORES_HEIGHT> Lores_Framebuffer;
+
+/* 
+  Display of up to four planes of 128x64 pixels, each row packed into two 64-bit words with the leftmost 
+  pixel in the top bit of the first. In low resolution only the top left 64x32 pixels are used, so a 
+  row is the first word alone, laid out as in a Lores_Framebuffer
+*/
+typedef struct Framebuffer {
+  uint64_t planes[DISPLAY_PLANES][DISPLAY_HEIGHT][ROW_WORDS];
+  /* Set in the 128x64 mode */
+  uint8_t hires;
+  /* Explicit padding, zeroed so framebuffers compare and hash as plain bytes */
+  uint8_t reserved[7];
+} Framebuffer;
+
+/* Every row of the display marked as changed, bit N is row N */
+#define ALL_ROWS_DIRTY (~0ULL)
+
+inline uint16_t framebuffer_width(const Framebuffer &framebuffer) {
+  return framebuffer.hires ? DISPLAY_WIDTH : LORES_WIDTH;
+}
+
+inline uint16_t framebuffer_height(const Framebuffer &framebuffer) {
+  return framebuffer.hires ? DISPLAY_HEIGHT : LORES_HEIGHT;
+}
+
+/* Rows that differ between two framebuffers, bit N is row N. Every row differs after a change of resolution */
+inline uint64_t framebuffer_changed_rows(const Framebuffer &a, const Framebuffer &b) {
+  if(a.hires != b.hires) return ALL_ROWS_DIRTY;
+  uint64_t changed_rows = 0;
+  for(uint16_t y = 0; y < DISPLAY_HEIGHT; y++) {
+    uint64_t difference = 0;
+    for(uint8_t plane = 0; plane < DISPLAY_PLANES; plane++) {
+      for(uint8_t word = 0; word < ROW_WORDS; word++) {
+        difference |= a.planes[plane][y][word] ^ b.planes[plane][y][word];
+      }
+    }
+    if(difference) changed_rows |= 1ULL << y;
+  }
+  return changed_rows;
+}
+
+/* Colour of the pixel at (x, y) in the current resolution, bit N is set if it is on in plane N */
+inline uint8_t framebuffer_pixel(const Framebuffer &framebuffer, uint16_t x, uint16_t y) {
+  uint8_t colour = 0;
+  for(uint8_t plane = 0; plane < DISPLAY_PLANES; plane++) {
+    uint64_t word = framebuffer.planes[plane][y][x / WORD_BITS];
+    colour |= ((word >> (WORD_BITS - 1 - x % WORD_BITS)) & 0x1) << plane;
+  }
+  return colour;
+}
+
+/* 
+  Hash of the display. A low resolution display drawn only on the first plane hashes as the packed rows 
+  of a Lores_Framebuffer, so hashes of programs for the original platform stay the same
+*/
+inline uint64_t framebuffer_hash(const Framebuffer &framebuffer, uint64_t hash = FNV_OFFSET_BASIS) {
+  bool lores_only = !framebuffer.hires;
+  for(uint8_t plane = 1; plane < DISPLAY_PLANES && lores_only; plane++) {
+    for(uint16_t y = 0; y < LORES_HEIGHT; y++) {
+      if(framebuffer.planes[plane][y][0]) lores_only = false;
+    }
+  }
+  if(!lores_only) return fnv1a_64(&framebuffer, sizeof(Framebuffer), hash);
+
+  Lores_Framebuffer rows;
+  for(uint16_t y = 0; y < LORES_HEIGHT; y++) {
+    rows[y] = framebuffer.planes[0][y][0];
+  }
+  return fnv1a_64(rows.data(), sizeof(Lores_Framebuffer), hash);
+}
+
+/* 
+  XOR a sprite into packed rows, stride words apart, of a display row_words words wide and height rows 
+  tall. Sprite rows are sprite_width (8 or 16) pixels wide and big endian. (x, y) is wrapped onto the 
+  display, rows going off the right or bottom edge are cut off when clipping and wrap around otherwise. 
+  A sprite row covers at most two words, the one x falls in and the part spilling into the next. The 
+  bits of the rows drawn to are set in dirty_rows. Returns true if any pixel was turned off
+*/
+inline bool blit_sprite_rows(uint64_t *rows, uint8_t stride, uint8_t row_words, uint16_t height, 
+  uint16_t x, uint16_t y, const uint8_t *sprite, uint8_t sprite_height, uint8_t sprite_width, 
+  bool clip, uint64_t &dirty_rows) {
+  x %= row_words * WORD_BITS;
+  y %= height;
+  uint8_t word = x / WORD_BITS;
+  uint8_t offset = x % WORD_BITS;
+  /* The part past the last word of the row wraps around to the first */
+  uint8_t next_word = word + 1 == row_words ? 0 : word + 1;
+  bool spills = offset + sprite_width > WORD_BITS && !(clip && next_word == 0);
+  uint8_t sprite_bytes = sprite_width / SPRITE_WIDTH;
+
+  uint64_t collision = 0;
+  for(uint16_t i = 0; i < sprite_height; i++) {
+    uint16_t row_y = y + i;
+    if(row_y >= height) {
+      if(clip) break;
+      row_y -= height;
+    }
+
+    /* Line the sprite row up with the left edge, then shift it into place */
+    uint64_t sprite_row = sprite[i * sprite_bytes];
+    if(sprite_bytes == 2) sprite_row = (sprite_row << SPRITE_WIDTH) | sprite[i * sprite_bytes + 1];
+    sprite_row <<= WORD_BITS - sprite_width;
+
+    uint64_t *row = &rows[row_y * stride];
+    uint64_t drawn = sprite_row >> offset;
+    collision |= row[word] & drawn;
+    row[word] ^= drawn;
+    if(spills) {
+      uint64_t spilled = sprite_row << (WORD_BITS - offset);
+      collision |= row[next_word] & spilled;
+      row[next_word] ^= spilled;
+      drawn |= spilled;
+    }
+    if(drawn) dirty_rows |= 1ULL << row_y;
+  }
+  return collision != 0;
+}
+
+/* XOR a sprite of 8 pixel wide rows into a 64x32 display, see blit_sprite_rows */
+inline bool blit_sprite(Lores_Framebuffer &framebuffer, uint8_t x, uint8_t y, const uint8_t *sprite, 
+  uint8_t height, bool clip, uint64_t &dirty_rows) {
+  return blit_sprite_rows(framebuffer.data(), 1, 1, LORES_HEIGHT, x, y, sprite, height, SPRITE_WIDTH, 
+    clip, dirty_rows);
+}
+
+/* XOR a sprite into one plane of the display in its current resolution, see blit_sprite_rows */
+inline bool blit_sprite(Framebuffer &framebuffer, uint8_t plane, uint8_t x, uint8_t y, const uint8_t *sprite, 
+  uint8_t height, uint8_t sprite_width, bool clip, uint64_t &dirty_rows) {
+  return blit_sprite_rows(&framebuffer.planes[plane][0][0], ROW_WORDS, framebuffer_width(framebuffer) / WORD_BITS, 
+    framebuffer_height(framebuffer), x, y, sprite, height, sprite_width, clip, dirty_rows);
+}
+
+/* Turn off every pixel of the planes in the mask (bit N is plane N) */
+inline void clear_planes(Framebuffer &framebuffer, uint8_t plane_mask) {
+  for(uint8_t plane = 0; plane < DISPLAY_PLANES; plane++) {
+    if(plane_mask & (1 << plane)) memset(framebuffer.planes[plane], 0, sizeof(framebuffer.planes[plane]));
+  }
+}
+
+/* Move the rows of the planes in the mask down by n rows of the current resolution, clearing the rows at the top */
+inline void scroll_down(Framebuffer &framebuffer, uint8_t plane_mask, uint8_t n) {
+  uint16_t height = framebuffer_height(framebuffer);
+  if(n > height) n = height;
+  for(uint8_t plane = 0; plane < DISPLAY_PLANES; plane++) {
+    if(!(plane_mask & (1 << plane))) continue;
+    uint64_t (*rows)[ROW_WORDS] = framebuffer.planes[plane];
+    memmove(rows[n], rows[0], (height - n) * sizeof(rows[0]));
+    memset(rows[0], 0, n * sizeof(rows[0]));
+  }
+}
+
+/* Move the rows of the planes in the mask up by n rows of the current resolution, clearing the rows at the bottom */
+inline void scroll_up(Framebuffer &framebuffer, uint8_t plane_mask, uint8_t n) {
+  uint16_t height = framebuffer_height(framebuffer);
+  if(n > height) n = height;
+  for(uint8_t plane = 0; plane < DISPLAY_PLANES; plane++) {
+    if(!(plane_mask & (1 << plane))) continue;
+    uint64_t (*rows)[ROW_WORDS] = framebuffer.planes[plane];
+    memmove(rows[0], rows[n], (height - n) * sizeof(rows[0]));
+    memset(rows[height - n], 0, n * sizeof(rows[0]));
+  }
+}
+
+/* Move the pixels of the planes in the mask right by n (1 to 63), carrying bits from one word of a row into the next */
+inline void scroll_right(Framebuffer &framebuffer, uint8_t plane_mask, uint8_t n) {
+  uint16_t height = framebuffer_height(framebuffer);
+  uint8_t row_words = framebuffer_width(framebuffer) / WORD_BITS;
+  for(uint8_t plane = 0; plane < DISPLAY_PLANES; plane++) {
+    if(!(plane_mask & (1 << plane))) continue;
+    for(uint16_t y = 0; y < height; y++) {
+      uint64_t *row = framebuffer.planes[plane][y];
+      for(uint8_t word = row_words - 1; word > 0; word--) {
+        row[word] = (row[word] >> n) | (row[word - 1] << (WORD_BITS - n));
+      }
+      row[0] >>= n;
+    }
+  }
+}
+
+/* Move the pixels of the planes in the mask left by n (1 to 63), carrying bits from one word of a row into the previous */
+inline void scroll_left(Framebuffer &framebuffer, uint8_t plane_mask, uint8_t n) {
+  uint16_t height = framebuffer_height(framebuffer);
+  uint8_t row_words = framebuffer_width(framebuffer) / WORD_BITS;
+  for(uint8_t plane = 0; plane < DISPLAY_PLANES; plane++) {
+    if(!(plane_mask & (1 << plane))) continue;
+    for(uint16_t y = 0; y < height; y++) {
+      uint64_t *row = framebuffer.planes[plane][y];
+      for(uint8_t word = 0; word + 1 < row_words; word++) {
+        row[word] = (row[word] << n) | (row[word + 1] >> (WORD_BITS - n));
+      }
+      row[row_words - 1] <<= n;
+    }
+  }
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,546 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "gdb_stub.h"
+
+#define GDB_INTERRUPT 0x03
+#define GDB_ESCAPE '}'
+#define GDB_ESCAPE_XOR 0x20
+#define GDB_READ_SIZE 4096
+/* Most hex digits of a number in a packet, so it cannot overflow 32 bits */
+#define GDB_MAX_NUMBER_DIGITS 8
+/* Registers in the order of the target description and the g packet */
+#define GDB_REGISTER_I 16
+#define GDB_REGISTER_PC 17
+#define GDB_REGISTER_SP 18
+#define GDB_REGISTER_DT 19
+#define GDB_REGISTER_ST 20
+#define GDB_REGISTER_COUNT 21
+/* Signals in stop replies */
+#define GDB_SIGINT 0x02
+#define GDB_SIGTRAP 0x05
+
+static const char hex_digits[] = "0123456789abcdef";
+
+static void append_hex(std::string &out, uint64_t value, uint8_t bytes) {
+  /* Registers are sent in target byte order, which is little endian */
+  for(uint8_t i = 0; i < bytes; i++) {
+    uint8_t byte = static_cast<uint8_t>(value >> (i * 8));
+    out += hex_digits[byte >> 4];
+    out += hex_digits[byte & 0xF];
+  }
+}
+
+static int hex_value(char digit) {
+  if(digit >= '0' && digit <= '9') return digit - '0';
+  if(digit >= 'a' && digit <= 'f') return digit - 'a' + 10;
+  if(digit >= 'A' && digit <= 'F') return digit - 'A' + 10;
+  return -1;
+}
+
+/* Parse a number written in hex as in the addresses of packets, returns false if there are no digits or too many */
+static bool parse_hex(const std::string &text, size_t &position, uint32_t &value) {
+  size_t start = position;
+  value = 0;
+  while(position < text.size() && hex_value(text[position]) >= 0) {
+    if(position - start == GDB_MAX_NUMBER_DIGITS) return false;
+    value = (value << 4) | hex_value(text[position++]);
+  }
+  return position > start;
+}
+
+/* Check the range lies in memory, without the end wrapping around */
+static bool in_memory(uint32_t address, uint32_t length, uint32_t memory_size) {
+  return address < memory_size && length <= memory_size - address;
+}
+
+/* Parse little endian bytes written as hex pairs, as in register values */
+static bool parse_hex_bytes(const std::string &text, size_t position, uint8_t bytes, uint32_t &value) {
+  if(position + bytes * 2 > text.size()) return false;
+  value = 0;
+  for(uint8_t i = 0; i < bytes; i++) {
+    int high = hex_value(text[position + i * 2]);
+    int low = hex_value(text[position + i * 2 + 1]);
+    if(high < 0 || low < 0) return false;
+    value |= static_cast<uint32_t>((high << 4) | low) << (i * 8);
+  }
+  return true;
+}
+
+static uint8_t register_size(uint32_t number) {
+  return number == GDB_REGISTER_I || number == GDB_REGISTER_PC ? 2 : 1;
+}
+
+static uint32_t read_register(const Machine_State &state, uint32_t number) {
+  if(number < NUMBER_OF_GENERAL_REGISTERS) return state.vs[number];
+  switch(number) {
+    case GDB_REGISTER_I: return state.index_register;
+    case GDB_REGISTER_PC: return state.program_counter;
+    case GDB_REGISTER_SP: return state.stack_pointer;
+    case GDB_REGISTER_DT: return state.delay_timer;
+    default: return state.sound_timer;
+  }
+}
+
+/* The registers of the g packet, with the program counter as a code pointer so the client can disassemble at it */
+static std::string target_description() {
+  std::string xml = "<?xml version=\"1.0\"?><!DOCTYPE target SYSTEM \"gdb-target.dtd\">"
+    "<target version=\"1.0\"><feature name=\"org.chip8.core\">";
+  for(int v = 0; v < NUMBER_OF_GENERAL_REGISTERS; v++) {
+    xml += "<reg name=\"v";
+    xml += hex_digits[v];
+    xml += "\" bitsize=\"8\" type=\"uint8\"/>";
+  }
+  xml += "<reg name=\"i\" bitsize=\"16\" type=\"data_ptr\"/>"
+    "<reg name=\"pc\" bitsize=\"16\" type=\"code_ptr\"/>"
+    "<reg name=\"sp\" bitsize=\"8\" type=\"uint8\"/>"
+    "<reg name=\"dt\" bitsize=\"8\" type=\"uint8\"/>"
+    "<reg name=\"st\" bitsize=\"8\" type=\"uint8\"/>"
+    "</feature></target>";
+  return xml;
+}
+
+Gdb_Stub::Gdb_Stub(Chip_8 &chip_8, Debugger &debugger) : _chip_8(chip_8), _debugger(debugger), _listen_socket(-1), 
+  _socket(-1), _no_ack(false), _buffer_position(0) {}
+
+Gdb_Stub::~Gdb_Stub() {
+  _close_connection();
+  if(_listen_socket >= 0) close(_listen_socket);
+  if(!_socket_path.empty()) unlink(_socket_path.c_str());
+}
+
+bool Gdb_Stub::listen(const std::string &endpoint) {
+  bool is_port = !endpoint.empty() && endpoint.find_first_not_of("0123456789") == std::string::npos;
+  if(is_port) {
+    uint32_t port = strtoul(endpoint.c_str(), nullptr, 10);
+    if(port == 0 || port > 0xFFFF) return false;
+    _listen_socket = socket(AF_INET, SOCK_STREAM, 0);
+    if(_listen_socket < 0) return false;
+    int reuse = 1;
+    setsockopt(_listen_socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    /* Only reachable from this host, the stub can read and write all of the machine */
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if(bind(_listen_socket, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0) return false;
+  } else {
+    sockaddr_un address{};
+    if(endpoint.size() >= sizeof(address.sun_path)) return false;
+    _listen_socket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(_listen_socket < 0) return false;
+    address.sun_family = AF_UNIX;
+    endpoint.copy(address.sun_path, endpoint.size());
+    unlink(endpoint.c_str());
+    if(bind(_listen_socket, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0) return false;
+    _socket_path = endpoint;
+  }
+  return ::listen(_listen_socket, 1) == 0;
+}
+
+/* The machine is reported as stopped by a trap before its first instruction, as a freshly started program is */
+bool Gdb_Stub::attach() {
+  _socket = accept(_listen_socket, nullptr, nullptr);
+  if(_socket < 0) return false;
+  int no_delay = 1;
+  setsockopt(_socket, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+  _no_ack = false;
+  _buffer.clear();
+  _buffer_position = 0;
+  _debugger.stop(Stop_Reason::STEP, _chip_8.get_state().program_counter);
+  return _stopped();
+}
+
+bool Gdb_Stub::after_frame(uint64_t frame) {
+  if(_socket < 0) return true;
+  if(_chip_8.get_halt_state() != Halt_State::BREAK) {
+    if(frame % GDB_POLL_FRAMES != 0) return true;
+    /* Bytes left over from the last packet are checked before the socket */
+    bool interrupted = false;
+    while(_buffer_position < _buffer.size() && !interrupted) {
+      interrupted = _buffer[_buffer_position++] == GDB_INTERRUPT;
+    }
+    uint8_t byte;
+    while(!interrupted) {
+      ssize_t read = recv(_socket, &byte, 1, MSG_DONTWAIT);
+      if(read == 0) {
+        /* The client went away without detaching */
+        _debugger.clear();
+        _chip_8.set_debugger(&_debugger);
+        _close_connection();
+        return true;
+      }
+      if(read < 0) return true;
+      interrupted = byte == GDB_INTERRUPT;
+    }
+    _debugger.stop(Stop_Reason::INTERRUPT, _chip_8.get_state().program_counter);
+  }
+  return _stopped();
+}
+
+void Gdb_Stub::finish(uint8_t exit_code) {
+  if(_socket < 0) return;
+  std::string reply = "W";
+  append_hex(reply, exit_code, 1);
+  _send_packet(reply);
+  _close_connection();
+}
+
+bool Gdb_Stub::is_attached() const {
+  return _socket >= 0;
+}
+
+/* A step or breakpoint hit while resuming the rest of a frame stops again here, before the frame ends */
+bool Gdb_Stub::_stopped() {
+  while(true) {
+    Gdb_Resume resume = _send_packet(_stop_reply()) ? _serve() : Gdb_Resume::RESUME_DETACH;
+    if(resume == Gdb_Resume::RESUME_KILL) return false;
+    if(resume == Gdb_Resume::RESUME_DETACH) {
+      _debugger.clear();
+      _close_connection();
+    } else if(resume == Gdb_Resume::RESUME_STEP) {
+      _debugger.request_step();
+    }
+
+    /* Making the debugger active or inactive swaps the checking loop in or out */
+    _chip_8.set_debugger(&_debugger);
+    _chip_8.resume_frame();
+    if(_socket < 0 || _chip_8.get_halt_state() != Halt_State::BREAK) return true;
+  }
+}
+
+Gdb_Resume Gdb_Stub::_serve() {
+  std::string packet;
+  std::string reply;
+  while(_read_packet(packet)) {
+    Gdb_Resume resume;
+    reply.clear();
+    if(!_handle(packet, reply, resume)) return resume;
+    if(!_send_packet(reply)) break;
+  }
+  return Gdb_Resume::RESUME_DETACH;
+}
+
+/* Packets not handled here get an empty reply, which tells the client they are not supported */
+bool Gdb_Stub::_handle(const std::string &packet, std::string &reply, Gdb_Resume &resume) {
+  if(packet.empty()) return true;
+  /* Packets that change the machine edit a copy of the part of the state in use, and set it back */
+  const Machine_State &current = _chip_8.get_state();
+  Machine_State state;
+  Platform platform = _chip_8.get_platform();
+  uint32_t memory_size = platform_memory_size(platform);
+  size_t position = 1;
+  uint32_t address;
+  uint32_t length;
+
+  switch(packet[0]) {
+    case '?':
+      reply = _stop_reply();
+      return true;
+
+    case 'c':
+      resume = Gdb_Resume::RESUME_CONTINUE;
+      return false;
+
+    case 's':
+      resume = Gdb_Resume::RESUME_STEP;
+      return false;
+
+    case 'D':
+      _send_packet("OK");
+      resume = Gdb_Resume::RESUME_DETACH;
+      return false;
+
+    case 'k':
+      resume = Gdb_Resume::RESUME_KILL;
+      return false;
+
+    case 'H':
+      reply = "OK";
+      return true;
+
+    case 'g':
+      for(uint32_t number = 0; number < GDB_REGISTER_COUNT; number++) {
+        append_hex(reply, read_register(current, number), register_size(number));
+      }
+      return true;
+
+    case 'G':
+      copy_state(state, current, platform);
+      for(uint32_t number = 0; number < GDB_REGISTER_COUNT; number++) {
+        uint32_t value;
+        if(!parse_hex_bytes(packet, position, register_size(number), value)) {
+          reply = "E01";
+          return true;
+        }
+        _write_register(state, number, value);
+        position += register_size(number) * 2;
+      }
+      _chip_8.set_state(state);
+      reply = "OK";
+      return true;
+
+    case 'p':
+      if(!parse_hex(packet, position, address) || address >= GDB_REGISTER_COUNT) {
+        reply = "E01";
+        return true;
+      }
+      append_hex(reply, read_register(current, address), register_size(address));
+      return true;
+
+    case 'P':
+      {
+        uint32_t value;
+        if(!parse_hex(packet, position, address) || position >= packet.size() || packet[position] != '=' || 
+          address >= GDB_REGISTER_COUNT || !parse_hex_bytes(packet, position + 1, register_size(address), value)) {
+          reply = "E01";
+          return true;
+        }
+        copy_state(state, current, platform);
+        _write_register(state, address, value);
+        _chip_8.set_state(state);
+        reply = "OK";
+      }
+      return true;
+
+    case 'm':
+      if(!parse_hex(packet, position, address) || position >= packet.size() || packet[position++] != ',' || 
+        !parse_hex(packet, position, length) || !in_memory(address, length, memory_size)) {
+        reply = "E01";
+        return true;
+      }
+      for(uint32_t i = 0; i < length; i++) {
+        append_hex(reply, current.memory[address + i], 1);
+      }
+      return true;
+
+    case 'M':
+      if(!parse_hex(packet, position, address) || position >= packet.size() || packet[position++] != ',' || 
+        !parse_hex(packet, position, length) || position >= packet.size() || packet[position++] != ':' || 
+        !in_memory(address, length, memory_size)) {
+        reply = "E01";
+        return true;
+      }
+      copy_state(state, current, platform);
+      for(uint32_t i = 0; i < length; i++) {
+        uint32_t value;
+        if(!parse_hex_bytes(packet, position + i * 2, 1, value)) {
+          reply = "E01";
+          return true;
+        }
+        state.memory[address + i] = static_cast<uint8_t>(value);
+      }
+      /* Replacing the state drops the instructions cached from the old bytes */
+      _chip_8.set_state(state);
+      reply = "OK";
+      return true;
+
+    case 'Z':
+    case 'z':
+      {
+        /* Z0 and Z1 are breakpoints, Z2 to Z4 write, read and access watchpoints over length bytes */
+        bool add = packet[0] == 'Z';
+        uint32_t type;
+        if(!parse_hex(packet, position, type) || type > 4 || position >= packet.size() || packet[position++] != ',' || 
+          !parse_hex(packet, position, address) || position >= packet.size() || packet[position++] != ',' || 
+          !parse_hex(packet, position, length) || address >= memory_size || 
+          (type > 1 && !in_memory(address, length, memory_size))) {
+          reply = "E01";
+          return true;
+        }
+        if(type <= 1) {
+          if(add) {
+            _debugger.add_breakpoint(static_cast<uint16_t>(address));
+          } else {
+            _debugger.remove_breakpoint(static_cast<uint16_t>(address));
+          }
+        } else {
+          Watch_Kind kind = type == 2 ? Watch_Kind::WATCH_WRITE : type == 3 ? Watch_Kind::WATCH_READ : Watch_Kind::WATCH_ACCESS;
+          if(add) {
+            _debugger.add_watchpoint(static_cast<uint16_t>(address), static_cast<uint16_t>(length), kind);
+          } else {
+            _debugger.remove_watchpoint(static_cast<uint16_t>(address), static_cast<uint16_t>(length), kind);
+          }
+        }
+        reply = "OK";
+      }
+      return true;
+
+    case 'q':
+      if(packet.compare(0, 10, "qSupported") == 0) {
+        char supported[64];
+        snprintf(supported, sizeof(supported), "PacketSize=%x;qXfer:features:read+;QStartNoAckMode+", GDB_PACKET_SIZE);
+        reply = supported;
+      } else if(packet == "qAttached") {
+        reply = "1";
+      } else if(packet == "qC") {
+        reply = "QC1";
+      } else if(packet == "qfThreadInfo") {
+        reply = "m1";
+      } else if(packet == "qsThreadInfo") {
+        reply = "l";
+      } else if(packet == "qOffsets") {
+        reply = "Text=0;Data=0;Bss=0";
+      } else if(packet.compare(0, 31, "qXfer:features:read:target.xml:") == 0) {
+        /* The description is sent in pieces of the length the client asks for, the last one marked with l */
+        position = 31;
+        uint32_t offset;
+        if(!parse_hex(packet, position, offset) || position >= packet.size() || packet[position++] != ',' || 
+          !parse_hex(packet, position, length)) {
+          reply = "E01";
+          return true;
+        }
+        std::string xml = target_description();
+        if(offset >= xml.size()) {
+          reply = "l";
+        } else {
+          reply = (length >= xml.size() - offset ? "l" : "m") + xml.substr(offset, length);
+        }
+      }
+      return true;
+
+    case 'Q':
+      if(packet == "QStartNoAckMode") {
+        /* The acknowledgement the client still sends for this reply is skipped as a byte outside a packet */
+        _no_ack = true;
+        reply = "OK";
+      }
+      return true;
+
+    default:
+      return true;
+  }
+}
+
+/* Watchpoint stops name the address so the client can tell which of its watchpoints fired */
+std::string Gdb_Stub::_stop_reply() const {
+  std::string reply = "T";
+  switch(_debugger.get_stop_reason()) {
+    case Stop_Reason::INTERRUPT:
+      append_hex(reply, GDB_SIGINT, 1);
+      break;
+
+    case Stop_Reason::WATCHPOINT:
+      append_hex(reply, GDB_SIGTRAP, 1);
+      switch(_debugger.get_stop_watch_kind()) {
+        case Watch_Kind::WATCH_READ: reply += "rwatch:"; break;
+        case Watch_Kind::WATCH_WRITE: reply += "watch:"; break;
+        default: reply += "awatch:"; break;
+      }
+      {
+        char address[8];
+        snprintf(address, sizeof(address), "%x;", _debugger.get_stop_address());
+        reply += address;
+      }
+      break;
+
+    default:
+      append_hex(reply, GDB_SIGTRAP, 1);
+      break;
+  }
+  return reply;
+}
+
+/* Bytes outside a packet, acknowledgements and interrupts sent while already stopped, are skipped */
+bool Gdb_Stub::_read_packet(std::string &packet) {
+  while(true) {
+    uint8_t byte;
+    do {
+      if(!_read_byte(byte)) return false;
+    } while(byte != '$');
+
+    packet.clear();
+    uint8_t checksum = 0;
+    while(true) {
+      if(!_read_byte(byte)) return false;
+      if(byte == '#') break;
+      checksum += byte;
+      if(byte == GDB_ESCAPE) {
+        if(!_read_byte(byte)) return false;
+        checksum += byte;
+        byte ^= GDB_ESCAPE_XOR;
+      }
+      packet += static_cast<char>(byte);
+    }
+
+    uint8_t digits[2];
+    if(!_read_byte(digits[0]) || !_read_byte(digits[1])) return false;
+    int sent_checksum = (hex_value(digits[0]) << 4) | hex_value(digits[1]);
+    if(_no_ack) return true;
+    bool valid = hex_value(digits[0]) >= 0 && hex_value(digits[1]) >= 0 && sent_checksum == checksum;
+    const char acknowledgement = valid ? '+' : '-';
+    if(send(_socket, &acknowledgement, 1, MSG_NOSIGNAL) != 1) return false;
+    if(valid) return true;
+  }
+}
+
+bool Gdb_Stub::_send_packet(const std::string &data) {
+  if(_socket < 0) return false;
+  std::string packet = "$";
+  uint8_t checksum = 0;
+  for(char c : data) {
+    if(c == '$' || c == '#' || c == GDB_ESCAPE || c == '*') {
+      packet += GDB_ESCAPE;
+      checksum += GDB_ESCAPE;
+      c ^= GDB_ESCAPE_XOR;
+    }
+    packet += c;
+    checksum += static_cast<uint8_t>(c);
+  }
+  packet += '#';
+  append_hex(packet, checksum, 1);
+
+  /* Sent again until the client acknowledges it, unless acknowledgements were turned off */
+  while(true) {
+    if(send(_socket, packet.data(), packet.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(packet.size())) return false;
+    if(_no_ack) return true;
+    uint8_t byte;
+    do {
+      if(!_read_byte(byte)) return false;
+    } while(byte != '+' && byte != '-');
+    if(byte == '+') return true;
+  }
+}
+
+bool Gdb_Stub::_read_byte(uint8_t &byte) {
+  if(_buffer_position == _buffer.size()) {
+    _buffer.resize(GDB_READ_SIZE);
+    ssize_t read = recv(_socket, _buffer.data(), GDB_READ_SIZE, 0);
+    if(read <= 0) {
+      _buffer.clear();
+      _buffer_position = 0;
+      return false;
+    }
+    _buffer.resize(read);
+    _buffer_position = 0;
+  }
+  byte = _buffer[_buffer_position++];
+  return true;
+}
+
+bool Gdb_Stub::_write_register(Machine_State &state, uint32_t number, uint32_t value) {
+  if(number < NUMBER_OF_GENERAL_REGISTERS) {
+    state.vs[number] = static_cast<uint8_t>(value);
+    return true;
+  }
+  switch(number) {
+    case GDB_REGISTER_I: state.index_register = static_cast<uint16_t>(value); return true;
+    case GDB_REGISTER_PC: state.program_counter = static_cast<uint16_t>(value); return true;
+    case GDB_REGISTER_SP: state.stack_pointer = static_cast<uint8_t>(value % (STACK_DEPTH + 1)); return true;
+    case GDB_REGISTER_DT: state.delay_timer = static_cast<uint8_t>(value); return true;
+    case GDB_REGISTER_ST: state.sound_timer = static_cast<uint8_t>(value); return true;
+    default: return false;
+  }
+}
+
+void Gdb_Stub::_close_connection() {
+  if(_socket >= 0) close(_socket);
+  _socket = -1;
+  _buffer.clear();
+  _buffer_position = 0;
+}
\ No newline at end of file
@@ -0,0 +1,83 @@
+#ifndef GDB_STUB_H
+#define GDB_STUB_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "chip_8.h"
+#include "debugger.h"
+
+/* Frames run between two checks for an interrupt from the client while the machine runs */
+#define GDB_POLL_FRAMES 64
+/* Largest packet the client is told it may send */
+#define GDB_PACKET_SIZE 0x4000
+
+/* What the client asked for when it stopped handling packets */
+typedef enum Gdb_Resume {
+  RESUME_CONTINUE,
+  RESUME_STEP,
+  /* The client detached or the connection closed, the machine runs on without the debugger */
+  RESUME_DETACH,
+  RESUME_KILL
+} Gdb_Resume;
+
+/*
+  Stub of the GDB remote serial protocol on a local socket, driving a Chip_8 and its Debugger from the 
+  thread running the machine. Registers are v0 to vF, i, pc, sp, dt and st as described in the target 
+  description it sends, and memory is the memory of the platform. While the machine runs the stub only 
+  looks for an interrupt every GDB_POLL_FRAMES frames, so it costs nothing per instruction
+*/
+class Gdb_Stub {
+  public:
+    /* Constructor */
+    Gdb_Stub(Chip_8 &chip_8, Debugger &debugger);
+    /* Destructor, closes the sockets */
+    ~Gdb_Stub();
+    /* 
+      Listen on 127.0.0.1 at the port if the endpoint is a number, otherwise on a Unix socket at the path, 
+      returns false if it could not be bound
+    */
+    bool listen(const std::string &endpoint);
+    /* Wait for a client and handle its packets with the machine stopped until it resumes it */
+    bool attach();
+    /* 
+      Called after every frame. Stops for the client if the machine hit a BREAK or the client interrupted 
+      it, and resumes the machine as the client asks. Returns false once the client killed the program
+    */
+    bool after_frame(uint64_t frame);
+    /* Tell the client the program exited with the code, and close the connection */
+    void finish(uint8_t exit_code);
+    /* Check if a client is attached */
+    bool is_attached() const;
+  private:
+    /* Report the stop, handle packets until the client resumes, and resume the machine */
+    bool _stopped();
+    /* Handle packets until one resumes the machine */
+    Gdb_Resume _serve();
+    /* Answer to one packet, returns false if the packet resumes the machine, with the way it does in resume */
+    bool _handle(const std::string &packet, std::string &reply, Gdb_Resume &resume);
+    /* Stop reply for the reason the machine stopped */
+    std::string _stop_reply() const;
+    /* Read one packet, acknowledging it, returns false if the connection closed */
+    bool _read_packet(std::string &packet);
+    /* Send one packet, returns false if the connection closed */
+    bool _send_packet(const std::string &data);
+    /* Read one byte from the client, returns false if the connection closed */
+    bool _read_byte(uint8_t &byte);
+    /* Set the register to the value, returns false if there is no such register */
+    bool _write_register(Machine_State &state, uint32_t number, uint32_t value);
+    void _close_connection();
+    Chip_8 &_chip_8;
+    Debugger &_debugger;
+    int _listen_socket;
+    int _socket;
+    /* Path of the Unix socket to remove at the end, empty for a TCP socket */
+    std::string _socket_path;
+    /* Set once the client asked to stop acknowledging packets */
+    bool _no_ack;
+    /* Bytes read from the socket and not yet parsed */
+    std::vector<uint8_t> _buffer;
+    size_t _buffer_position;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,20 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define FNV_OFFSET_BASIS 0xCBF29CE484222325ULL
+#define FNV_PRIME 0x100000001B3ULL
+
+/* 64-bit FNV-1a hash of a block of bytes, can be chained by passing the previous hash */
+inline uint64_t fnv1a_64(const void *data, size_t size, uint64_t hash = FNV_OFFSET_BASIS) {
+  const uint8_t *bytes = static_cast<const uint8_t *>(data);
+  for(size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= FNV_PRIME;
+  }
+  return hash;
+}
+
+#endif
\ No newline at end of file
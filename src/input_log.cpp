@@ -0,0 +1,96 @@
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include "byte_stream.h"
+#include "hash.h"
+#include "input_log.h"
+
+bool save_input_log(const std::string &path, const Input_Log &log) {
+  std::vector<uint8_t> data;
+  Byte_Writer writer(data);
+
+  writer.put_bytes(reinterpret_cast<const uint8_t *>(INPUT_LOG_MAGIC), INPUT_LOG_MAGIC_SIZE);
+  writer.put(INPUT_LOG_VERSION, sizeof(uint16_t));
+  writer.put(log.seed, sizeof(uint32_t));
+  writer.put(log.quirks, sizeof(uint8_t));
+  writer.put(log.platform, sizeof(uint8_t));
+  writer.put(log.cycles_per_frame, sizeof(uint32_t));
+  writer.put(log.total_cycles, sizeof(uint64_t));
+  writer.put(log.final_state_hash, sizeof(uint64_t));
+  writer.put(log.events.size(), sizeof(uint32_t));
+
+  /* Events are recorded in order, so the gaps between them are small */
+  uint64_t previous_cycle = 0;
+  for(const Input_Log_Event &event : log.events) {
+    writer.put_varint(event.cycle - previous_cycle);
+    writer.put(event.key | (event.pressed ? INPUT_LOG_PRESSED : 0), sizeof(uint8_t));
+    previous_cycle = event.cycle;
+  }
+
+  writer.put(fnv1a_64(data.data(), data.size()), sizeof(uint64_t));
+
+  std::ofstream file(path, std::ios_base::binary);
+  if(!file.good()) return false;
+  file.write(reinterpret_cast<const char *>(data.data()), data.size());
+  return file.good();
+}
+
+bool load_input_log(const std::string &path, Input_Log &log) {
+  std::ifstream file(path, std::ios_base::binary);
+  if(!file.good()) return false;
+  std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+  Byte_Reader reader(data);
+  uint8_t magic[INPUT_LOG_MAGIC_SIZE];
+  uint16_t version;
+  if(!reader.get_bytes(magic, INPUT_LOG_MAGIC_SIZE) || std::memcmp(magic, INPUT_LOG_MAGIC, INPUT_LOG_MAGIC_SIZE)) return false;
+  if(!reader.get_field(version) || version != INPUT_LOG_VERSION) return false;
+
+  /* Fill a copy so a failure leaves the log untouched */
+  Input_Log loaded;
+  uint32_t event_count;
+  uint8_t platform;
+  bool complete = reader.get_field(loaded.seed) && reader.get_field(loaded.quirks) && 
+    reader.get_field(platform) && reader.get_field(loaded.cycles_per_frame) && reader.get_field(loaded.total_cycles) && 
+    reader.get_field(loaded.final_state_hash) && reader.get_field(event_count);
+  if(!complete || loaded.cycles_per_frame == 0 || platform > Platform::XO_CHIP) return false;
+  loaded.platform = static_cast<Platform>(platform);
+
+  uint64_t cycle = 0;
+  for(uint32_t i = 0; i < event_count; i++) {
+    uint64_t gap;
+    uint8_t key;
+    if(!reader.get_varint(gap) || !reader.get_field(key)) return false;
+    cycle += gap;
+    loaded.events.push_back(Input_Log_Event{cycle, static_cast<uint8_t>(key & ~INPUT_LOG_PRESSED), 
+      (key & INPUT_LOG_PRESSED) != 0});
+  }
+
+  size_t hashed_size = reader.get_position();
+  uint64_t hash;
+  if(!reader.get_field(hash) || hash != fnv1a_64(data.data(), hashed_size)) return false;
+  if(reader.get_position() != data.size()) return false;
+
+  log = loaded;
+  return true;
+}
+
+Input_Recorder::Input_Recorder(Input_Source &source, const Chip_8 &chip_8, Input_Log &log) : 
+  _source(source), _chip_8(chip_8), _log(log) {}
+
+/* Events are applied as soon as they are polled, so the cycle count now is the one to replay them at */
+bool Input_Recorder::poll_event(Key_Event &event) {
+  if(!_source.poll_event(event)) return false;
+  _log.events.push_back(Input_Log_Event{_chip_8.get_cycle_count(), event.key, event.pressed});
+  return true;
+}
+
+Input_Replayer::Input_Replayer(const Input_Log &log, const Chip_8 &chip_8) : _log(log), _chip_8(chip_8), _next_event(0) {}
+
+bool Input_Replayer::poll_event(Key_Event &event) {
+  if(_next_event >= _log.events.size() || _log.events[_next_event].cycle > _chip_8.get_cycle_count()) return false;
+  const Input_Log_Event &logged = _log.events[_next_event++];
+  event = Key_Event{logged.key, logged.pressed, std::chrono::steady_clock::now()};
+  return true;
+}
\ No newline at end of file
@@ -0,0 +1,66 @@
+#ifndef INPUT_LOG_H
+#define INPUT_LOG_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "chip_8.h"
+#include "input_source.h"
+
+#define INPUT_LOG_MAGIC "C8IN"
+#define INPUT_LOG_MAGIC_SIZE 4
+#define INPUT_LOG_VERSION 2
+/* Bit of an event byte set for a press, the low bits hold the key */
+#define INPUT_LOG_PRESSED 0x80
+
+/* Change of one key, applied to the keypad when the machine had run this many cycles */
+typedef struct Input_Log_Event {
+  uint64_t cycle;
+  uint8_t key;
+  bool pressed;
+} Input_Log_Event;
+
+/* Everything needed to run a recorded session again, starting from the ROM */
+typedef struct Input_Log {
+  uint32_t seed;
+  uint8_t quirks;
+  Platform platform;
+  uint32_t cycles_per_frame;
+  /* Cycles run when the recording stopped */
+  uint64_t total_cycles;
+  /* State hash when the recording stopped, a replay has to end on the same one */
+  uint64_t final_state_hash;
+  std::vector<Input_Log_Event> events;
+} Input_Log;
+
+/* 
+  Write the log, with the cycle of every event stored as a varint of the cycles since the one before it.
+  Returns false if the file could not be written
+*/
+bool save_input_log(const std::string &path, const Input_Log &log);
+/* Read a log, returns false if it could not be read, is corrupted or is from another version */
+bool load_input_log(const std::string &path, Input_Log &log);
+
+/* Input source passing on the events of another one, appending each to the log with the cycle it is applied at */
+class Input_Recorder : public Input_Source {
+  public:
+    Input_Recorder(Input_Source &source, const Chip_8 &chip_8, Input_Log &log);
+    bool poll_event(Key_Event &event) override;
+  private:
+    Input_Source &_source;
+    const Chip_8 &_chip_8;
+    Input_Log &_log;
+};
+
+/* Input source giving back the events of a log once the machine has reached their cycle */
+class Input_Replayer : public Input_Source {
+  public:
+    Input_Replayer(const Input_Log &log, const Chip_8 &chip_8);
+    bool poll_event(Key_Event &event) override;
+  private:
+    const Input_Log &_log;
+    const Chip_8 &_chip_8;
+    size_t _next_event;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,56 @@
+#ifndef INPUT_SOURCE_H
+#define INPUT_SOURCE_H
+
+#include <chrono>
+#include <stdint.h>
+#include "spsc_ring.h"
+
+#define NUMBER_OF_KEYS 16
+/* Number of key events that can be waiting between the window thread and the emulation thread */
+#define KEY_EVENT_QUEUE_SIZE 256
+
+/* Change of one Chip 8 key, stamped with the time it happened on the host */
+typedef struct Key_Event {
+  uint8_t key;
+  bool pressed;
+  std::chrono::steady_clock::time_point timestamp;
+} Key_Event;
+
+/* Source of Chip 8 key events, independent of any window system */
+class Input_Source {
+  public:
+    virtual ~Input_Source() = default;
+    /* Take the oldest pending key event, returns false if there is none */
+    virtual bool poll_event(Key_Event &event) = 0;
+};
+
+/* Input source with no keys ever pressed, used when running headless */
+class No_Input : public Input_Source {
+  public:
+    bool poll_event(Key_Event &) override { return false; }
+};
+
+/* 
+  Input source queueing the key events pushed into it. Events can be pushed from one thread 
+  and polled from another
+*/
+class Key_Event_Queue : public Input_Source {
+  public:
+    Key_Event_Queue() : _dropped_events(0) {}
+    /* Queue a change of the Chip 8 key (0x0 to 0xF), stamped with the current time */
+    void push(uint8_t key, bool pressed) {
+      if(!_events.push(Key_Event{key, pressed, std::chrono::steady_clock::now()})) _dropped_events++;
+    }
+    bool poll_event(Key_Event &event) override {
+      return _events.pop(event);
+    }
+    /* Number of events lost because the queue was full, read from the pushing thread */
+    uint64_t get_dropped_events() const {
+      return _dropped_events;
+    }
+  private:
+    Spsc_Ring<Key_Event, KEY_EVENT_QUEUE_SIZE> _events;
+    uint64_t _dropped_events;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,433 @@
+#include <algorithm>
+#include <limits>
+#include <string.h>
+#include "chip_8.h"
+#include "jit.h"
+
+#if JIT_SUPPORTED
+#include <sys/mman.h>
+#endif
+
+#define NO_BLOCK -1
+#define UNTRANSLATABLE -2
+
+/* Bytes of the longest translated instruction, used to check there is room for a whole block */
+#define MAX_INSTRUCTION_CODE_SIZE 24
+#define BLOCK_OVERHEAD_CODE_SIZE 32
+
+/* Size of an exit stub, mov eax, imm32 then ret */
+#define EXIT_STUB_SIZE 6
+
+/* Guest bytes of the longest block, only blocks starting this close before a written byte can cover it */
+#define MAX_BLOCK_BYTES (JIT_MAX_BLOCK_LENGTH * INSTRUCTION_SIZE)
+
+/*
+  Register use of the generated code:
+  rdi - pointer to v0 (vX is at [rdi + X])
+  rsi - pointer to the index register
+  rdx - pointer to the remaining cycle budget
+  eax, ecx - scratch
+*/
+
+/* 
+  The buffer is never writable and executable at once, which hardened kernels refuse to map. It is made 
+  writable while code is emitted or chain jumps are patched, and executable again before a block runs
+*/
+Jit::Jit() {
+  _buffer = nullptr;
+  _used = 0;
+  _writable = true;
+#if JIT_SUPPORTED
+  void *buffer = mmap(nullptr, JIT_BUFFER_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if(buffer != MAP_FAILED) _buffer = static_cast<uint8_t *>(buffer);
+#endif
+  _block_at = std::vector<int32_t>(MEMORY_SIZE, NO_BLOCK);
+  _coverage = std::vector<uint16_t>(MEMORY_SIZE, 0);
+  _code = std::vector<uint8_t>(MEMORY_SIZE, 0);
+  _invalidations = std::vector<uint8_t>(MEMORY_SIZE, 0);
+  _pending = std::vector<std::vector<size_t>>(MEMORY_SIZE);
+}
+
+Jit::~Jit() {
+#if JIT_SUPPORTED
+  if(_buffer) munmap(_buffer, JIT_BUFFER_SIZE);
+#endif
+}
+
+bool Jit::is_available() const {
+  return _buffer != nullptr;
+}
+
+/* 
+  Runs translated blocks while the budget covers them, and interprets from the instruction cache up to the 
+  next address a block can start at otherwise
+*/
+uint32_t Jit::run(Chip_8 &chip_8, uint32_t count) {
+  uint32_t remaining = count;
+  while(remaining > 0) {
+    int32_t budget = static_cast<int32_t>(std::min<uint32_t>(remaining, std::numeric_limits<int32_t>::max()));
+    remaining -= budget;
+
+    while(budget > 0) {
+      /* Instructions that halt are never translated, so only an interpreted cycle can have halted */
+      if(chip_8._halt != Halt_State::RUNNING) return count - remaining - budget;
+      /* 
+        The interpreter keeps the bits of a program counter run past the end of memory and only wraps the 
+        fetch, so blocks, which return unwrapped addresses, are only entered from inside memory
+      */
+      uint16_t address = chip_8._state.program_counter;
+      int32_t index = address < MEMORY_SIZE ? _block_at[address] : UNTRANSLATABLE;
+      if(index == NO_BLOCK) index = _compile(chip_8, address);
+
+      if(index >= 0 && _blocks[index].length <= budget) {
+        if(_writable) _make_executable();
+        chip_8._state.program_counter = static_cast<uint16_t>(
+          _blocks[index].code(chip_8._state.vs, &chip_8._state.index_register, &budget));
+      } else {
+        /* Interpret up to the next address a block can start at, rather than coming back for every instruction */
+        do {
+          chip_8._run_threaded_cycle();
+          budget--;
+          address = chip_8._state.program_counter;
+        } while(budget > 0 && chip_8._halt == Halt_State::RUNNING && 
+          (address >= MEMORY_SIZE || _block_at[address] == UNTRANSLATABLE));
+      }
+    }
+  }
+  return count;
+}
+
+/* 
+  Drops every block covering the written byte, and untranslatable marks on the instructions containing it. 
+  Only the starts up to MAX_BLOCK_BYTES back are looked at, so a write costs the same however many blocks 
+  have been translated
+*/
+void Jit::_invalidate(uint16_t address) {
+  if(_block_at[address] == UNTRANSLATABLE) _block_at[address] = NO_BLOCK;
+  uint16_t previous = (address - 1) & (MEMORY_SIZE - 1);
+  if(_block_at[previous] == UNTRANSLATABLE) _block_at[previous] = NO_BLOCK;
+  if(_coverage[address] == 0) return;
+
+  uint32_t first = address >= MAX_BLOCK_BYTES ? address - MAX_BLOCK_BYTES + 1 : 0;
+  for(uint32_t start = first; start <= address; start++) {
+    int32_t index = _block_at[start];
+    if(index < 0 || _blocks[index].end <= address) continue;
+    if(_invalidations[start] < JIT_MAX_INVALIDATIONS) _invalidations[start]++;
+    _invalidate_block(index);
+  }
+}
+
+void Jit::_mark_untranslatable(uint16_t address) {
+  _block_at[address] = UNTRANSLATABLE;
+  _code[address] = 1;
+  _code[(address + 1) & (MEMORY_SIZE - 1)] = 1;
+}
+
+void Jit::_make_writable() {
+#if JIT_SUPPORTED
+  mprotect(_buffer, JIT_BUFFER_SIZE, PROT_READ | PROT_WRITE);
+#endif
+  _writable = true;
+}
+
+void Jit::_make_executable() {
+#if JIT_SUPPORTED
+  mprotect(_buffer, JIT_BUFFER_SIZE, PROT_READ | PROT_EXEC);
+#endif
+  _writable = false;
+}
+
+void Jit::translate(const Chip_8 &chip_8, const std::vector<uint16_t> &addresses) {
+  for(uint16_t address : addresses) {
+    if(address < MEMORY_SIZE && _block_at[address] == NO_BLOCK) _compile(chip_8, address);
+  }
+}
+
+std::vector<uint16_t> Jit::get_block_starts() const {
+  std::vector<uint16_t> starts;
+  for(const Jit_Block &block : _blocks) {
+    if(block.code) starts.push_back(block.start);
+  }
+  return starts;
+}
+
+void Jit::flush() {
+  _used = 0;
+  _blocks.clear();
+  std::fill(_block_at.begin(), _block_at.end(), NO_BLOCK);
+  std::fill(_coverage.begin(), _coverage.end(), 0);
+  std::fill(_code.begin(), _code.end(), 0);
+  std::fill(_invalidations.begin(), _invalidations.end(), 0);
+  for(std::vector<size_t> &stubs : _pending) stubs.clear();
+}
+
+void Jit::_invalidate_block(int32_t index) {
+  if(!_writable) _make_writable();
+  Jit_Block &block = _blocks[index];
+  for(size_t stub : block.incoming) {
+    _unlink(stub, block.start);
+    _pending[block.start].push_back(stub);
+  }
+  block.incoming.clear();
+  block.code = nullptr;
+  _block_at[block.start] = NO_BLOCK;
+  for(uint32_t i = block.start; i < block.end; i++) _coverage[i]--;
+}
+
+/*
+  Translates instructions from address until one ends the block. Register only instructions are
+  translated, jumps and skips end the block with an exit to each successor, anything else
+  (draws, key waits, timers, memory, stack, random) ends the block and is left to the interpreter
+*/
+int32_t Jit::_compile(const Chip_8 &chip_8, uint16_t address) {
+  /* Code that keeps rewriting itself is cheaper to interpret than to keep translating */
+  if(!_buffer || _invalidations[address] >= JIT_MAX_INVALIDATIONS) {
+    _mark_untranslatable(address);
+    return UNTRANSLATABLE;
+  }
+  if(_used + JIT_MAX_BLOCK_LENGTH * MAX_INSTRUCTION_CODE_SIZE + BLOCK_OVERHEAD_CODE_SIZE > JIT_BUFFER_SIZE) {
+    flush();
+  }
+
+  /* Find the length of the block and whether it ends on a jump or skip */
+  uint16_t length = 0;
+  bool ends_with_branch = false;
+  uint32_t pc = address;
+  while(length < JIT_MAX_BLOCK_LENGTH && pc + 1 < MEMORY_SIZE) {
+    uint8_t first_byte = chip_8._state.memory[pc];
+    uint8_t second_byte = chip_8._state.memory[pc + 1];
+    uint8_t opcode = first_byte >> NIBBLE_SIZE;
+    uint8_t n = second_byte & BACK_NIBBLE_MASK;
+
+    bool translatable = false;
+    switch(opcode) {
+      case 0x1:
+        /* A jump that may close an idle loop is left to the interpreter, which checks it every pass */
+        translatable = !chip_8._is_idle_loop_candidate(((first_byte & BACK_NIBBLE_MASK) << BYTE_SIZE) | second_byte, pc);
+        ends_with_branch = translatable;
+        break;
+      case 0x3: case 0x4: case 0x5: case 0x9:
+        ends_with_branch = true;
+        translatable = true;
+        break;
+      case 0x6: case 0x7: case 0xA:
+        translatable = true;
+        break;
+      case 0x8:
+        translatable = n <= 0x7 || n == 0xE;
+        break;
+      case 0xF:
+        translatable = second_byte == 0x1E || second_byte == 0x29;
+        break;
+    }
+    if(!translatable) break;
+    length++;
+    pc += INSTRUCTION_SIZE;
+    if(ends_with_branch) break;
+  }
+
+  if(length == 0) {
+    _mark_untranslatable(address);
+    return UNTRANSLATABLE;
+  }
+  if(!_writable) _make_writable();
+
+  /* Register the block first so that exits can chain back into it */
+  int32_t index = static_cast<int32_t>(_blocks.size());
+  Jit_Block block;
+  block.code = reinterpret_cast<Block_Function>(_buffer + _used);
+  block.start = address;
+  block.end = static_cast<uint16_t>(pc);
+  block.length = length;
+  _blocks.push_back(block);
+  _block_at[address] = index;
+  for(uint32_t i = address; i < pc; i++) {
+    _coverage[i]++;
+    _code[i] = 1;
+  }
+
+  /* Prologue - return to the dispatcher if the budget does not cover the block, otherwise take it */
+  _emit({0x81, 0x3A}); _emit_32(length);              /* cmp dword [rdx], length */
+  _emit({0x7D, EXIT_STUB_SIZE});                      /* jge .run */
+  _emit({0xB8}); _emit_32(address); _emit({0xC3});    /* mov eax, address; ret */
+  _emit({0x81, 0x2A}); _emit_32(length);              /* .run: sub dword [rdx], length */
+
+  pc = address;
+  for(uint16_t i = 0; i < length; i++, pc += INSTRUCTION_SIZE) {
+    uint8_t first_byte = chip_8._state.memory[pc];
+    uint8_t second_byte = chip_8._state.memory[pc + 1];
+    uint8_t opcode = first_byte >> NIBBLE_SIZE;
+    uint8_t x = first_byte & BACK_NIBBLE_MASK;
+    uint8_t y = second_byte >> NIBBLE_SIZE;
+    uint8_t n = second_byte & BACK_NIBBLE_MASK;
+    uint16_t nnn = (x << (NIBBLE_SIZE * 2)) | second_byte;
+    uint16_t next = pc + INSTRUCTION_SIZE;
+
+    switch(opcode) {
+      case 0x1:
+        _emit_exit(nnn);
+        break;
+
+      case 0x3:
+        _emit({0x80, 0x7F, x, second_byte});          /* cmp byte [rdi + x], nn */
+        _emit({0x75, EXIT_STUB_SIZE});                /* jne .no_skip */
+        _emit_exit(next + INSTRUCTION_SIZE);
+        _emit_exit(next);
+        break;
+
+      case 0x4:
+        _emit({0x80, 0x7F, x, second_byte});          /* cmp byte [rdi + x], nn */
+        _emit({0x74, EXIT_STUB_SIZE});                /* je .no_skip */
+        _emit_exit(next + INSTRUCTION_SIZE);
+        _emit_exit(next);
+        break;
+
+      case 0x5:
+      case 0x9:
+        _emit({0x8A, 0x47, x});                       /* mov al, [rdi + x] */
+        _emit({0x3A, 0x47, y});                       /* cmp al, [rdi + y] */
+        _emit({static_cast<uint8_t>(opcode == 0x5 ? 0x75 : 0x74), EXIT_STUB_SIZE});
+        _emit_exit(next + INSTRUCTION_SIZE);
+        _emit_exit(next);
+        break;
+
+      case 0x6:
+        _emit({0xC6, 0x47, x, second_byte});          /* mov byte [rdi + x], nn */
+        break;
+
+      case 0x7:
+        _emit({0x80, 0x47, x, second_byte});          /* add byte [rdi + x], nn */
+        break;
+
+      case 0x8:
+        switch(n) {
+          case 0x0:
+            _emit({0x8A, 0x47, y});                   /* mov al, [rdi + y] */
+            _emit({0x88, 0x47, x});                   /* mov [rdi + x], al */
+            break;
+
+          case 0x1:
+          case 0x2:
+          case 0x3:
+            {
+              /* or / and / xor [rdi + x], al */
+              const uint8_t operations[] = {0x08, 0x20, 0x30};
+              _emit({0x8A, 0x47, y});                 /* mov al, [rdi + y] */
+              _emit({operations[n - 1], 0x47, x});
+              if(chip_8._quirks & QUIRK_VFRESET) _emit({0xC6, 0x47, FLAG_REG, 0x00});
+            }
+            break;
+
+          case 0x4:
+            _emit({0x8A, 0x47, x});                   /* mov al, [rdi + x] */
+            _emit({0x02, 0x47, y});                   /* add al, [rdi + y] */
+            _emit({0x0F, 0x92, 0xC1});                /* setc cl */
+            _emit({0x88, 0x47, x});                   /* mov [rdi + x], al */
+            _emit({0x88, 0x4F, FLAG_REG});            /* mov [rdi + F], cl */
+            break;
+
+          case 0x5:
+          case 0x7:
+            {
+              /* 8XY5 computes vX - vY, 8XY7 computes vY - vX */
+              uint8_t minuend = n == 0x5 ? x : y;
+              uint8_t subtrahend = n == 0x5 ? y : x;
+              _emit({0x8A, 0x47, minuend});           /* mov al, [rdi + minuend] */
+              _emit({0x2A, 0x47, subtrahend});        /* sub al, [rdi + subtrahend] */
+              _emit({0x0F, 0x93, 0xC1});              /* setnc cl */
+              _emit({0x88, 0x47, x});                 /* mov [rdi + x], al */
+              _emit({0x88, 0x4F, FLAG_REG});          /* mov [rdi + F], cl */
+            }
+            break;
+
+          case 0x6:
+            _emit({0x8A, 0x47, (chip_8._quirks & QUIRK_SHIFTX) ? x : y});  /* mov al, [rdi + source] */
+            _emit({0x88, 0xC1});                      /* mov cl, al */
+            _emit({0x80, 0xE1, BIT_MASK});            /* and cl, 1 */
+            _emit({0xD0, 0xE8});                      /* shr al, 1 */
+            _emit({0x88, 0x47, x});                   /* mov [rdi + x], al */
+            _emit({0x88, 0x4F, FLAG_REG});            /* mov [rdi + F], cl */
+            break;
+
+          case 0xE:
+            _emit({0x8A, 0x47, (chip_8._quirks & QUIRK_SHIFTX) ? x : y});  /* mov al, [rdi + source] */
+            _emit({0x88, 0xC1});                      /* mov cl, al */
+            _emit({0xC0, 0xE9, BYTE_SIZE - 1});       /* shr cl, 7 */
+            _emit({0xD0, 0xE0});                      /* shl al, 1 */
+            _emit({0x88, 0x47, x});                   /* mov [rdi + x], al */
+            _emit({0x88, 0x4F, FLAG_REG});            /* mov [rdi + F], cl */
+            break;
+        }
+        break;
+
+      case 0xA:
+        _emit({0x66, 0xC7, 0x06}); _emit_16(nnn);     /* mov word [rsi], nnn */
+        break;
+
+      case 0xF:
+        if(second_byte == 0x1E) {
+          _emit({0x0F, 0xB6, 0x47, x});               /* movzx eax, byte [rdi + x] */
+          _emit({0x66, 0x01, 0x06});                  /* add [rsi], ax */
+          /* Only 4KB platforms are translated, so the range is always 0x1000 */
+          _emit({0x66, 0x81, 0x3E}); _emit_16(ADDRESS_RANGE);  /* cmp word [rsi], 0x1000 */
+          _emit({0x76, 0x04});                        /* jbe .in_range */
+          _emit({0xC6, 0x47, FLAG_REG, 0x01});        /* mov byte [rdi + F], 1 */
+        } else {
+          _emit({0x0F, 0xB6, 0x47, x});               /* movzx eax, byte [rdi + x] */
+          _emit({0x8D, 0x44, 0x80, FONT_ADDRESS});    /* lea eax, [rax + rax * 4 + 0x50] */
+          _emit({0x66, 0x89, 0x06});                  /* mov [rsi], ax */
+        }
+        break;
+    }
+  }
+
+  /* Fall through to the instruction after the block */
+  if(!ends_with_branch) _emit_exit(pc);
+
+  /* Chain the exits that were waiting for this block */
+  for(size_t stub : _pending[address]) _link(stub, index);
+  _pending[address].clear();
+
+  return index;
+}
+
+void Jit::_emit_exit(uint16_t target) {
+  size_t stub = _used;
+  _emit({0xB8}); _emit_32(target); _emit({0xC3});     /* mov eax, target; ret */
+  /* An exit past the end of memory goes back to the dispatcher, which interprets from there */
+  if(target >= MEMORY_SIZE) return;
+  if(_block_at[target] >= 0) {
+    _link(stub, _block_at[target]);
+  } else {
+    _pending[target].push_back(stub);
+  }
+}
+
+void Jit::_link(size_t stub, int32_t index) {
+  /* Replace mov eax, imm32 (5 bytes) with jmp rel32 (5 bytes) to the block entry */
+  uint8_t *code = reinterpret_cast<uint8_t *>(_blocks[index].code);
+  int32_t relative = static_cast<int32_t>(code - (_buffer + stub + 5));
+  _buffer[stub] = 0xE9;
+  memcpy(_buffer + stub + 1, &relative, sizeof(relative));
+  _blocks[index].incoming.push_back(stub);
+}
+
+void Jit::_unlink(size_t stub, uint16_t target) {
+  uint32_t value = target;
+  _buffer[stub] = 0xB8;
+  memcpy(_buffer + stub + 1, &value, sizeof(value));
+}
+
+void Jit::_emit(std::initializer_list<uint8_t> bytes) {
+  for(uint8_t byte : bytes) _buffer[_used++] = byte;
+}
+
+void Jit::_emit_16(uint16_t value) {
+  memcpy(_buffer + _used, &value, sizeof(value));
+  _used += sizeof(value);
+}
+
+void Jit::_emit_32(uint32_t value) {
+  memcpy(_buffer + _used, &value, sizeof(value));
+  _used += sizeof(value);
+}
\ No newline at end of file
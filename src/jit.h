@@ -0,0 +1,105 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include <initializer_list>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "machine_state.h"
+
+#if defined(__x86_64__) && defined(__linux__)
+#define JIT_SUPPORTED 1
+#else
+#define JIT_SUPPORTED 0
+#endif
+
+/* Size of the executable buffer holding all translated blocks */
+#define JIT_BUFFER_SIZE (1 << 20)
+/* Maximum number of instructions translated into one block */
+#define JIT_MAX_BLOCK_LENGTH 32
+/* Number of times a block can be invalidated before its address is left to the interpreter */
+#define JIT_MAX_INVALIDATIONS 8
+
+class Chip_8;
+
+/*
+  Native code of a basic block. Runs the block on the registers and index register if the budget
+  covers it, then continues into any chained block. Returns the program counter to continue from
+*/
+typedef uint32_t (*Block_Function)(uint8_t *vs, uint16_t *index_register, int32_t *budget);
+
+typedef struct Jit_Block {
+  /* Entry point of the native code, null once the block has been invalidated */
+  Block_Function code;
+  /* Guest addresses covered by the block, end is one past the last byte */
+  uint16_t start;
+  uint16_t end;
+  /* Number of guest instructions in the block */
+  uint16_t length;
+  /* Offsets of exit stubs in other blocks that have been chained to this block */
+  std::vector<size_t> incoming;
+} Jit_Block;
+
+/* Translates basic blocks of Chip 8 instructions into x86-64 code */
+class Jit {
+  public:
+    /* Constructor */
+    Jit();
+    /* Destructor */
+    ~Jit();
+    /* Check if the executable buffer could be created on this host */
+    bool is_available() const;
+    /* Run a number of cycles, using translated blocks wherever the budget covers them, returns the number run before halting */
+    uint32_t run(Chip_8 &chip_8, uint32_t count);
+    /* Invalidate the blocks covering the address after it has been written to, writes to data return at once */
+    void invalidate(uint16_t address) {
+      if(address < MEMORY_SIZE && _code[address]) _invalidate(address);
+    }
+    /* Drop every translated block */
+    void flush();
+    /* Translate the blocks starting at the addresses ahead of their first run */
+    void translate(const Chip_8 &chip_8, const std::vector<uint16_t> &addresses);
+    /* Get the addresses of the blocks currently translated */
+    std::vector<uint16_t> get_block_starts() const;
+  private:
+    /* Drop the blocks and untranslatable marks of the instructions containing the address */
+    void _invalidate(uint16_t address);
+    /* Mark the instruction at the address as left to the interpreter */
+    void _mark_untranslatable(uint16_t address);
+    /* Make the buffer writable to emit or patch code, or executable to run it, never both at once */
+    void _make_writable();
+    void _make_executable();
+    /* Translate the block starting at address, returns its index or UNTRANSLATABLE */
+    int32_t _compile(const Chip_8 &chip_8, uint16_t address);
+    /* Drop one block and unchain the blocks jumping into it */
+    void _invalidate_block(int32_t index);
+    /* Emit an exit to the target address, chained to its block if it has been translated */
+    void _emit_exit(uint16_t target);
+    /* Turn an exit stub into a jump to the block */
+    void _link(size_t stub, int32_t index);
+    /* Turn an exit stub back into a return of its target */
+    void _unlink(size_t stub, uint16_t target);
+    /* Append bytes to the buffer */
+    void _emit(std::initializer_list<uint8_t> bytes);
+    void _emit_16(uint16_t value);
+    void _emit_32(uint32_t value);
+    /* Executable buffer and how much of it is used */
+    uint8_t *_buffer;
+    size_t _used;
+    /* Set while the buffer is mapped writable rather than executable */
+    bool _writable;
+    /* Translated blocks, indexed by the values in _block_at */
+    std::vector<Jit_Block> _blocks;
+    /* Block starting at each address, NO_BLOCK or UNTRANSLATABLE */
+    std::vector<int32_t> _block_at;
+    /* Number of blocks covering each byte of memory */
+    std::vector<uint16_t> _coverage;
+    /* Set on the bytes of every instruction translated or marked untranslatable since the last flush */
+    std::vector<uint8_t> _code;
+    /* Number of times the block starting at each address was invalidated by a write */
+    std::vector<uint8_t> _invalidations;
+    /* Exit stubs waiting for a block at each address to be translated */
+    std::vector<std::vector<size_t>> _pending;
+};
+
+#endif
\ No newline at end of file
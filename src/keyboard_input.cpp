@@ -0,0 +1,22 @@
+#include "keyboard_input.h"
+
+void Keyboard_Input::handle_event(const sf::Event &event) {
+  if(const sf::Event::KeyPressed *key_pressed = event.getIf<sf::Event::KeyPressed>()) {
+    if(key_pressed->code == SAVE_STATE_KEY) _commands.push_back(Emulator_Command::SAVE_STATE);
+    if(key_pressed->code == LOAD_STATE_KEY) _commands.push_back(Emulator_Command::LOAD_STATE);
+    if(key_pressed->code == REWIND_KEY) _commands.push_back(Emulator_Command::START_REWIND);
+    std::unordered_map<sf::Keyboard::Key, uint8_t>::const_iterator mapping = keyboard_mapping.find(key_pressed->code);
+    if(mapping != keyboard_mapping.end()) push(mapping->second, true);
+  } else if(const sf::Event::KeyReleased *key_released = event.getIf<sf::Event::KeyReleased>()) {
+    if(key_released->code == REWIND_KEY) _commands.push_back(Emulator_Command::STOP_REWIND);
+    std::unordered_map<sf::Keyboard::Key, uint8_t>::const_iterator mapping = keyboard_mapping.find(key_released->code);
+    if(mapping != keyboard_mapping.end()) push(mapping->second, false);
+  }
+}
+
+bool Keyboard_Input::poll_command(Emulator_Command &command) {
+  if(_commands.empty()) return false;
+  command = _commands.front();
+  _commands.pop_front();
+  return true;
+}
\ No newline at end of file
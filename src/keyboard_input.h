@@ -0,0 +1,45 @@
+#ifndef KEYBOARD_INPUT_H
+#define KEYBOARD_INPUT_H
+
+#include <SFML/Window.hpp>
+#include <deque>
+#include <unordered_map>
+#include "emulation_thread.h"
+#include "input_source.h"
+
+const std::unordered_map<sf::Keyboard::Key, uint8_t> keyboard_mapping = {
+  {sf::Keyboard::Key::Num1, 0x1},
+  {sf::Keyboard::Key::Num2, 0x2},
+  {sf::Keyboard::Key::Num3, 0x3},
+  {sf::Keyboard::Key::Num4, 0xC},
+  {sf::Keyboard::Key::Q, 0x4},
+  {sf::Keyboard::Key::W, 0x5},
+  {sf::Keyboard::Key::E, 0x6},
+  {sf::Keyboard::Key::R, 0xD},
+  {sf::Keyboard::Key::A, 0x7},
+  {sf::Keyboard::Key::S, 0x8},
+  {sf::Keyboard::Key::D, 0x9},
+  {sf::Keyboard::Key::F, 0xE},
+  {sf::Keyboard::Key::Z, 0xA},
+  {sf::Keyboard::Key::X, 0x0},
+  {sf::Keyboard::Key::C, 0xB},
+  {sf::Keyboard::Key::V, 0xF}
+};
+
+/* Host keys for the emulator itself: F5 saves the state, F9 loads it and holding backspace rewinds */
+#define SAVE_STATE_KEY sf::Keyboard::Key::F5
+#define LOAD_STATE_KEY sf::Keyboard::Key::F9
+#define REWIND_KEY sf::Keyboard::Key::Backspace
+
+/* Input source turning SFML key presses and releases into Chip 8 key events */
+class Keyboard_Input : public Key_Event_Queue {
+  public:
+    /* Queue a key event if the SFML event is a press or release of a mapped key, or a command for a host key */
+    void handle_event(const sf::Event &event);
+    /* Take the oldest command from a host key, returns false if there is none */
+    bool poll_command(Emulator_Command &command);
+  private:
+    std::deque<Emulator_Command> _commands;
+};
+
+#endif
\ No newline at end of file
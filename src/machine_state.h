@@ -0,0 +1,122 @@
+#ifndef MACHINE_STATE_H
+#define MACHINE_STATE_H
+
+#include <cstring>
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+#include "framebuffer.h"
+
+/* Memory of the original platform and SUPER-CHIP */
+#define MEMORY_SIZE 0x1000
+/* Memory of XO-CHIP, the last field of every state so the other platforms copy only their 4KB of it */
+#define MAX_MEMORY_SIZE 0x10000
+/* ROMs are loaded from here up to the end of memory */
+#define PROGRAM_ADDRESS 0x200
+/* Largest ROM of any platform, the platform of the machine may allow less */
+#define MAX_ROM_SIZE (MAX_MEMORY_SIZE - PROGRAM_ADDRESS)
+
+#define NUMBER_OF_GENERAL_REGISTERS 16
+
+/* Number of return addresses the call stack holds, as on the original interpreter */
+#define STACK_DEPTH 16
+
+/* Flag registers FX75 and FX85 store and load, 8 on SUPER-CHIP and 16 on XO-CHIP */
+#define NUMBER_OF_FLAG_REGISTERS 16
+
+/* Bytes of the XO-CHIP audio pattern, 128 1-bit samples */
+#define AUDIO_PATTERN_SIZE 16
+/* Pitch register value playing the pattern at 4000 samples a second */
+#define DEFAULT_PITCH 64
+
+/* Machine a program is written for, each one runs the instructions of the ones before it */
+typedef enum Platform {
+  /* The original interpreter: 4KB of memory and a 64x32 display */
+  COSMAC_VIP,
+  /* Adds the 128x64 mode, scrolling, 16x16 sprites, the large font and flag registers */
+  SUPER_CHIP,
+  /* Adds 64KB of memory, bitplanes and a few register and memory instructions */
+  XO_CHIP
+} Platform;
+
+typedef enum Refresh_State {
+  FREE,
+  WAITING,
+  REFRESH_FINISHED
+} Refresh_State;
+
+/* Error that stopped the machine, the faulting instruction is held and faults again every cycle */
+typedef enum Machine_Fault {
+  NO_FAULT,
+  /* 2NNN with all stack levels in use */
+  STACK_OVERFLOW,
+  /* 00EE with an empty stack */
+  STACK_UNDERFLOW
+} Machine_Fault;
+
+/*
+  All guest visible state of one machine in one block of fixed arrays. It is trivially copyable, so a 
+  machine is snapshotted or cloned by copying the machine_state_size bytes of its platform with copy_state
+*/
+typedef struct Machine_State {
+  /* Display - 64x32 or 128x64 pixels in up to four planes */
+  Framebuffer display;
+  /* Planes drawn, cleared and scrolled, bit N is plane N */
+  uint8_t plane_mask;
+  uint8_t flag_registers[NUMBER_OF_FLAG_REGISTERS];
+  /* Samples played while the sound timer runs and the rate they are played at, set by XO-CHIP F002 and FX3A */
+  uint8_t audio_pattern[AUDIO_PATTERN_SIZE];
+  uint8_t pitch;
+  /* 16 8-bit general registers named v0 to vF */
+  uint8_t vs[NUMBER_OF_GENERAL_REGISTERS];
+  /* Return addresses, stack_pointer is the number in use */
+  uint16_t stack[STACK_DEPTH];
+  uint16_t program_counter;
+  uint16_t index_register;
+  uint8_t stack_pointer;
+  uint8_t delay_timer;
+  uint8_t sound_timer;
+  /* Key held down while FX0A waits for it to be released */
+  uint8_t curr_pressed_key;
+  /* Keypad, bit N is set while key N is pressed */
+  uint16_t keypad;
+  Refresh_State refresh_state;
+  Machine_Fault fault;
+  /* State of the random number generator */
+  uint64_t random_state;
+  /* Memory - 64KB, only the first 4KB are addressed unless the platform is XO-CHIP, and only those are copied */
+  uint8_t memory[MAX_MEMORY_SIZE];
+} Machine_State;
+
+static_assert(std::is_trivially_copyable<Machine_State>::value, "Machine_State has to be copyable as plain bytes");
+
+/* Bytes of memory a program on the platform can address */
+inline uint32_t platform_memory_size(Platform platform) {
+  return platform == Platform::XO_CHIP ? MAX_MEMORY_SIZE : MEMORY_SIZE;
+}
+
+/* Bytes of the state in use on the platform, everything up to the end of the memory it can address */
+inline size_t machine_state_size(Platform platform) {
+  return offsetof(Machine_State, memory) + platform_memory_size(platform);
+}
+
+/* Copy the part of the state in use on the platform, the rest of the destination is left as it was */
+inline void copy_state(Machine_State &destination, const Machine_State &source, Platform platform) {
+  std::memcpy(&destination, &source, machine_state_size(platform));
+}
+
+/* Start the random number generator from a seed */
+inline void seed_random_state(uint64_t &random_state, uint32_t seed) {
+  random_state = seed;
+}
+
+/* Next random byte, the top byte of a SplitMix64 step */
+inline uint8_t next_random_byte(uint64_t &random_state) {
+  random_state += 0x9E3779B97F4A7C15ULL;
+  uint64_t z = random_state;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return static_cast<uint8_t>((z ^ (z >> 31)) >> 56);
+}
+
+#endif
\ No newline at end of file
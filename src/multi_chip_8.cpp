@@ -0,0 +1,610 @@
+#include <algorithm>
+#include "hash.h"
+#include "multi_chip_8.h"
+
+#define ADDRESS_MASK (MEMORY_SIZE - 1)
+
+/* Mask of the lane, all ones when every lane in the range runs */
+template <bool MASKED>
+static inline uint8_t lane_mask(const uint8_t *mask, size_t lane) {
+  if constexpr(MASKED) {
+    return mask[lane];
+  } else {
+    (void)mask;
+    (void)lane;
+    return 0xFF;
+  }
+}
+
+/* Pick a where the mask is set and b where it is not, without branching so the loops vectorise */
+static inline uint8_t select_8(uint8_t mask, uint8_t a, uint8_t b) {
+  return (a & mask) | (b & ~mask);
+}
+
+static inline uint16_t select_16(uint8_t mask, uint16_t a, uint16_t b) {
+  uint16_t wide_mask = static_cast<uint16_t>(static_cast<int16_t>(static_cast<int8_t>(mask)));
+  return (a & wide_mask) | (b & ~wide_mask);
+}
+
+/* All ones if the condition holds */
+static inline uint8_t mask_if(bool condition) {
+  return -static_cast<uint8_t>(condition);
+}
+
+/* 
+  Runs an 8XY_ instruction on the lanes. The operation gives the result from vX and vY and sets the flag, 
+  which is only written where flag_mask is set. The flag is written last so it wins when X is F
+*/
+template <bool MASKED, typename Operation>
+static inline void alu_loop(size_t begin, size_t end, const uint8_t *mask, uint8_t *vx, const uint8_t *vy, 
+  uint8_t *vf, uint8_t flag_mask, Operation operation) {
+  for(size_t lane = begin; lane < end; lane++) {
+    uint8_t lane_bits = lane_mask<MASKED>(mask, lane);
+    uint8_t a = vx[lane];
+    uint8_t flag = 0;
+    uint8_t result = operation(a, vy[lane], flag);
+    vx[lane] = select_8(lane_bits, result, a);
+    vf[lane] = select_8(lane_bits & flag_mask, flag, vf[lane]);
+  }
+}
+
+Multi_Chip_8::Multi_Chip_8(const Arguments &args, size_t lanes) : _lanes(lanes) {
+  _quirks = get_quirks(args);
+  _file_name = args.file_name;
+
+  /* Memory holds the font until a ROM is loaded */
+  _image = std::vector<uint8_t>(MEMORY_SIZE, 0);
+  std::copy(font.begin(), font.end(), _image.begin() + FONT_ADDRESS);
+  _written = std::vector<uint8_t>(MEMORY_SIZE, 0);
+  _memory = std::vector<uint8_t>(_lanes * MEMORY_SIZE);
+  for(size_t lane = 0; lane < _lanes; lane++) {
+    std::copy(_image.begin(), _image.end(), _memory.begin() + lane * MEMORY_SIZE);
+  }
+
+  _vs = std::vector<uint8_t>(NUMBER_OF_GENERAL_REGISTERS * _lanes, 0);
+  _index_register = std::vector<uint16_t>(_lanes, 0);
+  _program_counter = std::vector<uint16_t>(_lanes, PROGRAM_ADDRESS);
+  _delay_timer = std::vector<uint8_t>(_lanes, 0);
+  _sound_timer = std::vector<uint8_t>(_lanes, 0);
+  _stack = std::vector<uint16_t>(STACK_DEPTH * _lanes, 0);
+  _stack_pointer = std::vector<uint8_t>(_lanes, 0);
+  _fault = std::vector<uint8_t>(_lanes, Machine_Fault::NO_FAULT);
+
+  Lores_Framebuffer blank;
+  blank.fill(0);
+  _display = std::vector<Lores_Framebuffer>(_lanes, blank);
+  _keypad = std::vector<uint16_t>(_lanes, 0);
+  _curr_pressed_key = std::vector<uint8_t>(_lanes, NO_KEY);
+  _refresh_state = std::vector<uint8_t>(_lanes, Refresh_State::FREE);
+
+  _random_state = std::vector<uint64_t>(_lanes);
+  for(size_t lane = 0; lane < _lanes; lane++) {
+    seed_random_state(_random_state[lane], lane);
+  }
+
+  _opcodes = std::vector<uint32_t>(_lanes, 0);
+  _mask = std::vector<uint8_t>(_lanes, 0);
+  _cycle_count = 0;
+  _group_count = 0;
+}
+
+bool Multi_Chip_8::load_ROM() {
+  std::vector<uint8_t> rom;
+  if(!read_rom_file(_file_name, rom) || rom.size() > MEMORY_SIZE - PROGRAM_ADDRESS) return false;
+  std::copy(rom.begin(), rom.end(), _image.begin() + PROGRAM_ADDRESS);
+
+  for(size_t lane = 0; lane < _lanes; lane++) {
+    std::copy(_image.begin(), _image.end(), _memory.begin() + lane * MEMORY_SIZE);
+  }
+  std::fill(_written.begin(), _written.end(), 0);
+  return true;
+}
+
+void Multi_Chip_8::seed_random(size_t lane, uint32_t seed) {
+  seed_random_state(_random_state[lane], seed);
+}
+
+void Multi_Chip_8::set_key(size_t lane, uint8_t key, bool pressed) {
+  if(key >= NUMBER_OF_KEYS) return;
+  if(pressed) {
+    _keypad[lane] |= 1 << key;
+  } else {
+    _keypad[lane] &= ~(1 << key);
+  }
+}
+
+void Multi_Chip_8::run_cycles(uint32_t count) {
+  for(uint32_t i = 0; i < count; i++) {
+    _run_cycle();
+  }
+}
+
+const std::vector<Lores_Framebuffer> &Multi_Chip_8::run_frame(uint32_t cycles) {
+  run_cycles(cycles);
+  for(size_t lane = 0; lane < _lanes; lane++) {
+    _delay_timer[lane] -= _delay_timer[lane] > 0;
+    _sound_timer[lane] -= _sound_timer[lane] > 0;
+  }
+  if(_quirks & QUIRK_DW) {
+    for(size_t lane = 0; lane < _lanes; lane++) {
+      if(_refresh_state[lane] == Refresh_State::WAITING) _refresh_state[lane] = Refresh_State::REFRESH_FINISHED;
+    }
+  }
+  return _display;
+}
+
+const std::vector<Lores_Framebuffer> &Multi_Chip_8::get_data() const {
+  return _display;
+}
+
+uint64_t Multi_Chip_8::get_display_hash(size_t lane) const {
+  return fnv1a_64(_display[lane].data(), sizeof(Lores_Framebuffer));
+}
+
+/* Hashes the lane in the same order as Chip_8::get_state_hash, the stack from the top down */
+uint64_t Multi_Chip_8::get_state_hash(size_t lane) const {
+  uint64_t hash = fnv1a_64(&_memory[lane * MEMORY_SIZE], MEMORY_SIZE);
+  hash = fnv1a_64(_display[lane].data(), sizeof(Lores_Framebuffer), hash);
+  for(uint8_t i = 0; i < NUMBER_OF_GENERAL_REGISTERS; i++) {
+    hash = fnv1a_64(&_vs[i * _lanes + lane], 1, hash);
+  }
+  hash = fnv1a_64(&_program_counter[lane], sizeof(uint16_t), hash);
+  hash = fnv1a_64(&_index_register[lane], sizeof(uint16_t), hash);
+  hash = fnv1a_64(&_delay_timer[lane], sizeof(uint8_t), hash);
+  hash = fnv1a_64(&_sound_timer[lane], sizeof(uint8_t), hash);
+  for(uint8_t level = _stack_pointer[lane]; level > 0; level--) {
+    hash = fnv1a_64(&_stack[(level - 1) * _lanes + lane], sizeof(uint16_t), hash);
+  }
+  return hash;
+}
+
+Machine_Fault Multi_Chip_8::get_fault(size_t lane) const {
+  return static_cast<Machine_Fault>(_fault[lane]);
+}
+
+size_t Multi_Chip_8::get_lane_count() const {
+  return _lanes;
+}
+
+uint64_t Multi_Chip_8::get_cycle_count() const {
+  return _cycle_count;
+}
+
+uint64_t Multi_Chip_8::get_group_count() const {
+  return _group_count;
+}
+
+/* 
+  Runs every lane together if they fetched the same opcode. Otherwise takes the opcode of the first
+  lane not run yet, masks in every lane that fetched it and runs them as one group, until every lane 
+  has run. Small groups, and everything left after a few groups, run one lane at a time as masking 
+  costs a pass over all lanes
+*/
+void Multi_Chip_8::_run_cycle() {
+  _cycle_count++;
+  uint32_t opcode;
+  if(_fetch(opcode)) {
+    _group_count++;
+    _execute<false>(opcode, 0, _lanes);
+    return;
+  }
+
+  size_t remaining = _lanes;
+  size_t next = 0;
+  uint32_t groups = 0;
+  while(remaining > 0) {
+    while(_opcodes[next] == MULTI_LANE_DONE) next++;
+
+    if(groups == MULTI_MAX_MASKED_GROUPS) {
+      for(size_t lane = next; lane < _lanes; lane++) {
+        if(_opcodes[lane] == MULTI_LANE_DONE) continue;
+        _group_count++;
+        _execute<false>(_opcodes[lane], lane, lane + 1);
+      }
+      return;
+    }
+
+    opcode = _opcodes[next];
+    size_t count = 0;
+    for(size_t lane = next; lane < _lanes; lane++) {
+      uint8_t mask = mask_if(_opcodes[lane] == opcode);
+      _mask[lane] = mask;
+      count += mask & 1;
+      _opcodes[lane] = _opcodes[lane] == opcode ? MULTI_LANE_DONE : _opcodes[lane];
+    }
+    remaining -= count;
+    groups++;
+    _group_count++;
+
+    if(count * MULTI_MASKED_GROUP_FRACTION >= _lanes) {
+      _execute<true>(opcode, next, _lanes);
+    } else {
+      for(size_t lane = next; lane < _lanes; lane++) {
+        if(_mask[lane]) _execute<false>(opcode, lane, lane + 1);
+      }
+    }
+  }
+}
+
+/* 
+  Lanes at the same program counter fetch the ROM image unless some lane wrote to the instruction, 
+  so the common case compares program counters without touching each lane's memory
+*/
+bool Multi_Chip_8::_fetch(uint32_t &opcode) {
+  uint16_t first_pc = _program_counter[0];
+  uint16_t difference = 0;
+  for(size_t lane = 0; lane < _lanes; lane++) {
+    difference |= _program_counter[lane] ^ first_pc;
+  }
+  uint16_t address = first_pc & ADDRESS_MASK;
+  uint16_t next_address = (first_pc + 1) & ADDRESS_MASK;
+  if(!difference && !_written[address] && !_written[next_address]) {
+    opcode = (_image[address] << BYTE_SIZE) | _image[next_address];
+    return true;
+  }
+
+  for(size_t lane = 0; lane < _lanes; lane++) {
+    const uint8_t *memory = &_memory[lane * MEMORY_SIZE];
+    uint16_t pc = _program_counter[lane];
+    _opcodes[lane] = (memory[pc & ADDRESS_MASK] << BYTE_SIZE) | memory[(pc + 1) & ADDRESS_MASK];
+  }
+  uint32_t first_opcode = _opcodes[0];
+  uint32_t opcode_difference = 0;
+  for(size_t lane = 0; lane < _lanes; lane++) {
+    opcode_difference |= _opcodes[lane] ^ first_opcode;
+  }
+  opcode = first_opcode;
+  return !opcode_difference;
+}
+
+void Multi_Chip_8::_write_memory(size_t lane, uint16_t address, uint8_t value) {
+  address &= ADDRESS_MASK;
+  _memory[lane * MEMORY_SIZE + address] = value;
+  _written[address] = 1;
+}
+
+/*
+  Each case loops over the lanes once. Register updates are written as selects between the new and 
+  old value so masked groups vectorise as well as full ones, instructions touching memory, the stack 
+  or the display loop over the lanes in the group one at a time
+*/
+template <bool MASKED>
+void Multi_Chip_8::_execute(uint16_t opcode, size_t begin, size_t end) {
+  uint8_t x = (opcode >> (NIBBLE_SIZE * 2)) & BACK_NIBBLE_MASK;
+  uint8_t y = (opcode >> NIBBLE_SIZE) & BACK_NIBBLE_MASK;
+  uint8_t n = opcode & BACK_NIBBLE_MASK;
+  uint8_t nn = opcode & 0xFF;
+  uint16_t nnn = opcode & 0xFFF;
+
+  const uint8_t *mask = _mask.data();
+  uint8_t *vx = &_vs[x * _lanes];
+  uint8_t *vy = &_vs[y * _lanes];
+  uint8_t *vf = &_vs[FLAG_REG * _lanes];
+  uint16_t *pc = _program_counter.data();
+  uint16_t *index_register = _index_register.data();
+
+  /* Every lane moves past the instruction, waits and skips adjust it afterwards */
+  for(size_t lane = begin; lane < end; lane++) {
+    pc[lane] = select_16(lane_mask<MASKED>(mask, lane), pc[lane] + INSTRUCTION_SIZE, pc[lane]);
+  }
+
+  switch(opcode >> (NIBBLE_SIZE * 3)) {
+    case 0x0:
+      if(nn == 0xEE) {
+        /* 00EE - Return from subroutine, holding the return on an empty stack */
+        for(size_t lane = begin; lane < end; lane++) {
+          if(!lane_mask<MASKED>(mask, lane)) continue;
+          if(_stack_pointer[lane] == 0) {
+            _fault[lane] = Machine_Fault::STACK_UNDERFLOW;
+            pc[lane] -= INSTRUCTION_SIZE;
+            continue;
+          }
+          _stack_pointer[lane]--;
+          pc[lane] = _stack[_stack_pointer[lane] * _lanes + lane];
+        }
+      } else if(nn == 0xE0) {
+        /* 00E0 - Clear screen */
+        for(size_t lane = begin; lane < end; lane++) {
+          if(lane_mask<MASKED>(mask, lane)) _display[lane].fill(0);
+        }
+      }
+      break;
+
+    case 0x1:
+      /* 1NNN - Jump to NNN */
+      for(size_t lane = begin; lane < end; lane++) {
+        pc[lane] = select_16(lane_mask<MASKED>(mask, lane), nnn, pc[lane]);
+      }
+      break;
+
+    case 0x2:
+      /* 2NNN - Call subroutine at NNN, holding the call on a full stack */
+      for(size_t lane = begin; lane < end; lane++) {
+        if(!lane_mask<MASKED>(mask, lane)) continue;
+        if(_stack_pointer[lane] == STACK_DEPTH) {
+          _fault[lane] = Machine_Fault::STACK_OVERFLOW;
+          pc[lane] -= INSTRUCTION_SIZE;
+          continue;
+        }
+        _stack[_stack_pointer[lane] * _lanes + lane] = pc[lane];
+        _stack_pointer[lane]++;
+        pc[lane] = nnn;
+      }
+      break;
+
+    case 0x3:
+      /* 3XNN - Skip if vX == NN */
+      for(size_t lane = begin; lane < end; lane++) {
+        uint8_t skip = lane_mask<MASKED>(mask, lane) & mask_if(vx[lane] == nn);
+        pc[lane] = select_16(skip, pc[lane] + INSTRUCTION_SIZE, pc[lane]);
+      }
+      break;
+
+    case 0x4:
+      /* 4XNN - Skip if vX != NN */
+      for(size_t lane = begin; lane < end; lane++) {
+        uint8_t skip = lane_mask<MASKED>(mask, lane) & mask_if(vx[lane] != nn);
+        pc[lane] = select_16(skip, pc[lane] + INSTRUCTION_SIZE, pc[lane]);
+      }
+      break;
+
+    case 0x5:
+      /* 5XY0 - Skip if vX == vY */
+      for(size_t lane = begin; lane < end; lane++) {
+        uint8_t skip = lane_mask<MASKED>(mask, lane) & mask_if(vx[lane] == vy[lane]);
+        pc[lane] = select_16(skip, pc[lane] + INSTRUCTION_SIZE, pc[lane]);
+      }
+      break;
+
+    case 0x6:
+      /* 6XNN - vX = NN */
+      for(size_t lane = begin; lane < end; lane++) {
+        vx[lane] = select_8(lane_mask<MASKED>(mask, lane), nn, vx[lane]);
+      }
+      break;
+
+    case 0x7:
+      /* 7XNN - vX += NN */
+      for(size_t lane = begin; lane < end; lane++) {
+        vx[lane] = select_8(lane_mask<MASKED>(mask, lane), vx[lane] + nn, vx[lane]);
+      }
+      break;
+
+    case 0x8:
+      {
+        uint8_t reset_flag = mask_if(_quirks & QUIRK_VFRESET);
+        bool shiftx = _quirks & QUIRK_SHIFTX;
+        switch(n) {
+          case 0x0:
+            /* 8XY0 - vX = vY */
+            alu_loop<MASKED>(begin, end, mask, vx, vy, vf, 0, [](uint8_t, uint8_t b, uint8_t &) { return b; });
+            break;
+          case 0x1:
+            /* 8XY1 - vX |= vY, vF reset with the quirk */
+            alu_loop<MASKED>(begin, end, mask, vx, vy, vf, reset_flag, [](uint8_t a, uint8_t b, uint8_t &flag) {
+              flag = 0;
+              return static_cast<uint8_t>(a | b);
+            });
+            break;
+          case 0x2:
+            /* 8XY2 - vX &= vY, vF reset with the quirk */
+            alu_loop<MASKED>(begin, end, mask, vx, vy, vf, reset_flag, [](uint8_t a, uint8_t b, uint8_t &flag) {
+              flag = 0;
+              return static_cast<uint8_t>(a & b);
+            });
+            break;
+          case 0x3:
+            /* 8XY3 - vX ^= vY, vF reset with the quirk */
+            alu_loop<MASKED>(begin, end, mask, vx, vy, vf, reset_flag, [](uint8_t a, uint8_t b, uint8_t &flag) {
+              flag = 0;
+              return static_cast<uint8_t>(a ^ b);
+            });
+            break;
+          case 0x4:
+            /* 8XY4 - vX += vY, vF = carry */
+            alu_loop<MASKED>(begin, end, mask, vx, vy, vf, 0xFF, [](uint8_t a, uint8_t b, uint8_t &flag) {
+              uint8_t result = a + b;
+              flag = result < a;
+              return result;
+            });
+            break;
+          case 0x5:
+            /* 8XY5 - vX -= vY, vF = no borrow */
+            alu_loop<MASKED>(begin, end, mask, vx, vy, vf, 0xFF, [](uint8_t a, uint8_t b, uint8_t &flag) {
+              flag = a >= b;
+              return static_cast<uint8_t>(a - b);
+            });
+            break;
+          case 0x6:
+            /* 8XY6 - vX = vY >> 1, or vX >> 1 with the shift quirk, vF = bit shifted out */
+            alu_loop<MASKED>(begin, end, mask, vx, vy, vf, 0xFF, [shiftx](uint8_t a, uint8_t b, uint8_t &flag) {
+              uint8_t source = shiftx ? a : b;
+              flag = source & BIT_MASK;
+              return static_cast<uint8_t>(source >> 1);
+            });
+            break;
+          case 0x7:
+            /* 8XY7 - vX = vY - vX, vF = no borrow */
+            alu_loop<MASKED>(begin, end, mask, vx, vy, vf, 0xFF, [](uint8_t a, uint8_t b, uint8_t &flag) {
+              flag = b >= a;
+              return static_cast<uint8_t>(b - a);
+            });
+            break;
+          case 0xE:
+            /* 8XYE - vX = vY << 1, or vX << 1 with the shift quirk, vF = bit shifted out */
+            alu_loop<MASKED>(begin, end, mask, vx, vy, vf, 0xFF, [shiftx](uint8_t a, uint8_t b, uint8_t &flag) {
+              uint8_t source = shiftx ? a : b;
+              flag = source >> (BYTE_SIZE - 1);
+              return static_cast<uint8_t>(source << 1);
+            });
+            break;
+        }
+      }
+      break;
+
+    case 0x9:
+      /* 9XY0 - Skip if vX != vY */
+      for(size_t lane = begin; lane < end; lane++) {
+        uint8_t skip = lane_mask<MASKED>(mask, lane) & mask_if(vx[lane] != vy[lane]);
+        pc[lane] = select_16(skip, pc[lane] + INSTRUCTION_SIZE, pc[lane]);
+      }
+      break;
+
+    case 0xA:
+      /* ANNN - Set the index register to NNN */
+      for(size_t lane = begin; lane < end; lane++) {
+        index_register[lane] = select_16(lane_mask<MASKED>(mask, lane), nnn, index_register[lane]);
+      }
+      break;
+
+    case 0xB:
+      {
+        /* BNNN - Jump to NNN plus v0, or vX with the jump quirk */
+        const uint8_t *offset = (_quirks & QUIRK_JUMPX) ? vx : _vs.data();
+        for(size_t lane = begin; lane < end; lane++) {
+          pc[lane] = select_16(lane_mask<MASKED>(mask, lane), nnn + offset[lane], pc[lane]);
+        }
+      }
+      break;
+
+    case 0xC:
+      /* CXNN - vX = random byte AND NN */
+      for(size_t lane = begin; lane < end; lane++) {
+        if(!lane_mask<MASKED>(mask, lane)) continue;
+        vx[lane] = next_random_byte(_random_state[lane]) & nn;
+      }
+      break;
+
+    case 0xD:
+      /* DXYN - Draw an N tall sprite at (vX, vY), waiting for the vertical blank with the display wait quirk */
+      for(size_t lane = begin; lane < end; lane++) {
+        if(!lane_mask<MASKED>(mask, lane)) continue;
+        if(_quirks & QUIRK_DW) {
+          if(_refresh_state[lane] != Refresh_State::REFRESH_FINISHED) {
+            _refresh_state[lane] = Refresh_State::WAITING;
+            pc[lane] -= INSTRUCTION_SIZE;
+            continue;
+          }
+          _refresh_state[lane] = Refresh_State::FREE;
+        }
+
+        const uint8_t *memory = &_memory[lane * MEMORY_SIZE];
+        uint8_t sprite[BACK_NIBBLE_MASK + 1];
+        for(uint8_t i = 0; i < n; i++) {
+          sprite[i] = memory[(index_register[lane] + i) & ADDRESS_MASK];
+        }
+        uint64_t dirty_rows = 0;
+        bool collision = blit_sprite(_display[lane], vx[lane], vy[lane], sprite, n, 
+          _quirks & QUIRK_CLIP, dirty_rows);
+        vf[lane] = collision ? 1 : 0;
+      }
+      break;
+
+    case 0xE:
+      if(nn == 0x9E || nn == 0xA1) {
+        /* EX9E, EXA1 - Skip if the key in vX is pressed, or not pressed */
+        uint8_t skip_if_pressed = mask_if(nn == 0x9E);
+        for(size_t lane = begin; lane < end; lane++) {
+          uint8_t key = vx[lane];
+          uint8_t pressed = mask_if(key < NUMBER_OF_KEYS && ((_keypad[lane] >> (key & BACK_NIBBLE_MASK)) & 1));
+          uint8_t skip = lane_mask<MASKED>(mask, lane) & ~(pressed ^ skip_if_pressed);
+          pc[lane] = select_16(skip, pc[lane] + INSTRUCTION_SIZE, pc[lane]);
+        }
+      }
+      break;
+
+    case 0xF:
+      switch(nn) {
+        case 0x0A:
+          /* FX0A - Hold until a key is pressed and released, then set vX to it */
+          for(size_t lane = begin; lane < end; lane++) {
+            if(!lane_mask<MASKED>(mask, lane)) continue;
+            uint16_t keypad = _keypad[lane];
+            if(_curr_pressed_key[lane] == NO_KEY) {
+              if(keypad) _curr_pressed_key[lane] = __builtin_ctz(keypad);
+              pc[lane] -= INSTRUCTION_SIZE;
+            } else if(keypad & (1 << _curr_pressed_key[lane])) {
+              pc[lane] -= INSTRUCTION_SIZE;
+            } else {
+              vx[lane] = _curr_pressed_key[lane];
+              _curr_pressed_key[lane] = NO_KEY;
+            }
+          }
+          break;
+
+        case 0x07:
+          /* FX07 - vX = delay timer */
+          for(size_t lane = begin; lane < end; lane++) {
+            vx[lane] = select_8(lane_mask<MASKED>(mask, lane), _delay_timer[lane], vx[lane]);
+          }
+          break;
+
+        case 0x15:
+          /* FX15 - delay timer = vX */
+          for(size_t lane = begin; lane < end; lane++) {
+            _delay_timer[lane] = select_8(lane_mask<MASKED>(mask, lane), vx[lane], _delay_timer[lane]);
+          }
+          break;
+
+        case 0x18:
+          /* FX18 - sound timer = vX */
+          for(size_t lane = begin; lane < end; lane++) {
+            _sound_timer[lane] = select_8(lane_mask<MASKED>(mask, lane), vx[lane], _sound_timer[lane]);
+          }
+          break;
+
+        case 0x1E:
+          /* FX1E - Add vX to the index register, setting vF if it goes past the address range */
+          for(size_t lane = begin; lane < end; lane++) {
+            uint8_t lane_bits = lane_mask<MASKED>(mask, lane);
+            uint16_t sum = index_register[lane] + vx[lane];
+            index_register[lane] = select_16(lane_bits, sum, index_register[lane]);
+            vf[lane] = select_8(lane_bits & mask_if(sum > ADDRESS_RANGE), 1, vf[lane]);
+          }
+          break;
+
+        case 0x29:
+          /* FX29 - Point the index register at the font character in vX */
+          for(size_t lane = begin; lane < end; lane++) {
+            index_register[lane] = select_16(lane_mask<MASKED>(mask, lane), 
+              FONT_ADDRESS + vx[lane] * FONT_SIZE, index_register[lane]);
+          }
+          break;
+
+        case 0x33:
+          /* FX33 - Store the decimal digits of vX at the index register */
+          for(size_t lane = begin; lane < end; lane++) {
+            if(!lane_mask<MASKED>(mask, lane)) continue;
+            uint8_t value = vx[lane];
+            _write_memory(lane, index_register[lane], value / 100);
+            _write_memory(lane, index_register[lane] + 1, (value / 10) % 10);
+            _write_memory(lane, index_register[lane] + 2, value % 10);
+          }
+          break;
+
+        case 0x55:
+          /* FX55 - Store v0 to vX at the index register */
+          for(size_t lane = begin; lane < end; lane++) {
+            if(!lane_mask<MASKED>(mask, lane)) continue;
+            for(uint8_t i = 0; i <= x; i++) {
+              _write_memory(lane, index_register[lane] + i, _vs[i * _lanes + lane]);
+            }
+            if(_quirks & QUIRK_MEMINC) index_register[lane] += x + 1;
+          }
+          break;
+
+        case 0x65:
+          /* FX65 - Load v0 to vX from the index register */
+          for(size_t lane = begin; lane < end; lane++) {
+            if(!lane_mask<MASKED>(mask, lane)) continue;
+            const uint8_t *memory = &_memory[lane * MEMORY_SIZE];
+            for(uint8_t i = 0; i <= x; i++) {
+              _vs[i * _lanes + lane] = memory[(index_register[lane] + i) & ADDRESS_MASK];
+            }
+            if(_quirks & QUIRK_MEMINC) index_register[lane] += x + 1;
+          }
+          break;
+      }
+      break;
+  }
+}
\ No newline at end of file
@@ -0,0 +1,95 @@
+#ifndef MULTI_CHIP_8_H
+#define MULTI_CHIP_8_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "chip_8.h"
+#include "framebuffer.h"
+
+/* Most groups of diverged lanes run masked in one cycle, the lanes left after that run one at a time */
+#define MULTI_MAX_MASKED_GROUPS 4
+/* Groups with fewer than 1 in this many lanes run one lane at a time instead of masked */
+#define MULTI_MASKED_GROUP_FRACTION 8
+/* Opcode of a lane whose instruction has already run this cycle */
+#define MULTI_LANE_DONE 0x10000
+
+/*
+  Runs many Chip 8 machines on the same ROM in lockstep. Registers, timers and stacks are held as 
+  structure of arrays, one array per register with an element per lane, so an instruction runs over 
+  all lanes in loops the compiler can vectorise. Lanes fetching the same opcode run together, lanes 
+  that diverge are split into groups run under a mask, and merge again once they fetch the same opcode.
+  Only the original platform is run. Each lane gives the same results as a Chip_8 with the switch dispatch 
+  seeded the same way
+*/
+class Multi_Chip_8 {
+  public:
+    /* Constructor, lane N starts with its random generator seeded with N */
+    Multi_Chip_8(const Arguments &args, size_t lanes);
+    /* Load the ROM into the memory of every lane */
+    bool load_ROM();
+    /* Reseed the random number generator of one lane */
+    void seed_random(size_t lane, uint32_t seed);
+    /* Set or clear a key of one lane */
+    void set_key(size_t lane, uint8_t key, bool pressed);
+    /* Run a number of cycles on every lane */
+    void run_cycles(uint32_t count);
+    /* Run the cycles of one frame on every lane, then the 60Hz timer and refresh updates. Returns the displays */
+    const std::vector<Lores_Framebuffer> &run_frame(uint32_t cycles);
+    /* Get the display of every lane */
+    const std::vector<Lores_Framebuffer> &get_data() const;
+    /* Hash of the display of one lane, the same as Chip_8::get_display_hash */
+    uint64_t get_display_hash(size_t lane) const;
+    /* Hash of everything a program on one lane can observe, the same as Chip_8::get_state_hash */
+    uint64_t get_state_hash(size_t lane) const;
+    /* Error that stopped one lane, NO_FAULT while it is running */
+    Machine_Fault get_fault(size_t lane) const;
+    size_t get_lane_count() const;
+    /* Number of cycles run so far */
+    uint64_t get_cycle_count() const;
+    /* Number of groups of lanes run so far, equal to the cycle count while no lanes have diverged */
+    uint64_t get_group_count() const;
+  private:
+    /* Run one instruction on every lane */
+    void _run_cycle();
+    /* Fetch the opcode of every lane, returns true and the opcode if every lane fetched the same one */
+    bool _fetch(uint32_t &opcode);
+    /* Run the opcode on the lanes in [begin, end), only those set in _mask if MASKED */
+    template <bool MASKED>
+    void _execute(uint16_t opcode, size_t begin, size_t end);
+    /* Write a byte of one lane's memory, marking the address as no longer holding the ROM */
+    void _write_memory(size_t lane, uint16_t address, uint8_t value);
+    size_t _lanes;
+    uint8_t _quirks;
+    std::string _file_name;
+    /* Memory as loaded, shared by every lane until a lane writes to an address */
+    std::vector<uint8_t> _image;
+    /* Addresses written to by any lane, fetches from them have to read every lane's memory */
+    std::vector<uint8_t> _written;
+    /* MEMORY_SIZE bytes per lane, one lane after another */
+    std::vector<uint8_t> _memory;
+    /* Register N of lane L is at N * lanes + L */
+    std::vector<uint8_t> _vs;
+    std::vector<uint16_t> _index_register;
+    std::vector<uint16_t> _program_counter;
+    std::vector<uint8_t> _delay_timer;
+    std::vector<uint8_t> _sound_timer;
+    /* Level N of lane L is at N * lanes + L */
+    std::vector<uint16_t> _stack;
+    std::vector<uint8_t> _stack_pointer;
+    std::vector<uint8_t> _fault;
+    std::vector<Lores_Framebuffer> _display;
+    std::vector<uint16_t> _keypad;
+    std::vector<uint8_t> _curr_pressed_key;
+    std::vector<uint8_t> _refresh_state;
+    std::vector<uint64_t> _random_state;
+    /* Opcode fetched by each lane this cycle, MULTI_LANE_DONE once it has run */
+    std::vector<uint32_t> _opcodes;
+    /* 0xFF for the lanes in the group being run, 0 otherwise */
+    std::vector<uint8_t> _mask;
+    uint64_t _cycle_count;
+    uint64_t _group_count;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,154 @@
+#include <iostream>
+#include "options.h"
+
+void add_quirk_options(boost::program_options::options_description &description) {
+  description.add_options()
+    ("profile", boost::program_options::value<std::string>(), 
+      "Run as a platform: vip, schip or xochip (default: vip), starting from its quirks. The flags below are applied on top")
+    ("dw", "Sets display waiting to off (default: on)")
+    ("vfreset", "AND, OR, XOR reset flag register to 0 to off (default: on)")
+    ("meminc", "Increments index register when loading from and storing to memory to off (default: on)")
+    ("noclip", "Clip sprite at edge of screen to off (default: on)")
+    ("shiftx", "Shift operations will only affect register x to on (default: off)")
+    ("jumpx", "Jumps will use register x to on (default: off)");
+}
+
+void add_execution_options(boost::program_options::options_description &description) {
+  description.add_options()
+    ("dispatch", boost::program_options::value<std::string>()->default_value("threaded"),
+      "Instruction dispatch: threaded (predecoded instruction cache), switch or jit (x86-64 block translation)")
+    ("seed", boost::program_options::value<uint32_t>(), "Seed of the random number generator used by CXNN, so runs can be repeated");
+}
+
+void add_run_length_options(boost::program_options::options_description &description) {
+  description.add_options()
+    ("cycles", boost::program_options::value<uint64_t>(), "Run the ROM for this many cycles")
+    ("frames", boost::program_options::value<uint64_t>(), "Run the ROM for this many 60Hz frames")
+    ("cycles-per-frame", boost::program_options::value<uint32_t>()->default_value(DEFAULT_CYCLES_PER_FRAME),
+      "Number of cycles run between two timer ticks");
+}
+
+void add_capture_options(boost::program_options::options_description &description) {
+  description.add_options()
+    ("capture", boost::program_options::value<std::string>(), 
+      "Record the display of every frame to this file or named pipe, or to files starting with this path for ppm")
+    ("capture-format", boost::program_options::value<std::string>()->default_value("y4m"),
+      "y4m (128x64 video), rgba (raw 128x64 RGBA frames) or ppm (one image per frame)");
+}
+
+Arguments default_arguments() {
+  Arguments args{"", false, false, false, false, false, false, Platform::COSMAC_VIP, Dispatch_Mode::THREADED, {}};
+  set_quirks(args, QUIRK_PROFILE_VIP);
+  return args;
+}
+
+bool has_quirk_options(const boost::program_options::variables_map &variables_map) {
+  for(const char *option : {"profile", "dw", "vfreset", "meminc", "noclip", "shiftx", "jumpx"}) {
+    if(variables_map.count(option)) return true;
+  }
+  return false;
+}
+
+bool apply_quirk_options(const boost::program_options::variables_map &variables_map, Arguments &args) {
+  if(variables_map.count("profile")) {
+    std::string profile = variables_map["profile"].as<std::string>();
+    if(profile == "vip") {
+      set_quirks(args, QUIRK_PROFILE_VIP);
+      args.platform = Platform::COSMAC_VIP;
+    } else if(profile == "schip") {
+      set_quirks(args, QUIRK_PROFILE_SCHIP);
+      args.platform = Platform::SUPER_CHIP;
+    } else if(profile == "xochip") {
+      set_quirks(args, QUIRK_PROFILE_XOCHIP);
+      args.platform = Platform::XO_CHIP;
+    } else {
+      std::cout << "Unknown profile " << profile << ", use vip, schip or xochip" << std::endl;
+      return false;
+    }
+  }
+
+  if(variables_map.count("dw")) {
+    args.dw = false;
+  }
+
+  if(variables_map.count("vfreset")) {
+    args.vfreset = false;
+  }
+
+  if(variables_map.count("meminc")) {
+    args.meminc = false;
+  }
+
+  if(variables_map.count("noclip")) {
+    args.clip = false;
+  }
+  
+  if(variables_map.count("shiftx")) {
+    args.shiftx = true;
+  }
+
+  if(variables_map.count("jumpx")) {
+    args.jumpx = true;
+  }
+  return true;
+}
+
+bool apply_execution_options(const boost::program_options::variables_map &variables_map, Arguments &args) {
+  std::string dispatch = variables_map["dispatch"].as<std::string>();
+  if(dispatch == "threaded") {
+    args.dispatch = Dispatch_Mode::THREADED;
+  } else if(dispatch == "switch") {
+    args.dispatch = Dispatch_Mode::SWITCH;
+  } else if(dispatch == "jit") {
+    args.dispatch = Dispatch_Mode::JIT;
+  } else {
+    std::cout << "Unknown dispatch " << dispatch << ", use threaded, switch or jit" << std::endl;
+    return false;
+  }
+
+  if(variables_map.count("seed")) {
+    args.seed = variables_map["seed"].as<uint32_t>();
+  }
+  return true;
+}
+
+bool apply_run_length_options(const boost::program_options::variables_map &variables_map, Run_Length &run_length) {
+  /* Exactly one of the run lengths has to be given */
+  if(variables_map.count("cycles") == variables_map.count("frames")) {
+    std::cout << "Please provide either --cycles or --frames" << std::endl;
+    return false;
+  }
+
+  run_length.cycles_per_frame = variables_map["cycles-per-frame"].as<uint32_t>();
+  if(run_length.cycles_per_frame == 0) {
+    std::cout << "--cycles-per-frame must be bigger than 0" << std::endl;
+    return false;
+  }
+
+  if(variables_map.count("cycles")) {
+    run_length.cycles = variables_map["cycles"].as<uint64_t>();
+    run_length.frames = run_length.cycles / run_length.cycles_per_frame;
+  } else {
+    run_length.frames = variables_map["frames"].as<uint64_t>();
+    run_length.cycles = run_length.frames * run_length.cycles_per_frame;
+  }
+  return true;
+}
+
+bool apply_capture_options(const boost::program_options::variables_map &variables_map, std::string &path, 
+  Capture_Format &format) {
+  std::string capture_format = variables_map["capture-format"].as<std::string>();
+  if(capture_format == "y4m") {
+    format = Capture_Format::Y4M;
+  } else if(capture_format == "rgba") {
+    format = Capture_Format::RGBA;
+  } else if(capture_format == "ppm") {
+    format = Capture_Format::PPM;
+  } else {
+    std::cout << "Unknown capture format " << capture_format << ", use y4m, rgba or ppm" << std::endl;
+    return false;
+  }
+
+  if(variables_map.count("capture")) path = variables_map["capture"].as<std::string>();
+  return true;
+}
\ No newline at end of file
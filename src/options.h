@@ -0,0 +1,45 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <boost/program_options.hpp>
+#include "chip_8.h"
+#include "frame_capture.h"
+
+/* How long a ROM is run for when running headless */
+typedef struct Run_Length {
+  uint64_t cycles;
+  uint64_t frames;
+  uint32_t cycles_per_frame;
+} Run_Length;
+
+/* Add the flags toggling quirks to the description */
+void add_quirk_options(boost::program_options::options_description &description);
+/* Add the flags choosing how instructions are executed to the description */
+void add_execution_options(boost::program_options::options_description &description);
+/* Add the flags setting how long a ROM is run for to the description */
+void add_run_length_options(boost::program_options::options_description &description);
+/* Add the flags recording the display to a video stream or image sequence to the description */
+void add_capture_options(boost::program_options::options_description &description);
+/* Arguments with every quirk set to its default */
+Arguments default_arguments();
+/* Check if a profile or any quirk flag was given */
+bool has_quirk_options(const boost::program_options::variables_map &variables_map);
+/* 
+  Set the platform and quirks in args from the profile and flags found in the variables map, returns false 
+  if the profile is not recognised
+*/
+bool apply_quirk_options(const boost::program_options::variables_map &variables_map, Arguments &args);
+/* Set the execution options in args, returns false if a value is not recognised */
+bool apply_execution_options(const boost::program_options::variables_map &variables_map, Arguments &args);
+
+/* 
+  Set the capture path and format from the variables map, the path is left empty if there is no capture. 
+  Returns false if the format is not recognised
+*/
+bool apply_capture_options(const boost::program_options::variables_map &variables_map, std::string &path, 
+  Capture_Format &format);
+
+/* Set the run length from the cycles or frames found in the variables map, returns false if it is not valid */
+bool apply_run_length_options(const boost::program_options::variables_map &variables_map, Run_Length &run_length);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,200 @@
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include "chip_8.h"
+#include "profiler.h"
+
+/* Class of opcodes the interpreter does not run */
+#define UNKNOWN_OPCODE_CLASS (OPCODE_CLASS_COUNT - 1)
+
+static const char *opcode_class_names[OPCODE_CLASS_COUNT] = {
+  "00E0", "00EE", "0NNN", "1NNN", "2NNN", "3XNN", "4XNN", "5XY0", "6XNN", "7XNN",
+  "8XY0", "8XY1", "8XY2", "8XY3", "8XY4", "8XY5", "8XY6", "8XY7", "8XYE", "9XY0",
+  "ANNN", "BNNN", "CXNN", "DXYN", "EX9E", "EXA1", "FX07", "FX0A", "FX15", "FX18",
+  "FX1E", "FX29", "FX33", "FX55", "FX65", "00CN", "00DN", "00FB", "00FC", "00FD",
+  "00FE", "00FF", "5XY2", "5XY3", "F000", "FN01", "FX30", "FX75", "FX85", "F002",
+  "FX3A", "unknown"
+};
+
+uint8_t opcode_class(uint16_t opcode) {
+  uint8_t nn = opcode & 0xFF;
+  switch(opcode >> 12) {
+    case 0x0:
+      if(opcode == 0x00E0) return 0;
+      if(opcode == 0x00EE) return 1;
+      if((opcode & 0xFFF0) == 0x00C0) return 35;
+      if((opcode & 0xFFF0) == 0x00D0) return 36;
+      if(opcode >= 0x00FB && opcode <= 0x00FF) return 37 + (opcode - 0x00FB);
+      return 2;
+    case 0x5:
+      switch(opcode & 0xF) {
+        case 0x0: return 7;
+        case 0x2: return 42;
+        case 0x3: return 43;
+        default: return UNKNOWN_OPCODE_CLASS;
+      }
+    case 0x8:
+      switch(opcode & 0xF) {
+        case 0x0: case 0x1: case 0x2: case 0x3: case 0x4: case 0x5: case 0x6: case 0x7:
+          return 10 + (opcode & 0xF);
+        case 0xE:
+          return 18;
+        default:
+          return UNKNOWN_OPCODE_CLASS;
+      }
+    case 0x9:
+      return (opcode & 0xF) == 0 ? 19 : UNKNOWN_OPCODE_CLASS;
+    case 0xE:
+      if(nn == 0x9E) return 24;
+      if(nn == 0xA1) return 25;
+      return UNKNOWN_OPCODE_CLASS;
+    case 0xF:
+      switch(nn) {
+        case 0x00: return opcode == 0xF000 ? 44 : UNKNOWN_OPCODE_CLASS;
+        case 0x01: return 45;
+        case 0x02: return opcode == 0xF002 ? 49 : UNKNOWN_OPCODE_CLASS;
+        case 0x07: return 26;
+        case 0x0A: return 27;
+        case 0x15: return 28;
+        case 0x18: return 29;
+        case 0x1E: return 30;
+        case 0x29: return 31;
+        case 0x33: return 32;
+        case 0x55: return 33;
+        case 0x65: return 34;
+        case 0x30: return 46;
+        case 0x75: return 47;
+        case 0x85: return 48;
+        case 0x3A: return 50;
+        default: return UNKNOWN_OPCODE_CLASS;
+      }
+    default:
+      /* 1NNN to 4XNN, 6XNN, 7XNN and ANNN to DXYN have no sub opcode */
+      {
+        static const uint8_t classes[] = {0, 3, 4, 5, 6, 0, 8, 9, 0, 0, 20, 21, 22, 23};
+        return classes[opcode >> 12];
+      }
+  }
+}
+
+const char *opcode_class_name(uint8_t opcode_class) {
+  return opcode_class_names[std::min<uint8_t>(opcode_class, UNKNOWN_OPCODE_CLASS)];
+}
+
+Profiler::Profiler() {
+  reset();
+}
+
+void Profiler::reset() {
+  _instructions = 0;
+  _opcode_counts.fill(0);
+  _address_counts.assign(MAX_MEMORY_SIZE, 0);
+  _call_edges.clear();
+  _loop_edges.clear();
+  _nodes.assign(1, Profile_Node{PROGRAM_ADDRESS, 0, 0});
+  _children.clear();
+  _current = 0;
+}
+
+void Profiler::_call(uint16_t address, uint16_t target) {
+  _call_edges[edge_key(address, target)]++;
+  uint64_t key = (static_cast<uint64_t>(_current) << 16) | target;
+  std::unordered_map<uint64_t, uint32_t>::const_iterator child = _children.find(key);
+  if(child != _children.end()) {
+    _current = child->second;
+    return;
+  }
+  _nodes.push_back(Profile_Node{target, _current, 0});
+  _current = _nodes.size() - 1;
+  _children.emplace(key, _current);
+}
+
+static std::string hex_address(uint16_t address) {
+  std::ostringstream out;
+  out << "0x" << std::hex << std::setw(3) << std::setfill('0') << address;
+  return out.str();
+}
+
+/* Edges of a map sorted by count, hottest first */
+static std::vector<std::pair<uint32_t, uint64_t>> sorted_edges(const std::unordered_map<uint32_t, uint64_t> &edges) {
+  std::vector<std::pair<uint32_t, uint64_t>> sorted(edges.begin(), edges.end());
+  std::sort(sorted.begin(), sorted.end(), [](const std::pair<uint32_t, uint64_t> &a, const std::pair<uint32_t, uint64_t> &b) {
+    return a.second != b.second ? a.second > b.second : a.first < b.first;
+  });
+  return sorted;
+}
+
+void Profiler::write_json(std::ostream &out) const {
+  out << "{" << std::endl;
+  out << "  \"instructions\": " << _instructions << "," << std::endl;
+
+  out << "  \"opcodes\": {";
+  bool first = true;
+  for(uint8_t i = 0; i < OPCODE_CLASS_COUNT; i++) {
+    if(_opcode_counts[i] == 0) continue;
+    out << (first ? "" : ", ") << "\"" << opcode_class_names[i] << "\": " << _opcode_counts[i];
+    first = false;
+  }
+  out << "}," << std::endl;
+
+  /* Hottest addresses first, ties in address order */
+  std::vector<uint16_t> addresses;
+  for(uint32_t address = 0; address < MAX_MEMORY_SIZE; address++) {
+    if(_address_counts[address] > 0) addresses.push_back(address);
+  }
+  std::stable_sort(addresses.begin(), addresses.end(), [this](uint16_t a, uint16_t b) {
+    return _address_counts[a] > _address_counts[b];
+  });
+  if(addresses.size() > PROFILE_REPORT_LENGTH) addresses.resize(PROFILE_REPORT_LENGTH);
+  out << "  \"hot_addresses\": [";
+  for(size_t i = 0; i < addresses.size(); i++) {
+    out << (i == 0 ? "" : ",") << std::endl;
+    out << "    {\"address\": \"" << hex_address(addresses[i]) << "\", \"count\": " << _address_counts[addresses[i]] << "}";
+  }
+  out << std::endl << "  ]," << std::endl;
+
+  out << "  \"calls\": [";
+  std::vector<std::pair<uint32_t, uint64_t>> calls = sorted_edges(_call_edges);
+  for(size_t i = 0; i < calls.size(); i++) {
+    out << (i == 0 ? "" : ",") << std::endl;
+    out << "    {\"from\": \"" << hex_address(calls[i].first >> 16) << "\", \"to\": \"" 
+      << hex_address(calls[i].first & 0xFFFF) << "\", \"count\": " << calls[i].second << "}";
+  }
+  out << std::endl << "  ]," << std::endl;
+
+  /* A backward jump closes a loop over the addresses from its target up to itself */
+  out << "  \"loops\": [";
+  std::vector<std::pair<uint32_t, uint64_t>> loops = sorted_edges(_loop_edges);
+  if(loops.size() > PROFILE_REPORT_LENGTH) loops.resize(PROFILE_REPORT_LENGTH);
+  for(size_t i = 0; i < loops.size(); i++) {
+    uint16_t end = loops[i].first >> 16;
+    uint16_t start = loops[i].first & 0xFFFF;
+    uint64_t instructions = 0;
+    /* Counted wider than the addresses, so a loop ending at 0xFFFF stops */
+    for(uint32_t address = start; address <= end; address++) {
+      instructions += _address_counts[address];
+    }
+    out << (i == 0 ? "" : ",") << std::endl;
+    out << "    {\"start\": \"" << hex_address(start) << "\", \"end\": \"" << hex_address(end) 
+      << "\", \"iterations\": " << loops[i].second << ", \"instructions\": " << instructions << "}";
+  }
+  out << std::endl << "  ]" << std::endl;
+  out << "}" << std::endl;
+}
+
+void Profiler::write_folded(std::ostream &out) const {
+  for(uint32_t node = 0; node < _nodes.size(); node++) {
+    if(_nodes[node].instructions == 0) continue;
+    /* Walk up to the root, then write the routines outermost first */
+    std::vector<uint16_t> stack;
+    for(uint32_t frame = node; frame != 0; frame = _nodes[frame].parent) {
+      stack.push_back(_nodes[frame].address);
+    }
+    out << "main";
+    for(std::vector<uint16_t>::const_reverse_iterator frame = stack.rbegin(); frame != stack.rend(); frame++) {
+      out << ";" << hex_address(*frame);
+    }
+    out << " " << _nodes[node].instructions << std::endl;
+  }
+}
\ No newline at end of file
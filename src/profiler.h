@@ -0,0 +1,80 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <array>
+#include <ostream>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+#include "machine_state.h"
+
+/* Set to 1 by the CHIP_8_PROFILER build option, the hooks in the interpreter are left out otherwise */
+#ifndef CHIP_8_PROFILER
+#define CHIP_8_PROFILER 0
+#endif
+
+/* Number of classes instructions are counted in, e.g. 8XY4 or FX33, with one for unknown opcodes */
+#define OPCODE_CLASS_COUNT 52
+/* Number of entries in the hot address and loop lists of the JSON report */
+#define PROFILE_REPORT_LENGTH 32
+
+/* Routine of the guest call tree, entered by a 2NNN to its address */
+typedef struct Profile_Node {
+  uint16_t address;
+  uint32_t parent;
+  /* Instructions run in the routine itself, not counting the routines it called */
+  uint64_t instructions;
+} Profile_Node;
+
+/* Get the class of an opcode, an index into the names from opcode_class_name */
+uint8_t opcode_class(uint16_t opcode);
+const char *opcode_class_name(uint8_t opcode_class);
+
+/* 
+  Counts instructions run by the guest: per opcode class, per address and per routine of the call 
+  tree, along with the 2NNN call edges and the backward jumps closing loops
+*/
+class Profiler {
+  public:
+    /* Constructor */
+    Profiler();
+    /* Count the instruction at the address, after it ran and moved the program counter and stack pointer */
+    void record(uint16_t address, uint16_t opcode, uint16_t next_address, int8_t stack_change) {
+      _instructions++;
+      _opcode_counts[opcode_class(opcode)]++;
+      _address_counts[address & (MAX_MEMORY_SIZE - 1)]++;
+      _nodes[_current].instructions++;
+      if(stack_change > 0) {
+        _call(address, next_address);
+      } else if(stack_change < 0) {
+        if(_current != 0) _current = _nodes[_current].parent;
+      } else if(next_address <= address) {
+        _loop_edges[edge_key(address, next_address)]++;
+      }
+    }
+    /* Drop everything counted so far */
+    void reset();
+    /* Write the counts, hottest addresses, call edges and loops as JSON */
+    void write_json(std::ostream &out) const;
+    /* Write one line per call stack with the instructions run in it, as read by flame graph tools */
+    void write_folded(std::ostream &out) const;
+  private:
+    static uint32_t edge_key(uint16_t from, uint16_t to) {
+      return (static_cast<uint32_t>(from) << 16) | to;
+    }
+    /* Move into the routine called from the address, creating its node the first time */
+    void _call(uint16_t address, uint16_t target);
+    uint64_t _instructions;
+    std::array<uint64_t, OPCODE_CLASS_COUNT> _opcode_counts;
+    std::vector<uint64_t> _address_counts;
+    /* Counts keyed by the from address in the top 16 bits and the to address in the bottom 16 */
+    std::unordered_map<uint32_t, uint64_t> _call_edges;
+    std::unordered_map<uint32_t, uint64_t> _loop_edges;
+    /* Call tree, node 0 is the code run outside any routine */
+    std::vector<Profile_Node> _nodes;
+    /* Child of each node for a routine address, keyed by the parent in the top bits */
+    std::unordered_map<uint64_t, uint32_t> _children;
+    uint32_t _current;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,135 @@
+#include <cstring>
+#include "byte_stream.h"
+#include "rewind_buffer.h"
+
+static void put_length(std::vector<uint8_t> &data, size_t length) {
+  while(length > VARINT_PAYLOAD) {
+    data.push_back(static_cast<uint8_t>(length & VARINT_PAYLOAD) | VARINT_CONTINUE);
+    length >>= VARINT_SHIFT;
+  }
+  data.push_back(static_cast<uint8_t>(length));
+}
+
+static size_t get_length(const uint8_t *&data) {
+  size_t length = 0;
+  uint8_t shift = 0;
+  while(*data & VARINT_CONTINUE) {
+    length |= static_cast<size_t>(*data++ & VARINT_PAYLOAD) << shift;
+    shift += VARINT_SHIFT;
+  }
+  length |= static_cast<size_t>(*data++) << shift;
+  return length;
+}
+
+/* Encode the XOR of state and reference as pairs of a run of equal bytes and a run of differing XOR bytes */
+static void encode_delta(const uint8_t *state, const uint8_t *reference, size_t size, std::vector<uint8_t> &data) {
+  data.clear();
+  size_t i = 0;
+  while(i < size) {
+    size_t equal_start = i;
+    while(i < size && state[i] == reference[i]) i++;
+    size_t literal_start = i;
+    while(i < size && state[i] != reference[i]) i++;
+    put_length(data, literal_start - equal_start);
+    put_length(data, i - literal_start);
+    for(size_t j = literal_start; j < i; j++) {
+      data.push_back(state[j] ^ reference[j]);
+    }
+  }
+}
+
+/* Apply an encoded XOR onto the bytes of the reference */
+static void apply_delta(const std::vector<uint8_t> &data, uint8_t *state, size_t size) {
+  const uint8_t *position = data.data();
+  const uint8_t *end = position + data.size();
+  size_t i = 0;
+  while(position < end && i < size) {
+    i += get_length(position);
+    size_t literal_length = get_length(position);
+    for(size_t j = 0; j < literal_length; j++) {
+      state[i++] ^= *position++;
+    }
+  }
+}
+
+Rewind_Buffer::Rewind_Buffer(Platform platform, size_t budget, uint32_t keyframe_interval) : 
+  _state_size(machine_state_size(platform)), _budget(budget), 
+  _keyframe_interval(keyframe_interval > 0 ? keyframe_interval : 1), _memory_usage(0), _keyframe_count(0) {
+  std::memset(&_keyframe, 0, _state_size);
+  _zero = std::vector<uint8_t>(_state_size, 0);
+}
+
+void Rewind_Buffer::push(const Machine_State &state) {
+  const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&state);
+  Rewind_Frame frame;
+
+  if(_frames.empty() || _frames.back().keyframe_distance + 1 >= _keyframe_interval) {
+    /* Keyframes are the XOR against zero, so runs of zero memory still compress */
+    encode_delta(bytes, _zero.data(), _state_size, _scratch);
+    frame.keyframe_distance = 0;
+    std::memcpy(&_keyframe, &state, _state_size);
+    _keyframe_count++;
+  } else {
+    encode_delta(bytes, reinterpret_cast<const uint8_t *>(&_keyframe), _state_size, _scratch);
+    frame.keyframe_distance = _frames.back().keyframe_distance + 1;
+  }
+
+  frame.data.assign(_scratch.begin(), _scratch.end());
+  _memory_usage += frame.data.capacity() + sizeof(Rewind_Frame);
+  _frames.push_back(std::move(frame));
+  _enforce_budget();
+}
+
+uint32_t Rewind_Buffer::rewind(uint32_t frames, Machine_State &state) {
+  if(_frames.empty()) return 0;
+  if(frames > _frames.size() - 1) frames = _frames.size() - 1;
+  for(uint32_t i = 0; i < frames; i++) {
+    _pop_newest();
+  }
+
+  /* The next frame recorded is a delta against the keyframe of the frame rewound to */
+  size_t newest = _frames.size() - 1;
+  _decode(newest - _frames.back().keyframe_distance, _keyframe);
+  _decode(newest, state);
+  return frames;
+}
+
+void Rewind_Buffer::clear() {
+  _frames.clear();
+  _memory_usage = 0;
+  _keyframe_count = 0;
+}
+
+size_t Rewind_Buffer::get_frame_count() const {
+  return _frames.size();
+}
+
+size_t Rewind_Buffer::get_memory_usage() const {
+  return _memory_usage;
+}
+
+void Rewind_Buffer::_decode(size_t index, Machine_State &state) const {
+  uint8_t *bytes = reinterpret_cast<uint8_t *>(&state);
+  const Rewind_Frame &frame = _frames[index];
+  std::memset(bytes, 0, _state_size);
+  if(frame.keyframe_distance > 0) {
+    apply_delta(_frames[index - frame.keyframe_distance].data, bytes, _state_size);
+  }
+  apply_delta(frame.data, bytes, _state_size);
+}
+
+void Rewind_Buffer::_pop_newest() {
+  if(_frames.back().keyframe_distance == 0) _keyframe_count--;
+  _memory_usage -= _frames.back().data.capacity() + sizeof(Rewind_Frame);
+  _frames.pop_back();
+}
+
+void Rewind_Buffer::_enforce_budget() {
+  while(_memory_usage > _budget && _keyframe_count > 1) {
+    do {
+      _memory_usage -= _frames.front().data.capacity() + sizeof(Rewind_Frame);
+      _frames.pop_front();
+    } while(_frames.front().keyframe_distance != 0);
+    _keyframe_count--;
+  }
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#ifndef REWIND_BUFFER_H
+#define REWIND_BUFFER_H
+
+#include <deque>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "machine_state.h"
+
+/* Number of frames from one full keyframe to the next */
+#define REWIND_KEYFRAME_INTERVAL 60
+/* Memory the recorded frames may use before the oldest are dropped */
+#define REWIND_DEFAULT_BUDGET (8 * 1024 * 1024)
+
+/*
+  Records the machine state of every frame so play can be stepped back. Every REWIND_KEYFRAME_INTERVAL 
+  frames a keyframe is stored, the frames in between are stored as the XOR against their keyframe, 
+  run length encoded as nearly all of it is zero. Restoring any frame decodes at most a keyframe and 
+  one delta. The oldest keyframe and its deltas are dropped whenever the budget is exceeded. Only the 
+  machine_state_size bytes of the platform are recorded, the 4KB platforms skip the rest of the memory
+*/
+class Rewind_Buffer {
+  public:
+    /* Constructor */
+    explicit Rewind_Buffer(Platform platform, size_t budget = REWIND_DEFAULT_BUDGET, 
+      uint32_t keyframe_interval = REWIND_KEYFRAME_INTERVAL);
+    /* Record the state of the newest frame, a state of the platform given to the constructor */
+    void push(const Machine_State &state);
+    /* 
+      Step back over the newest frames, restoring the state recorded before them. The oldest frame is 
+      always kept, returns the number of frames stepped back
+    */
+    uint32_t rewind(uint32_t frames, Machine_State &state);
+    /* Drop every recorded frame */
+    void clear();
+    /* Number of frames that can be stepped back to */
+    size_t get_frame_count() const;
+    /* Bytes used by the recorded frames */
+    size_t get_memory_usage() const;
+  private:
+    typedef struct Rewind_Frame {
+      /* Number of frames back to the keyframe, 0 for a keyframe */
+      uint32_t keyframe_distance;
+      /* Run length encoded XOR against the keyframe, or against zero for a keyframe */
+      std::vector<uint8_t> data;
+    } Rewind_Frame;
+    /* Decode the frame at the index into the state */
+    void _decode(size_t index, Machine_State &state) const;
+    /* Remove the newest frame */
+    void _pop_newest();
+    /* Drop the oldest keyframe and its deltas until the budget is met, keeping the newest keyframe */
+    void _enforce_budget();
+    std::deque<Rewind_Frame> _frames;
+    /* Keyframe of the newest frame, which the next delta is taken against */
+    Machine_State _keyframe;
+    /* Zero bytes keyframes are taken against */
+    std::vector<uint8_t> _zero;
+    /* Bytes of each state recorded */
+    size_t _state_size;
+    /* Encoder output, reused so recording a frame only allocates the stored copy */
+    std::vector<uint8_t> _scratch;
+    size_t _budget;
+    uint32_t _keyframe_interval;
+    size_t _memory_usage;
+    size_t _keyframe_count;
+};
+
+#endif
\ No newline at end of file
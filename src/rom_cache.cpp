@@ -0,0 +1,94 @@
+#include <cstdlib>
+#include <cstring>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <unistd.h>
+#include "hash.h"
+#include "rom_cache.h"
+
+bool read_rom_file(const std::string &path, std::vector<uint8_t> &rom) {
+  std::ifstream file(path, std::ios_base::binary | std::ios_base::ate);
+  if(!file.good()) return false;
+
+  std::streamoff size = file.tellg();
+  if(size < 0 || size > MAX_ROM_SIZE) return false;
+  rom.resize(static_cast<size_t>(size));
+  file.seekg(0);
+  return static_cast<bool>(file.read(reinterpret_cast<char *>(rom.data()), size));
+}
+
+void init_rom_cache(Rom_Cache &cache, uint64_t rom_hash, uint32_t rom_size, uint8_t quirks, Platform platform) {
+  std::memset(&cache, 0, sizeof(Rom_Cache));
+  std::memcpy(cache.magic, ROM_CACHE_MAGIC, ROM_CACHE_MAGIC_SIZE);
+  cache.version = ROM_CACHE_VERSION;
+  cache.rom_hash = rom_hash;
+  cache.rom_size = rom_size;
+  cache.quirks = quirks;
+  cache.platform = platform;
+}
+
+std::string default_rom_cache_directory() {
+  if(const char *cache_home = std::getenv("XDG_CACHE_HOME")) {
+    if(*cache_home) return std::string(cache_home) + "/chip_8";
+  }
+  if(const char *home = std::getenv("HOME")) {
+    if(*home) return std::string(home) + "/.cache/chip_8";
+  }
+  return "";
+}
+
+std::string rom_cache_path(const std::string &directory, uint64_t rom_hash) {
+  std::ostringstream path;
+  path << directory << "/" << std::hex << std::setw(16) << std::setfill('0') << rom_hash << ".cache";
+  return path.str();
+}
+
+static uint64_t rom_cache_checksum(const Rom_Cache &cache) {
+  return fnv1a_64(reinterpret_cast<const uint8_t *>(&cache), offsetof(Rom_Cache, checksum));
+}
+
+bool load_rom_cache(const std::string &path, uint64_t rom_hash, Rom_Cache &cache) {
+  std::ifstream file(path, std::ios_base::binary);
+  if(!file.good()) return false;
+
+  /* Fill a copy so a failure leaves the cache untouched */
+  Rom_Cache loaded;
+  if(!file.read(reinterpret_cast<char *>(&loaded), sizeof(Rom_Cache))) return false;
+  if(file.peek() != std::ifstream::traits_type::eof()) return false;
+  if(std::memcmp(loaded.magic, ROM_CACHE_MAGIC, ROM_CACHE_MAGIC_SIZE) || loaded.version != ROM_CACHE_VERSION) return false;
+  if(loaded.checksum != rom_cache_checksum(loaded) || loaded.rom_hash != rom_hash) return false;
+  if(loaded.platform > Platform::XO_CHIP) return false;
+
+  cache = loaded;
+  return true;
+}
+
+bool save_rom_cache(const std::string &path, const Rom_Cache &cache) {
+  std::error_code error;
+  std::filesystem::path file_path(path);
+  if(file_path.has_parent_path()) std::filesystem::create_directories(file_path.parent_path(), error);
+
+  Rom_Cache written = cache;
+  written.checksum = rom_cache_checksum(written);
+
+  /* Each process writes its own temporary file */
+  std::string temporary_path = path + "." + std::to_string(getpid()) + ".tmp";
+  {
+    std::ofstream file(temporary_path, std::ios_base::binary);
+    if(!file.good()) return false;
+    file.write(reinterpret_cast<const char *>(&written), sizeof(Rom_Cache));
+    if(!file.good()) {
+      std::filesystem::remove(temporary_path, error);
+      return false;
+    }
+  }
+  std::filesystem::rename(temporary_path, path, error);
+  if(error) {
+    std::filesystem::remove(temporary_path, error);
+    return false;
+  }
+  return true;
+}
\ No newline at end of file
@@ -0,0 +1,64 @@
+#ifndef ROM_CACHE_H
+#define ROM_CACHE_H
+
+#include <stdint.h>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "machine_state.h"
+
+#define ROM_CACHE_MAGIC "C8RC"
+#define ROM_CACHE_MAGIC_SIZE 4
+#define ROM_CACHE_VERSION 2
+/* One bit per address of the largest memory */
+#define ADDRESS_MAP_SIZE (MAX_MEMORY_SIZE / 8)
+
+/*
+  What earlier runs learnt about a ROM, stored in a file named after the hash of its contents. The file 
+  is this struct as it is laid out in memory, so it is read with one read (or mapped) and only valid 
+  on hosts of the same byte order, which the checksum catches
+*/
+typedef struct Rom_Cache {
+  char magic[ROM_CACHE_MAGIC_SIZE];
+  uint32_t version;
+  uint64_t rom_hash;
+  uint32_t rom_size;
+  /* Quirks and platform the ROM was last run with */
+  uint8_t quirks;
+  uint8_t platform;
+  uint8_t reserved[2];
+  /* Addresses run as instructions, predecoded on the next launch */
+  uint8_t instructions[ADDRESS_MAP_SIZE];
+  /* Addresses translated blocks started at, translated on the next launch */
+  uint8_t blocks[ADDRESS_MAP_SIZE];
+  /* Hash of every field before it */
+  uint64_t checksum;
+} Rom_Cache;
+
+static_assert(std::is_trivially_copyable<Rom_Cache>::value, "Rom_Cache is written to disk as it is in memory");
+
+inline bool address_map_test(const uint8_t *map, uint16_t address) {
+  return (map[address >> 3] >> (address & 7)) & 1;
+}
+
+inline void address_map_set(uint8_t *map, uint16_t address) {
+  map[address >> 3] |= 1 << (address & 7);
+}
+
+/* Read a whole ROM in one read, returns false if it could not be read or does not fit in the memory of any platform */
+bool read_rom_file(const std::string &path, std::vector<uint8_t> &rom);
+/* Clear the cache and set it up for the ROM */
+void init_rom_cache(Rom_Cache &cache, uint64_t rom_hash, uint32_t rom_size, uint8_t quirks, Platform platform);
+/* Cache directory of the user, under XDG_CACHE_HOME or HOME, empty if neither is set */
+std::string default_rom_cache_directory();
+/* Path of the cache file of a ROM in the directory */
+std::string rom_cache_path(const std::string &directory, uint64_t rom_hash);
+/* Read the cache of the ROM, returns false if there is none or it is corrupted, stale or from another version */
+bool load_rom_cache(const std::string &path, uint64_t rom_hash, Rom_Cache &cache);
+/* 
+  Write the cache through a temporary file renamed over the old one, so instances launched together never 
+  read a half written cache. Returns false if it could not be written
+*/
+bool save_rom_cache(const std::string &path, const Rom_Cache &cache);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,119 @@
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include "byte_stream.h"
+#include "hash.h"
+#include "save_state.h"
+
+std::vector<uint8_t> serialize_state(const Machine_State &state, uint8_t quirks, Platform platform) {
+  std::vector<uint8_t> data;
+  Byte_Writer writer(data);
+
+  writer.put_bytes(reinterpret_cast<const uint8_t *>(SAVE_STATE_MAGIC), SAVE_STATE_MAGIC_SIZE);
+  writer.put(SAVE_STATE_VERSION, sizeof(uint16_t));
+  writer.put(quirks, sizeof(uint8_t));
+  writer.put(platform, sizeof(uint8_t));
+
+  writer.put_bytes(state.memory, platform_memory_size(platform));
+  for(const uint64_t (&rows)[DISPLAY_HEIGHT][ROW_WORDS] : state.display.planes) {
+    for(const uint64_t (&row)[ROW_WORDS] : rows) {
+      for(uint64_t word : row) {
+        writer.put(word, sizeof(uint64_t));
+      }
+    }
+  }
+  writer.put(state.display.hires, sizeof(uint8_t));
+  writer.put(state.plane_mask, sizeof(uint8_t));
+  writer.put_bytes(state.flag_registers, NUMBER_OF_FLAG_REGISTERS);
+  writer.put_bytes(state.audio_pattern, AUDIO_PATTERN_SIZE);
+  writer.put(state.pitch, sizeof(uint8_t));
+  writer.put_bytes(state.vs, NUMBER_OF_GENERAL_REGISTERS);
+  for(uint16_t address : state.stack) {
+    writer.put(address, sizeof(uint16_t));
+  }
+  writer.put(state.program_counter, sizeof(uint16_t));
+  writer.put(state.index_register, sizeof(uint16_t));
+  writer.put(state.stack_pointer, sizeof(uint8_t));
+  writer.put(state.delay_timer, sizeof(uint8_t));
+  writer.put(state.sound_timer, sizeof(uint8_t));
+  writer.put(state.curr_pressed_key, sizeof(uint8_t));
+  writer.put(state.keypad, sizeof(uint16_t));
+  writer.put(state.refresh_state, sizeof(uint8_t));
+  writer.put(state.fault, sizeof(uint8_t));
+  writer.put(state.random_state, sizeof(uint64_t));
+
+  writer.put(fnv1a_64(data.data(), data.size()), sizeof(uint64_t));
+  return data;
+}
+
+bool deserialize_state(const std::vector<uint8_t> &data, Machine_State &state, uint8_t &quirks, Platform &platform) {
+  Byte_Reader reader(data);
+  uint8_t magic[SAVE_STATE_MAGIC_SIZE];
+  uint16_t version;
+  if(!reader.get_bytes(magic, SAVE_STATE_MAGIC_SIZE) || std::memcmp(magic, SAVE_STATE_MAGIC, SAVE_STATE_MAGIC_SIZE)) return false;
+  if(!reader.get_field(version) || version != SAVE_STATE_VERSION) return false;
+
+  /* Fill a copy so a failure leaves the state untouched */
+  Machine_State loaded;
+  uint8_t loaded_quirks = 0;
+  uint8_t loaded_platform = 0;
+  uint8_t refresh_state;
+  uint8_t fault;
+  if(!reader.get_field(loaded_quirks) || !reader.get_field(loaded_platform) || 
+    loaded_platform > Platform::XO_CHIP) return false;
+  std::memset(&loaded, 0, machine_state_size(static_cast<Platform>(loaded_platform)));
+  bool complete = reader.get_bytes(loaded.memory, platform_memory_size(static_cast<Platform>(loaded_platform)));
+  for(uint64_t (&rows)[DISPLAY_HEIGHT][ROW_WORDS] : loaded.display.planes) {
+    for(uint64_t (&row)[ROW_WORDS] : rows) {
+      for(uint64_t &word : row) {
+        complete = complete && reader.get_field(word);
+      }
+    }
+  }
+  complete = complete && reader.get_field(loaded.display.hires) && reader.get_field(loaded.plane_mask) && 
+    reader.get_bytes(loaded.flag_registers, NUMBER_OF_FLAG_REGISTERS) && 
+    reader.get_bytes(loaded.audio_pattern, AUDIO_PATTERN_SIZE) && reader.get_field(loaded.pitch) && 
+    reader.get_bytes(loaded.vs, NUMBER_OF_GENERAL_REGISTERS);
+  for(uint16_t &address : loaded.stack) {
+    complete = complete && reader.get_field(address);
+  }
+  complete = complete && reader.get_field(loaded.program_counter) && reader.get_field(loaded.index_register) &&
+    reader.get_field(loaded.stack_pointer) && reader.get_field(loaded.delay_timer) && 
+    reader.get_field(loaded.sound_timer) && reader.get_field(loaded.curr_pressed_key) && 
+    reader.get_field(loaded.keypad) && reader.get_field(refresh_state) && reader.get_field(fault) && 
+    reader.get_field(loaded.random_state);
+  if(!complete) return false;
+
+  /* Everything before the hash has to match it, and nothing can follow it */
+  size_t hashed_size = reader.get_position();
+  uint64_t hash;
+  if(!reader.get_field(hash) || hash != fnv1a_64(data.data(), hashed_size)) return false;
+  if(reader.get_position() != data.size()) return false;
+
+  /* Reject values the interpreter could not have produced */
+  if(loaded.stack_pointer > STACK_DEPTH || refresh_state > Refresh_State::REFRESH_FINISHED || 
+    fault > Machine_Fault::STACK_UNDERFLOW || loaded.display.hires > 1 || 
+    loaded.plane_mask >= 1 << DISPLAY_PLANES) return false;
+  loaded.refresh_state = static_cast<Refresh_State>(refresh_state);
+  loaded.fault = static_cast<Machine_Fault>(fault);
+
+  copy_state(state, loaded, static_cast<Platform>(loaded_platform));
+  quirks = loaded_quirks;
+  platform = static_cast<Platform>(loaded_platform);
+  return true;
+}
+
+bool save_state_file(const std::string &path, const Machine_State &state, uint8_t quirks, Platform platform) {
+  std::ofstream file(path, std::ios_base::binary);
+  if(!file.good()) return false;
+  std::vector<uint8_t> data = serialize_state(state, quirks, platform);
+  file.write(reinterpret_cast<const char *>(data.data()), data.size());
+  return file.good();
+}
+
+bool load_state_file(const std::string &path, Machine_State &state, uint8_t &quirks, Platform &platform) {
+  std::ifstream file(path, std::ios_base::binary);
+  if(!file.good()) return false;
+  std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  return deserialize_state(data, state, quirks, platform);
+}
\ No newline at end of file
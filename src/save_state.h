@@ -0,0 +1,27 @@
+#ifndef SAVE_STATE_H
+#define SAVE_STATE_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "machine_state.h"
+
+#define SAVE_STATE_MAGIC "C8ST"
+#define SAVE_STATE_MAGIC_SIZE 4
+/* Bumped whenever the layout of the fields changes, older versions are rejected */
+#define SAVE_STATE_VERSION 3
+
+/*
+  Write the machine state and the quirks and platform it was run with to the versioned save state format. 
+  Fields are written one at a time in little endian, followed by a hash of everything before it. Only the 
+  memory the platform can address is written
+*/
+std::vector<uint8_t> serialize_state(const Machine_State &state, uint8_t quirks, Platform platform);
+/* Read a save state, returns false if it is truncated, corrupted or from another version */
+bool deserialize_state(const std::vector<uint8_t> &data, Machine_State &state, uint8_t &quirks, Platform &platform);
+/* Write a save state file, returns false if it could not be written */
+bool save_state_file(const std::string &path, const Machine_State &state, uint8_t quirks, Platform platform);
+/* Read a save state file, returns false if it could not be read or is not a valid save state */
+bool load_state_file(const std::string &path, Machine_State &state, uint8_t &quirks, Platform &platform);
+
+#endif
\ No newline at end of file
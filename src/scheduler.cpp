@@ -0,0 +1,50 @@
+#include <thread>
+#include "scheduler.h"
+
+Frame_Scheduler::Frame_Scheduler(Speed_Mode mode, uint32_t turbo_factor) {
+  _mode = mode;
+  _turbo_factor = turbo_factor > 0 ? turbo_factor : 1;
+  _deadline = std::chrono::steady_clock::now() + FRAME_DURATION;
+  _dropped_frames = 0;
+}
+
+/* One frame per deadline, plus one for each deadline missed since the last call */
+uint32_t Frame_Scheduler::frames_to_run() {
+  if(_mode == Speed_Mode::UNTHROTTLED) return 1;
+
+  uint32_t frames = 1;
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  while(now >= _deadline + FRAME_DURATION) {
+    _deadline += FRAME_DURATION;
+    frames++;
+  }
+
+  /* If the host stalled for too long, give up on the missed time instead of running it all at once */
+  if(frames > MAX_CATCH_UP_FRAMES) {
+    _dropped_frames += frames - MAX_CATCH_UP_FRAMES;
+    frames = MAX_CATCH_UP_FRAMES;
+  }
+
+  if(_mode == Speed_Mode::TURBO) frames *= _turbo_factor;
+  return frames;
+}
+
+bool Frame_Scheduler::should_present() {
+  if(_mode != Speed_Mode::UNTHROTTLED) return true;
+
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  if(now < _deadline) return false;
+  _deadline = now + FRAME_DURATION;
+  return true;
+}
+
+void Frame_Scheduler::wait_for_deadline() {
+  if(_mode == Speed_Mode::UNTHROTTLED) return;
+
+  std::this_thread::sleep_until(_deadline);
+  _deadline += FRAME_DURATION;
+}
+
+uint64_t Frame_Scheduler::get_dropped_frames() const {
+  return _dropped_frames;
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <chrono>
+#include <stdint.h>
+
+/* Length of one 60Hz frame */
+#define FRAME_DURATION std::chrono::microseconds(16667)
+/* Most frames run at once to catch up after a stall, anything older is dropped */
+#define MAX_CATCH_UP_FRAMES 5
+#define DEFAULT_TURBO_FACTOR 4
+
+typedef enum Speed_Mode {
+  /* One emulated frame per 60Hz deadline */
+  NORMAL,
+  /* A fixed number of emulated frames per 60Hz deadline */
+  TURBO,
+  /* Emulated frames back to back, presenting at most at 60Hz */
+  UNTHROTTLED
+} Speed_Mode;
+
+/* Paces emulated frames against 60Hz deadlines on the steady clock, sleeping in between */
+class Frame_Scheduler {
+  public:
+    /* Constructor */
+    Frame_Scheduler(Speed_Mode mode, uint32_t turbo_factor = DEFAULT_TURBO_FACTOR);
+    /* Number of emulated frames to run before the next present, including frames to catch up */
+    uint32_t frames_to_run();
+    /* Check if the frame should be presented, only false in unthrottled mode between deadlines */
+    bool should_present();
+    /* Sleep until the next deadline, returns straight away if it has already passed */
+    void wait_for_deadline();
+    /* Number of frames dropped because the host fell too far behind */
+    uint64_t get_dropped_frames() const;
+  private:
+    Speed_Mode _mode;
+    uint32_t _turbo_factor;
+    /* Time the current frame is due to end */
+    std::chrono::steady_clock::time_point _deadline;
+    uint64_t _dropped_frames;
+};
+
+#endif
\ No newline at end of file
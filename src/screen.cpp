@@ -1,25 +1,57 @@
 #include "screen.h"
 
-Screen::Screen(uint16_t height, u_int16_t width) :_height(height), _width(width) {
+Screen::Screen(uint16_t height, u_int16_t width) :_height(height), _width(width), 
+  _texture(sf::Vector2u(DISPLAY_WIDTH, DISPLAY_HEIGHT)), _sprite(_texture), _image_width(0) {
   /* Create the window */
   _window = std::make_unique<sf::RenderWindow>(sf::VideoMode({_width * SCALE, _height * SCALE}), "Chip 8 Emulator");
   _window->setPosition({0, 0});
-  /* Create a rectangle shape as our pixel */
-  _square = sf::RectangleShape({SCALE, SCALE});
+  /* Only report the first press of a held key */
+  _window->setKeyRepeatEnabled(false);
+  _fit_image();
 }
 
-void Screen::display(const std::vector<std::vector<bool>> &data) {
-  _window->clear();
-  for(uint16_t i = 0; i < _height; i++) {
-    for(uint16_t j = 0; j < _width; j++) {
-      if(data[i][j]) {
-        float j_pos = static_cast<float>(j * SCALE);
-        float i_pos = static_cast<float>(i * SCALE);
-        _square.setPosition({j_pos, i_pos});
-        _window->draw(_square);
-      }
-    }
+/* Each texel is scaled up to a square pixel, half as big in the 128x64 mode as in the 64x32 mode */
+void Screen::_fit_image() {
+  _image_width = _renderer.get_width();
+  _sprite.setTextureRect(sf::IntRect({0, 0}, {_renderer.get_width(), _renderer.get_height()}));
+  float scale = static_cast<float>(_width * SCALE) / _renderer.get_width();
+  _sprite.setScale({scale, scale});
+}
+
+void Screen::display(const Framebuffer &data, uint64_t dirty_rows) {
+  /* Nothing was drawn since the last frame, the texture still holds it */
+  if(!dirty_rows) {
+    present();
+    return;
+  }
+
+  _renderer.update(data, dirty_rows);
+  /* A change of resolution redraws the whole image */
+  if(_renderer.get_width() != _image_width) {
+    _fit_image();
+    dirty_rows = ALL_ROWS_DIRTY;
   }
+
+  /* Upload each run of consecutive dirty rows in one go */
+  uint32_t image_width = _renderer.get_width();
+  uint32_t image_height = _renderer.get_height();
+  while(dirty_rows) {
+    uint32_t first_row = __builtin_ctzll(dirty_rows);
+    if(first_row >= image_height) break;
+    uint32_t last_row = first_row;
+    while(last_row + 1 < image_height && (dirty_rows & (1ULL << (last_row + 1)))) last_row++;
+    _texture.update(_renderer.get_row(first_row), {image_width, last_row - first_row + 1}, {0, first_row});
+    /* Shifting by 64 is undefined, so a run of every row is cleared as a whole */
+    uint32_t run_length = last_row - first_row + 1;
+    dirty_rows &= run_length == WORD_BITS ? 0 : ~(((1ULL << run_length) - 1) << first_row);
+  }
+  present();
+}
+
+/* The window's contents are lost when it is uncovered or resized, so the sprite is drawn again every time */
+void Screen::present() {
+  _window->clear();
+  _window->draw(_sprite);
   _window->display();
 }
 
@@ -27,8 +59,9 @@ bool Screen::is_open() {
   return _window->isOpen();
 }
 
-void Screen::poll_events() {
+void Screen::poll_events(Keyboard_Input &keyboard_input) {
   while (const std::optional<sf::Event> event = _window->pollEvent()) {
     if (event->is<sf::Event::Closed>()) _window->close();
+    keyboard_input.handle_event(*event);
   }
 }
\ No newline at end of file
@@ -1,30 +1,42 @@
 #ifndef SCREEN_H
 #define SCREEN_H
 
-#include <vector>
 #include <SFML/Graphics.hpp>
+#include "frame_renderer.h"
+#include "framebuffer.h"
+#include "keyboard_input.h"
 
 #define SCALE 10
 
 class Screen {
 public:
-  /* Constructor */
+  /* Constructor, the window is the height and width scaled by SCALE whatever the resolution drawn */
   Screen(u_int16_t height, u_int16_t width);
-  /* Display the data to the screen */
-  void display(const std::vector<std::vector<bool>> &data);
+  /* Display the data to the screen, only uploading the dirty rows (bit N is row N) */
+  void display(const Framebuffer &data, uint64_t dirty_rows);
+  /* Draw the image already in the texture to the screen again */
+  void present();
   /* Check if the window is still open */
   bool is_open();
-  /* Poll all events that happened in the frame */
-  void poll_events();
+  /* Poll all events that happened in the frame, passing key events to the keyboard input */
+  void poll_events(Keyboard_Input &keyboard_input);
 private:
+  /* Scale the part of the texture in the resolution of the image up to the window */
+  void _fit_image();
   /* Height of the window */
   uint32_t _height;
   /* Width of the window */
   uint32_t _width;
   /* Pointer to the window */
   std::unique_ptr<sf::RenderWindow> _window;
-  /* Pixel */
-  sf::RectangleShape _square;
+  /* RGBA image of the display */
+  Frame_Renderer _renderer;
+  /* Texture holding the image, one texel per pixel, big enough for the 128x64 mode */
+  sf::Texture _texture;
+  /* Sprite drawing the image in the texture scaled up to the window */
+  sf::Sprite _sprite;
+  /* Width of the image the sprite is fitted to */
+  uint16_t _image_width;
 };
 
-#endif
+#endif
\ No newline at end of file
@@ -0,0 +1,103 @@
+#include <sys/stat.h>
+#include "shared_memory_export.h"
+
+static_assert(sizeof(Shared_Frame::planes) == sizeof(Framebuffer::planes), "Shared_Frame has to hold a whole display");
+static_assert(sizeof(Shared_Frame::vs) == sizeof(Machine_State::vs), "Shared_Frame has to hold every register");
+static_assert(sizeof(Shared_Frame::stack) == sizeof(Machine_State::stack), "Shared_Frame has to hold the whole stack");
+
+/* Read and written by the user running the emulator only */
+#define SHARED_MEMORY_MODE (S_IRUSR | S_IWUSR)
+
+Shared_Memory_Export::Shared_Memory_Export(Input_Source &source) : _source(source), _region(nullptr), _keypad(0), 
+  _changed_keys(0) {}
+
+Shared_Memory_Export::~Shared_Memory_Export() {
+  close();
+}
+
+/* 
+  The object is created exclusively, an existing one may belong to another instance still publishing into 
+  it, so it is neither truncated nor removed
+*/
+bool Shared_Memory_Export::open(const std::string &name) {
+  if(_region) return false;
+  int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, SHARED_MEMORY_MODE);
+  if(fd < 0) return false;
+  if(ftruncate(fd, sizeof(Shared_Region)) != 0) {
+    ::close(fd);
+    shm_unlink(name.c_str());
+    return false;
+  }
+  void *memory = mmap(nullptr, sizeof(Shared_Region), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if(memory == MAP_FAILED) {
+    shm_unlink(name.c_str());
+    return false;
+  }
+
+  /* The object starts zeroed, so clients attaching now see no frames and no keys */
+  _name = name;
+  _region = static_cast<Shared_Region *>(memory);
+  _region->version = CHIP_8_SHM_VERSION;
+  _region->size = sizeof(Shared_Region);
+  _keypad = 0;
+  _changed_keys = 0;
+  /* Clients check the magic number last, so it is written last */
+  __atomic_store_n(&_region->magic, CHIP_8_SHM_MAGIC, __ATOMIC_RELEASE);
+  return true;
+}
+
+/* Only this thread writes the sequence, so it can be read back without synchronisation */
+void Shared_Memory_Export::publish(const Chip_8 &chip_8, uint64_t frame_number) {
+  if(!_region) return;
+  uint64_t sequence = _region->sequence;
+  __atomic_store_n(&_region->sequence, sequence + 1, __ATOMIC_RELAXED);
+  /* Clients seeing any of the writes below also see the odd sequence */
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+
+  const Machine_State &state = chip_8.get_state();
+  Shared_Frame &frame = _region->frame;
+  frame.frame_number = frame_number;
+  frame.cycle_count = chip_8.get_cycle_count();
+  memcpy(frame.planes, state.display.planes, sizeof(frame.planes));
+  frame.hires = state.display.hires;
+  frame.plane_mask = state.plane_mask;
+  frame.stack_pointer = state.stack_pointer;
+  frame.delay_timer = state.delay_timer;
+  frame.sound_timer = state.sound_timer;
+  frame.fault = static_cast<uint8_t>(state.fault);
+  frame.keypad = state.keypad;
+  memcpy(frame.vs, state.vs, sizeof(frame.vs));
+  memcpy(frame.stack, state.stack, sizeof(frame.stack));
+  frame.program_counter = state.program_counter;
+  frame.index_register = state.index_register;
+
+  __atomic_store_n(&_region->sequence, sequence + 2, __ATOMIC_RELEASE);
+}
+
+/* Clients keep their mapping after the name is removed, so they can still read the last frame */
+void Shared_Memory_Export::close() {
+  if(!_region) return;
+  __atomic_store_n(&_region->closed, CHIP_8_SHM_CLOSED, __ATOMIC_RELEASE);
+  munmap(_region, sizeof(Shared_Region));
+  shm_unlink(_name.c_str());
+  _region = nullptr;
+}
+
+bool Shared_Memory_Export::poll_event(Key_Event &event) {
+  if(_source.poll_event(event)) return true;
+  if(!_region) return false;
+
+  /* Take the keypad once per round of polling, then hand out its changes one key at a time */
+  if(!_changed_keys) {
+    uint16_t keypad = __atomic_load_n(&_region->keypad, __ATOMIC_ACQUIRE);
+    _changed_keys = keypad ^ _keypad;
+    _keypad = keypad;
+    if(!_changed_keys) return false;
+  }
+
+  uint8_t key = __builtin_ctz(_changed_keys);
+  _changed_keys &= _changed_keys - 1;
+  event = Key_Event{key, ((_keypad >> key) & 0x1) != 0, std::chrono::steady_clock::now()};
+  return true;
+}
\ No newline at end of file
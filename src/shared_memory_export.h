@@ -0,0 +1,42 @@
+#ifndef SHARED_MEMORY_EXPORT_H
+#define SHARED_MEMORY_EXPORT_H
+
+#include <stdint.h>
+#include <string>
+#include "chip_8.h"
+#include "chip_8_shm.h"
+#include "input_source.h"
+
+/*
+  Publishes every frame of a machine into a POSIX shared memory object laid out as in chip_8_shm.h, 
+  and passes on the key events of another input source together with the keys clients set in it. 
+  Publishing copies the frame under the sequence lock and never waits on a client
+*/
+class Shared_Memory_Export : public Input_Source {
+  public:
+    /* Constructor */
+    explicit Shared_Memory_Export(Input_Source &source);
+    /* Destructor, removes the object if it is still open */
+    ~Shared_Memory_Export();
+    /* 
+      Create the object under the name (e.g. /chip8) and map it, returns false if it could not be created, 
+      with errno set to EEXIST if an object of that name already exists
+    */
+    bool open(const std::string &name);
+    /* Copy the display and registers of the machine into the region, from the emulating thread */
+    void publish(const Chip_8 &chip_8, uint64_t frame_number);
+    /* Mark the region closed for clients, unmap it and remove its name */
+    void close();
+    /* Events of the source first, then one event for each key a client changed since the last poll */
+    bool poll_event(Key_Event &event) override;
+  private:
+    Input_Source &_source;
+    std::string _name;
+    /* Null while the object is not open */
+    Shared_Region *_region;
+    /* Keypad of the clients as last seen, and the keys changed in it still to be turned into events */
+    uint16_t _keypad;
+    uint16_t _changed_keys;
+};
+
+#endif
\ No newline at end of file
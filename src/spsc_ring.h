@@ -0,0 +1,67 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <stddef.h>
+
+#define CACHE_LINE_SIZE 64
+
+/* 
+  Lock-free ring buffer for exactly one producer thread and one consumer thread. 
+  CAPACITY has to be a power of two
+*/
+template <typename T, size_t CAPACITY>
+class Spsc_Ring {
+  static_assert((CAPACITY & (CAPACITY - 1)) == 0, "Spsc_Ring capacity has to be a power of two");
+  public:
+    Spsc_Ring() : _head(0), _tail(0) {}
+    /* Add an item from the producer thread, returns false if the ring is full */
+    bool push(const T &item) {
+      size_t tail = _tail.load(std::memory_order_relaxed);
+      if(tail - _head.load(std::memory_order_acquire) == CAPACITY) return false;
+      _items[tail & (CAPACITY - 1)] = item;
+      _tail.store(tail + 1, std::memory_order_release);
+      return true;
+    }
+    /* Take the oldest item from the consumer thread, returns false if the ring is empty */
+    bool pop(T &item) {
+      size_t head = _head.load(std::memory_order_relaxed);
+      if(head == _tail.load(std::memory_order_acquire)) return false;
+      item = _items[head & (CAPACITY - 1)];
+      _head.store(head + 1, std::memory_order_release);
+      return true;
+    }
+    /* Add as many of the items as fit from the producer thread, returns the number added */
+    size_t push(const T *items, size_t count) {
+      size_t tail = _tail.load(std::memory_order_relaxed);
+      size_t added = std::min(count, CAPACITY - (tail - _head.load(std::memory_order_acquire)));
+      for(size_t i = 0; i < added; i++) {
+        _items[(tail + i) & (CAPACITY - 1)] = items[i];
+      }
+      _tail.store(tail + added, std::memory_order_release);
+      return added;
+    }
+    /* Take up to count of the oldest items from the consumer thread, returns the number taken */
+    size_t pop(T *items, size_t count) {
+      size_t head = _head.load(std::memory_order_relaxed);
+      size_t taken = std::min(count, _tail.load(std::memory_order_acquire) - head);
+      for(size_t i = 0; i < taken; i++) {
+        items[i] = _items[(head + i) & (CAPACITY - 1)];
+      }
+      _head.store(head + taken, std::memory_order_release);
+      return taken;
+    }
+    /* Number of items in the ring, exact only when called from one of the two threads while the other is idle */
+    size_t size() const {
+      return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire);
+    }
+  private:
+    /* Counters only ever increase, the slot is the counter modulo the capacity */
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> _head;
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> _tail;
+    alignas(CACHE_LINE_SIZE) std::array<T, CAPACITY> _items;
+};
+
+#endif
\ No newline at end of file
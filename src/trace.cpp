@@ -0,0 +1,286 @@
+#include <chrono>
+#include "byte_stream.h"
+#include "chip_8.h"
+#include "trace.h"
+
+/* Count of records and size of the encoded bytes in front of each block */
+#define TRACE_BLOCK_HEADER_SIZE 8
+#define TRACE_MASK_SIZE 2
+/* Largest encoded block, every record with all its bytes */
+#define TRACE_MAX_BLOCK_SIZE (TRACE_BLOCK_RECORDS * (TRACE_MASK_SIZE + TRACE_RECORD_SIZE))
+
+/* Lay the fields of the difference between a record and the one before it out as little endian bytes */
+static void trace_record_delta(const Trace_Record &record, const Trace_Record &previous, uint8_t *bytes) {
+  uint32_t cycle = record.cycle - previous.cycle - 1;
+  uint16_t fields[4] = {
+    static_cast<uint16_t>(record.address - previous.address - INSTRUCTION_SIZE),
+    static_cast<uint16_t>(record.opcode ^ previous.opcode),
+    static_cast<uint16_t>(record.index_register ^ previous.index_register),
+    static_cast<uint16_t>(record.write_address ^ previous.write_address)
+  };
+  for(int i = 0; i < 4; i++) {
+    bytes[i] = static_cast<uint8_t>(cycle >> (i * BYTE_BITS));
+  }
+  for(int i = 0; i < 4; i++) {
+    bytes[4 + i * 2] = static_cast<uint8_t>(fields[i]);
+    bytes[5 + i * 2] = static_cast<uint8_t>(fields[i] >> BYTE_BITS);
+  }
+  bytes[12] = record.write_length ^ previous.write_length;
+  bytes[13] = record.changed_register ^ previous.changed_register;
+  bytes[14] = record.register_value ^ previous.register_value;
+  bytes[15] = record.flag_register ^ previous.flag_register;
+}
+
+/* Rebuild a record from its difference to the one before it */
+static Trace_Record apply_trace_record_delta(const uint8_t *bytes, const Trace_Record &previous) {
+  uint32_t cycle = 0;
+  for(int i = 0; i < 4; i++) {
+    cycle |= static_cast<uint32_t>(bytes[i]) << (i * BYTE_BITS);
+  }
+  uint16_t fields[4];
+  for(int i = 0; i < 4; i++) {
+    fields[i] = static_cast<uint16_t>(bytes[4 + i * 2] | (bytes[5 + i * 2] << BYTE_BITS));
+  }
+  Trace_Record record;
+  record.cycle = previous.cycle + 1 + cycle;
+  record.address = static_cast<uint16_t>(previous.address + INSTRUCTION_SIZE + fields[0]);
+  record.opcode = previous.opcode ^ fields[1];
+  record.index_register = previous.index_register ^ fields[2];
+  record.write_address = previous.write_address ^ fields[3];
+  record.write_length = previous.write_length ^ bytes[12];
+  record.changed_register = previous.changed_register ^ bytes[13];
+  record.register_value = previous.register_value ^ bytes[14];
+  record.flag_register = previous.flag_register ^ bytes[15];
+  return record;
+}
+
+/* Every block starts from a zeroed record, so blocks decode on their own */
+void encode_trace_block(const Trace_Record *records, uint32_t count, std::vector<uint8_t> &bytes) {
+  Trace_Record previous{};
+  uint8_t delta[TRACE_RECORD_SIZE];
+  for(uint32_t i = 0; i < count; i++) {
+    trace_record_delta(records[i], previous, delta);
+    previous = records[i];
+
+    size_t mask_position = bytes.size();
+    bytes.resize(mask_position + TRACE_MASK_SIZE);
+    uint16_t mask = 0;
+    for(int byte = 0; byte < TRACE_RECORD_SIZE; byte++) {
+      if(!delta[byte]) continue;
+      mask |= 1 << byte;
+      bytes.push_back(delta[byte]);
+    }
+    bytes[mask_position] = static_cast<uint8_t>(mask);
+    bytes[mask_position + 1] = static_cast<uint8_t>(mask >> BYTE_BITS);
+  }
+}
+
+bool decode_trace_block(const uint8_t *bytes, size_t size, uint32_t count, std::vector<Trace_Record> &records) {
+  records.clear();
+  Trace_Record previous{};
+  uint8_t delta[TRACE_RECORD_SIZE];
+  size_t position = 0;
+  for(uint32_t i = 0; i < count; i++) {
+    if(position + TRACE_MASK_SIZE > size) return false;
+    uint16_t mask = static_cast<uint16_t>(bytes[position] | (bytes[position + 1] << BYTE_BITS));
+    position += TRACE_MASK_SIZE;
+    for(int byte = 0; byte < TRACE_RECORD_SIZE; byte++) {
+      delta[byte] = 0;
+      if(!(mask & (1 << byte))) continue;
+      if(position >= size) return false;
+      delta[byte] = bytes[position++];
+    }
+    previous = apply_trace_record_delta(delta, previous);
+    records.push_back(previous);
+  }
+  return position == size;
+}
+
+Tracer::Tracer() : _block(0), _used(0), _records_traced(0), _stalls(0), _bytes_written(0), _failed(false), 
+  _running(false) {
+  _records = std::vector<Trace_Record>(TRACE_BLOCK_RECORDS * TRACE_BLOCK_COUNT);
+  _bytes.reserve(TRACE_MAX_BLOCK_SIZE + TRACE_BLOCK_HEADER_SIZE);
+}
+
+Tracer::~Tracer() {
+  if(_running.load(std::memory_order_acquire)) close();
+}
+
+bool Tracer::open(const std::string &path, Platform platform, uint8_t quirks) {
+  if(_running.load(std::memory_order_acquire)) return false;
+  _file.open(path, std::ios_base::binary);
+  if(!_file.is_open()) return false;
+
+  std::vector<uint8_t> header;
+  Byte_Writer writer(header);
+  writer.put_bytes(reinterpret_cast<const uint8_t *>(TRACE_MAGIC), TRACE_MAGIC_SIZE);
+  writer.put(TRACE_VERSION, sizeof(uint16_t));
+  writer.put(static_cast<uint8_t>(platform), sizeof(uint8_t));
+  writer.put(quirks, sizeof(uint8_t));
+  _file.write(reinterpret_cast<const char *>(header.data()), header.size());
+  _bytes_written.store(header.size(), std::memory_order_relaxed);
+
+  /* Block 0 is filled first, the others wait in the free ring */
+  _block = 0;
+  _used = 0;
+  for(uint8_t block = 1; block < TRACE_BLOCK_COUNT; block++) {
+    _free_blocks.push(block);
+  }
+  _failed.store(!_file.good(), std::memory_order_relaxed);
+  _running.store(true, std::memory_order_release);
+  _thread = std::thread(&Tracer::_run, this);
+  return true;
+}
+
+bool Tracer::close() {
+  if(!_running.load(std::memory_order_acquire)) return false;
+  if(_used > 0) _hand_off(false);
+  {
+    std::lock_guard<std::mutex> lock(_wake_mutex);
+    _running.store(false, std::memory_order_release);
+  }
+  _wake.notify_one();
+  if(_thread.joinable()) _thread.join();
+
+  _file.close();
+  if(_file.fail()) _failed.store(true, std::memory_order_relaxed);
+  return !_failed.load(std::memory_order_relaxed);
+}
+
+Trace_Statistics Tracer::get_statistics() const {
+  return Trace_Statistics{_records_traced + _used, _bytes_written.load(std::memory_order_relaxed), _stalls};
+}
+
+/* 
+  The full ring has a slot for every block of the pool, so the block being filled can always be 
+  queued. Only taking the next one can wait, when the writer has not encoded any block yet
+*/
+void Tracer::_hand_off(bool take_next) {
+  _full_blocks.push(Full_Block{_block, _used});
+  _wake.notify_one();
+  _records_traced += _used;
+  _used = 0;
+  if(!take_next) return;
+
+  if(!_free_blocks.pop(_block)) {
+    _stalls++;
+    while(!_free_blocks.pop(_block)) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+/* Sleeps until a block is queued, a wakeup lost to the unlocked notify only delays the writer by the timeout */
+void Tracer::_run() {
+  while(true) {
+    Full_Block full_block;
+    while(_full_blocks.pop(full_block)) {
+      _write_block(full_block);
+    }
+
+    std::unique_lock<std::mutex> lock(_wake_mutex);
+    if(!_running.load(std::memory_order_acquire)) break;
+    _wake.wait_for(lock, std::chrono::milliseconds(TRACE_WAIT_MILLISECONDS), [this]() {
+      return !_running.load(std::memory_order_acquire) || _full_blocks.size() > 0;
+    });
+  }
+
+  /* Blocks queued before the tracer was closed are still written */
+  Full_Block full_block;
+  while(_full_blocks.pop(full_block)) {
+    _write_block(full_block);
+  }
+}
+
+void Tracer::_write_block(const Full_Block &full_block) {
+  _bytes.clear();
+  Byte_Writer writer(_bytes);
+  writer.put(full_block.count, sizeof(uint32_t));
+  writer.put(0, sizeof(uint32_t));
+  encode_trace_block(&_records[full_block.block * TRACE_BLOCK_RECORDS], full_block.count, _bytes);
+  /* The block is encoded, so the emulating thread can fill it again */
+  _free_blocks.push(full_block.block);
+
+  uint32_t size = static_cast<uint32_t>(_bytes.size() - TRACE_BLOCK_HEADER_SIZE);
+  for(int i = 0; i < 4; i++) {
+    _bytes[sizeof(uint32_t) + i] = static_cast<uint8_t>(size >> (i * BYTE_BITS));
+  }
+  _file.write(reinterpret_cast<const char *>(_bytes.data()), _bytes.size());
+  if(!_file.good()) _failed.store(true, std::memory_order_relaxed);
+  _bytes_written.fetch_add(_bytes.size(), std::memory_order_relaxed);
+}
+
+Trace_Reader::Trace_Reader() : _platform(Platform::COSMAC_VIP), _quirks(0), _next(0), _damaged(false) {}
+
+bool Trace_Reader::open(const std::string &path) {
+  _file.open(path, std::ios_base::binary);
+  if(!_file.is_open()) return false;
+
+  std::vector<uint8_t> header(TRACE_MAGIC_SIZE + sizeof(uint16_t) + 2 * sizeof(uint8_t));
+  if(!_file.read(reinterpret_cast<char *>(header.data()), header.size())) return false;
+  Byte_Reader reader(header);
+  uint8_t magic[TRACE_MAGIC_SIZE];
+  uint16_t version;
+  uint8_t platform;
+  reader.get_bytes(magic, TRACE_MAGIC_SIZE);
+  reader.get_field(version);
+  reader.get_field(platform);
+  reader.get_field(_quirks);
+  if(memcmp(magic, TRACE_MAGIC, TRACE_MAGIC_SIZE) != 0 || version != TRACE_VERSION || platform > Platform::XO_CHIP) {
+    return false;
+  }
+  _platform = static_cast<Platform>(platform);
+  _block.clear();
+  _next = 0;
+  _damaged = false;
+  return true;
+}
+
+bool Trace_Reader::next(Trace_Record &record) {
+  while(_next == _block.size()) {
+    if(!_read_block()) return false;
+  }
+  record = _block[_next++];
+  return true;
+}
+
+bool Trace_Reader::is_damaged() const {
+  return _damaged;
+}
+
+Platform Trace_Reader::get_platform() const {
+  return _platform;
+}
+
+uint8_t Trace_Reader::get_quirks() const {
+  return _quirks;
+}
+
+bool Trace_Reader::_read_block() {
+  _next = 0;
+  _block.clear();
+  uint8_t header[TRACE_BLOCK_HEADER_SIZE];
+  if(!_file.read(reinterpret_cast<char *>(header), TRACE_BLOCK_HEADER_SIZE)) {
+    /* Ending between blocks is the end of the trace, ending inside a header is not */
+    _damaged = _file.gcount() > 0;
+    return false;
+  }
+
+  uint32_t count = 0;
+  uint32_t size = 0;
+  for(int i = 0; i < 4; i++) {
+    count |= static_cast<uint32_t>(header[i]) << (i * BYTE_BITS);
+    size |= static_cast<uint32_t>(header[sizeof(uint32_t) + i]) << (i * BYTE_BITS);
+  }
+  if(count > TRACE_BLOCK_RECORDS || size > TRACE_MAX_BLOCK_SIZE) {
+    _damaged = true;
+    return false;
+  }
+  _bytes.resize(size);
+  if(!_file.read(reinterpret_cast<char *>(_bytes.data()), size) || 
+    !decode_trace_block(_bytes.data(), size, count, _block)) {
+    _damaged = true;
+    return false;
+  }
+  return true;
+}
\ No newline at end of file
@@ -0,0 +1,148 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "machine_state.h"
+#include "spsc_ring.h"
+
+#define TRACE_MAGIC "C8TR"
+#define TRACE_MAGIC_SIZE 4
+#define TRACE_VERSION 1
+/* Records gathered before they are handed to the writer thread as one block */
+#define TRACE_BLOCK_RECORDS 65536
+/* Blocks in the pool shared with the writer thread, a power of two */
+#define TRACE_BLOCK_COUNT 8
+/* Longest the writer thread sleeps before checking for full blocks again, in case a wakeup was missed */
+#define TRACE_WAIT_MILLISECONDS 5
+/* changed_register of an instruction leaving the general registers as they were */
+#define TRACE_NO_REGISTER 0xFF
+
+/* One instruction run, as it left the machine */
+typedef struct Trace_Record {
+  /* Low 32 bits of the cycle the instruction ran in */
+  uint32_t cycle;
+  uint16_t address;
+  uint16_t opcode;
+  /* Index register after the instruction */
+  uint16_t index_register;
+  /* Memory written by FX33, FX55 or XO-CHIP 5XY2, write_length is 0 for every other instruction */
+  uint16_t write_address;
+  uint8_t write_length;
+  /* Lowest register other than vF the instruction changed, vF if it only changed vF, or TRACE_NO_REGISTER */
+  uint8_t changed_register;
+  /* Value of the changed register and of vF after the instruction */
+  uint8_t register_value;
+  uint8_t flag_register;
+} Trace_Record;
+
+static_assert(sizeof(Trace_Record) == 16, "Trace_Record has to stay 16 bytes");
+
+/* Bytes of an encoded record before its zero bytes are left out */
+#define TRACE_RECORD_SIZE 16
+
+typedef struct Trace_Statistics {
+  uint64_t records;
+  /* Bytes of the file, header included, after the blocks are encoded */
+  uint64_t bytes_written;
+  /* Number of times the emulating thread had to wait for the writer to free a block */
+  uint64_t stalls;
+} Trace_Statistics;
+
+/* 
+  Append the records, encoded against the record before each one: the cycle and address as the 
+  difference from the next cycle and instruction, the other fields XORed. A record is then a 16-bit mask 
+  of its non-zero bytes followed by those bytes, so a straight run of instructions takes a few bytes each
+*/
+void encode_trace_block(const Trace_Record *records, uint32_t count, std::vector<uint8_t> &bytes);
+/* Decode count records from the bytes of a block, returns false if they do not hold exactly that many */
+bool decode_trace_block(const uint8_t *bytes, size_t size, uint32_t count, std::vector<Trace_Record> &records);
+
+/*
+  Records every instruction a machine runs into a trace file. Records are written into a block of a 
+  pool allocated up front, and full blocks are encoded and written on a background thread, so the 
+  emulating thread only copies 16 bytes per instruction. Each machine traces into its own Tracer. 
+  Unlike frames, records are never dropped: if every block is waiting to be written the emulating 
+  thread waits for one and the stall is counted
+*/
+class Tracer {
+  public:
+    /* Constructor */
+    Tracer();
+    /* Destructor, finishes the file if it is still open */
+    ~Tracer();
+    /* Create the file, write the header and start the writer thread, returns false if it could not be created */
+    bool open(const std::string &path, Platform platform, uint8_t quirks);
+    /* Add the record of one instruction, from the emulating thread */
+    void record(const Trace_Record &record) {
+      _records[_block * TRACE_BLOCK_RECORDS + _used] = record;
+      if(++_used == TRACE_BLOCK_RECORDS) _hand_off(true);
+    }
+    /* Write the records still held, stop the writer thread and close the file, returns false if any write failed */
+    bool close();
+    /* Counts so far, exact once the tracer is closed */
+    Trace_Statistics get_statistics() const;
+  private:
+    /* Full block waiting for the writer thread */
+    typedef struct Full_Block {
+      uint8_t block;
+      uint32_t count;
+    } Full_Block;
+    /* Queue the block being filled for writing, and take a free one to fill next if another is wanted */
+    void _hand_off(bool take_next);
+    /* Loop run on the writer thread */
+    void _run();
+    /* Encode and write one block */
+    void _write_block(const Full_Block &full_block);
+    std::ofstream _file;
+    /* Every block of the pool, block N starts at record N * TRACE_BLOCK_RECORDS */
+    std::vector<Trace_Record> _records;
+    Spsc_Ring<Full_Block, TRACE_BLOCK_COUNT> _full_blocks;
+    Spsc_Ring<uint8_t, TRACE_BLOCK_COUNT> _free_blocks;
+    /* Owned by the emulating thread, the block being filled and the records in it */
+    uint8_t _block;
+    uint32_t _used;
+    uint64_t _records_traced;
+    uint64_t _stalls;
+    /* Owned by the writer thread, the encoded block */
+    std::vector<uint8_t> _bytes;
+    std::atomic<uint64_t> _bytes_written;
+    std::atomic<bool> _failed;
+    std::atomic<bool> _running;
+    std::mutex _wake_mutex;
+    std::condition_variable _wake;
+    std::thread _thread;
+};
+
+/* Reads the records of a trace file one at a time, a block at a time from the file */
+class Trace_Reader {
+  public:
+    /* Constructor */
+    Trace_Reader();
+    /* Open the file and read its header, returns false if it is not a trace */
+    bool open(const std::string &path);
+    /* Take the next record, returns false at the end of the trace or at a block that cannot be decoded */
+    bool next(Trace_Record &record);
+    /* Check if reading stopped at a damaged or cut off block rather than the end of the file */
+    bool is_damaged() const;
+    Platform get_platform() const;
+    uint8_t get_quirks() const;
+  private:
+    /* Read and decode the next block, returns false if there is none */
+    bool _read_block();
+    std::ifstream _file;
+    Platform _platform;
+    uint8_t _quirks;
+    std::vector<uint8_t> _bytes;
+    std::vector<Trace_Record> _block;
+    size_t _next;
+    bool _damaged;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,54 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+#include <stdint.h>
+#include "spsc_ring.h"
+
+/* Set on the middle slot index when it holds a value the reader has not taken yet */
+#define TRIPLE_BUFFER_FRESH 0x4
+#define TRIPLE_BUFFER_INDEX_MASK 0x3
+
+/*
+  Lock-free handoff of the latest value from one writer thread to one reader thread. 
+  The writer fills its back slot and swaps it with the middle slot, the reader swaps its front slot 
+  with the middle slot when it is fresh. Neither side ever waits, and the reader always gets the 
+  latest published value, older ones are overwritten
+*/
+template <typename T>
+class Triple_Buffer {
+  public:
+    Triple_Buffer() : _back(0), _middle(1), _front(2) {}
+    /* Slot for the writer to fill */
+    T &write_slot() {
+      return _slots[_back].value;
+    }
+    /* Publish the filled slot, and take the middle slot as the next one to fill */
+    void publish() {
+      _back = _middle.exchange(_back | TRIPLE_BUFFER_FRESH, std::memory_order_acq_rel) & TRIPLE_BUFFER_INDEX_MASK;
+    }
+    /* Take the latest published value if there is a new one, returns false otherwise */
+    bool acquire() {
+      if(!(_middle.load(std::memory_order_relaxed) & TRIPLE_BUFFER_FRESH)) return false;
+      _front = _middle.exchange(_front, std::memory_order_acq_rel) & TRIPLE_BUFFER_INDEX_MASK;
+      return true;
+    }
+    /* Latest value taken by the reader */
+    const T &read_slot() const {
+      return _slots[_front].value;
+    }
+  private:
+    /* Slots on their own cache lines so the two threads do not share one */
+    struct alignas(CACHE_LINE_SIZE) Slot {
+      T value;
+    };
+    Slot _slots[3];
+    /* Index owned by the writer */
+    uint8_t _back;
+    /* Index swapped between the threads, with the fresh bit */
+    alignas(CACHE_LINE_SIZE) std::atomic<uint8_t> _middle;
+    /* Index owned by the reader */
+    alignas(CACHE_LINE_SIZE) uint8_t _front;
+};
+
+#endif
\ No newline at end of file
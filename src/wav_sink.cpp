@@ -0,0 +1,69 @@
+#include "byte_stream.h"
+#include "wav_sink.h"
+
+#define WAV_FORMAT_PCM 1
+#define WAV_CHANNELS 1
+#define WAV_SAMPLE_SIZE 2
+#define WAV_FORMAT_CHUNK_SIZE 16
+/* Bytes of the header counted in the RIFF chunk size, everything after its size field */
+#define WAV_RIFF_HEADER_SIZE (WAV_HEADER_SIZE - 8)
+
+Wav_Sink::Wav_Sink(Audio_Ring &ring, uint32_t sample_rate) : _ring(ring), _sample_rate(sample_rate), _tick(0), 
+  _data_size(0) {
+  _samples = std::vector<int16_t>(samples_in_tick(0, sample_rate) + 1);
+}
+
+Wav_Sink::~Wav_Sink() {
+  if(_file.is_open()) close();
+}
+
+bool Wav_Sink::open(const std::string &path) {
+  _file.open(path, std::ios_base::binary);
+  if(!_file.is_open()) return false;
+  _data_size = 0;
+  _write_header();
+  return _file.good();
+}
+
+void Wav_Sink::pull_tick() {
+  uint32_t count = samples_in_tick(_tick++, _sample_rate);
+  _ring.read(_samples.data(), count);
+  if(!_file.is_open()) return;
+
+  _bytes.clear();
+  Byte_Writer writer(_bytes);
+  for(uint32_t i = 0; i < count; i++) {
+    writer.put(static_cast<uint16_t>(_samples[i]), WAV_SAMPLE_SIZE);
+  }
+  _file.write(reinterpret_cast<const char *>(_bytes.data()), _bytes.size());
+  _data_size += static_cast<uint32_t>(_bytes.size());
+}
+
+/* The header was written for no samples when the file was opened, now it can be given the real sizes */
+bool Wav_Sink::close() {
+  if(!_file.is_open()) return false;
+  _file.seekp(0);
+  _write_header();
+  bool written = _file.good();
+  _file.close();
+  return written;
+}
+
+void Wav_Sink::_write_header() {
+  std::vector<uint8_t> header;
+  Byte_Writer writer(header);
+  writer.put_bytes(reinterpret_cast<const uint8_t *>("RIFF"), 4);
+  writer.put(WAV_RIFF_HEADER_SIZE + _data_size, sizeof(uint32_t));
+  writer.put_bytes(reinterpret_cast<const uint8_t *>("WAVE"), 4);
+  writer.put_bytes(reinterpret_cast<const uint8_t *>("fmt "), 4);
+  writer.put(WAV_FORMAT_CHUNK_SIZE, sizeof(uint32_t));
+  writer.put(WAV_FORMAT_PCM, sizeof(uint16_t));
+  writer.put(WAV_CHANNELS, sizeof(uint16_t));
+  writer.put(_sample_rate, sizeof(uint32_t));
+  writer.put(_sample_rate * WAV_CHANNELS * WAV_SAMPLE_SIZE, sizeof(uint32_t));
+  writer.put(WAV_CHANNELS * WAV_SAMPLE_SIZE, sizeof(uint16_t));
+  writer.put(WAV_SAMPLE_SIZE * BYTE_BITS, sizeof(uint16_t));
+  writer.put_bytes(reinterpret_cast<const uint8_t *>("data"), 4);
+  writer.put(_data_size, sizeof(uint32_t));
+  _file.write(reinterpret_cast<const char *>(header.data()), header.size());
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+#ifndef WAV_SINK_H
+#define WAV_SINK_H
+
+#include <fstream>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "audio.h"
+
+/* Size of the RIFF header in front of the samples */
+#define WAV_HEADER_SIZE 44
+
+/*
+  Output for hosts without audio hardware, writing the ring to a 16-bit mono WAV file. It takes one 
+  tick of samples from the ring for every emulated 60Hz tick, as a device playing in real time would, 
+  so the ring counts underruns and dropped samples the same way it does for the audio stream
+*/
+class Wav_Sink {
+  public:
+    /* Constructor */
+    explicit Wav_Sink(Audio_Ring &ring, uint32_t sample_rate = AUDIO_SAMPLE_RATE);
+    /* Destructor, finishes the file if it is still open */
+    ~Wav_Sink();
+    /* Create the file and write a header for no samples, returns false if it could not be created */
+    bool open(const std::string &path);
+    /* Read the samples of one 60Hz tick from the ring and append them to the file */
+    void pull_tick();
+    /* Write the final sizes into the header and close the file, returns false if any write failed */
+    bool close();
+  private:
+    /* Write the header for the samples appended so far at the start of the file */
+    void _write_header();
+    Audio_Ring &_ring;
+    uint32_t _sample_rate;
+    uint64_t _tick;
+    /* Bytes of samples appended so far */
+    uint32_t _data_size;
+    std::ofstream _file;
+    std::vector<int16_t> _samples;
+    std::vector<uint8_t> _bytes;
+};
+
+#endif
\ No newline at end of file
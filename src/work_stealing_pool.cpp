@@ -0,0 +1,74 @@
+#include <thread>
+#include "work_stealing_pool.h"
+
+Work_Stealing_Pool::Work_Stealing_Pool(size_t thread_count) : _next_queue(0), _steal_count(0) {
+  if(thread_count == 0) thread_count = std::thread::hardware_concurrency();
+  if(thread_count == 0) thread_count = 1;
+  for(size_t i = 0; i < thread_count; i++) {
+    _queues.push_back(std::make_unique<Worker_Queue>());
+  }
+}
+
+void Work_Stealing_Pool::submit(Task task) {
+  Worker_Queue &queue = *_queues[_next_queue];
+  _next_queue = (_next_queue + 1) % _queues.size();
+  std::lock_guard<std::mutex> lock(queue.mutex);
+  queue.tasks.push_back(std::move(task));
+}
+
+/* 
+  No tasks are added while the batch runs, so a worker that finds every queue empty can stop,
+  the tasks still running elsewhere are finished by their own threads
+*/
+void Work_Stealing_Pool::run() {
+  _steal_count = 0;
+  std::vector<std::thread> threads;
+  for(size_t i = 1; i < _queues.size(); i++) {
+    threads.emplace_back(&Work_Stealing_Pool::_work, this, i);
+  }
+  _work(0);
+  for(std::thread &thread : threads) {
+    thread.join();
+  }
+  _next_queue = 0;
+}
+
+size_t Work_Stealing_Pool::get_thread_count() const {
+  return _queues.size();
+}
+
+size_t Work_Stealing_Pool::get_steal_count() const {
+  return _steal_count;
+}
+
+bool Work_Stealing_Pool::_pop(size_t worker, Task &task) {
+  Worker_Queue &queue = *_queues[worker];
+  std::lock_guard<std::mutex> lock(queue.mutex);
+  if(queue.tasks.empty()) return false;
+  task = std::move(queue.tasks.back());
+  queue.tasks.pop_back();
+  return true;
+}
+
+bool Work_Stealing_Pool::_steal(size_t worker, Task &task) {
+  for(size_t i = 1; i < _queues.size(); i++) {
+    Worker_Queue &queue = *_queues[(worker + i) % _queues.size()];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if(queue.tasks.empty()) continue;
+    task = std::move(queue.tasks.front());
+    queue.tasks.pop_front();
+    return true;
+  }
+  return false;
+}
+
+void Work_Stealing_Pool::_work(size_t worker) {
+  Task task;
+  while(true) {
+    if(!_pop(worker, task)) {
+      if(!_steal(worker, task)) return;
+      _steal_count.fetch_add(1, std::memory_order_relaxed);
+    }
+    task();
+  }
+}
\ No newline at end of file
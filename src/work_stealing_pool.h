@@ -0,0 +1,48 @@
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stddef.h>
+#include <vector>
+#include "spsc_ring.h"
+
+/*
+  Runs a batch of independent tasks on a fixed number of threads. Every thread has its own queue,
+  taking tasks from the back of it, and steals from the front of the other queues once it runs dry
+*/
+class Work_Stealing_Pool {
+  public:
+    typedef std::function<void()> Task;
+    /* Constructor, a thread count of 0 uses one thread per core */
+    explicit Work_Stealing_Pool(size_t thread_count = 0);
+    /* Add a task to the batch, tasks are spread over the queues in turn */
+    void submit(Task task);
+    /* Run every submitted task, the calling thread works as one of the threads. Returns once all are done */
+    void run();
+    /* Number of threads running tasks, including the calling thread */
+    size_t get_thread_count() const;
+    /* Number of tasks taken from another thread's queue in the last run */
+    size_t get_steal_count() const;
+  private:
+    /* Queues on their own cache lines, each guarded by its own lock */
+    struct alignas(CACHE_LINE_SIZE) Worker_Queue {
+      std::mutex mutex;
+      std::deque<Task> tasks;
+    };
+    /* Take the newest task from the worker's own queue */
+    bool _pop(size_t worker, Task &task);
+    /* Take the oldest task from the first other queue that has one */
+    bool _steal(size_t worker, Task &task);
+    /* Run tasks until every queue is empty */
+    void _work(size_t worker);
+    std::vector<std::unique_ptr<Worker_Queue>> _queues;
+    /* Queue the next submitted task goes to */
+    size_t _next_queue;
+    std::atomic<size_t> _steal_count;
+};
+
+#endif
\ No newline at end of file